@@ -0,0 +1,205 @@
+#include "util/string.h"
+
+#include "parser.h"
+#include "bench.h"
+
+namespace Thor {
+
+// A mix of declarations, statements and expressions so the nodes are spread
+// over many slabs like they are for real source.
+static constexpr const StringView AST_FRAGMENT =
+	"Item :: struct {\n"
+	"\tname:   string,\n"
+	"\tweight: int,\n"
+	"\tvalue:  [4]f32,\n"
+	"}\n"
+	"\n"
+	"foo :: proc(items: []Item, a, b: int, d: f32) {\n"
+	"\tx := (a + b) * 2 - a / 2\n"
+	"\tif x > 10 && b != 0 {\n"
+	"\t\tfmt.printf(\"%d:%d:%f\\n\", a, b, d)\n"
+	"\t} else {\n"
+	"\t\tx = items[a].weight\n"
+	"\t}\n"
+	"\tfor i := 0; i < len(items); i += 1 {\n"
+	"\t\ty := items[i].weight * cast(int)items[i].value[0]\n"
+	"\t\tdefer x += y\n"
+	"\t}\n"
+	"}\n"
+	"\n";
+
+static constexpr const Ulen AST_SIZE = 4 << 20;
+
+// Parse all of [input] and then measure reading the AST back: looking up every
+// node by its AstID in the order they were made, which is nothing but decoding
+// the ID, and dumping every statement, which follows the tree from the top by
+// recursion. Then flattening the tree into preorder with AstWalker and scanning
+// that, which is what a pass over the whole tree would do instead, and hashing
+// every statement with an AstHasher which has hashed nothing before.
+static void measure_ast(Bench& bench, StringView name, Slice<const Uint8> input) {
+	TemporaryAllocator temporary{bench.heap};
+	auto data = bench.copy(temporary, input);
+	if (!data) {
+		return;
+	}
+	auto lexer = Lexer::open(move(*data));
+	if (!lexer) {
+		return;
+	}
+	auto tokens = TokenBuffer::tokenize(*lexer, temporary);
+	if (!tokens) {
+		return;
+	}
+	auto parser = Parser::open(bench.sys, name, move(*lexer), move(*tokens));
+	if (!parser) {
+		return;
+	}
+	auto& ast = parser->ast();
+	Array<AstID> ids{temporary};
+	Array<AstRef<AstStmt>> stmts{temporary};
+	ast.track(&ids);
+	while (auto stmt = parser->parse_stmt(false, {}, {})) {
+		if (!stmts.push_back(stmt)) {
+			return;
+		}
+	}
+	ast.track(nullptr);
+
+	Ulen checksum = 0;
+	Seconds lookup_elapsed{0.0};
+	Seconds dump_elapsed{0.0};
+	Seconds walk_elapsed{0.0};
+	Seconds scan_elapsed{0.0};
+	Seconds hash_elapsed{0.0};
+	Ulen bytes = 0;
+	Ulen walked = 0;
+	// Kept from one iteration to the next as a pass would for each file.
+	Array<AstWalker::Node> nodes{temporary};
+	for (Uint32 i = 0; i < bench.warmup + bench.iterations; i++) {
+		Ulen sum = 0;
+		const auto t0 = MonotonicTime::now(bench.sys);
+		for (auto id : ids) {
+			sum += ast[AstRef<AstNode>{id}].offset;
+		}
+		const auto t1 = MonotonicTime::now(bench.sys);
+		StringBuilder builder{temporary};
+		const auto t2 = MonotonicTime::now(bench.sys);
+		for (auto stmt : stmts) {
+			ast[stmt].dump(ast, builder, 0);
+		}
+		const auto t3 = MonotonicTime::now(bench.sys);
+		auto result = builder.result();
+		if (!result) {
+			return;
+		}
+		AstWalker walker{ast, temporary};
+		nodes.clear();
+		const auto t4 = MonotonicTime::now(bench.sys);
+		if (!walker.push(stmts.slice().cast<const AstRef<AstStmt>>()) || !walker.flatten(nodes)) {
+			return;
+		}
+		const auto t5 = MonotonicTime::now(bench.sys);
+		Ulen scan = 0;
+		for (const auto& node : nodes) {
+			scan += ast[AstRef<AstNode>{node.id}].offset;
+		}
+		const auto t6 = MonotonicTime::now(bench.sys);
+		AstHasher hasher{ast, temporary};
+		Hash hashes = 0;
+		const auto t7 = MonotonicTime::now(bench.sys);
+		for (auto stmt : stmts) {
+			auto h = hasher.hash(stmt);
+			if (!h) {
+				return;
+			}
+			hashes ^= *h;
+		}
+		const auto t8 = MonotonicTime::now(bench.sys);
+		if (i >= bench.warmup) {
+			lookup_elapsed += t1 - t0;
+			dump_elapsed += t3 - t2;
+			walk_elapsed += t5 - t4;
+			scan_elapsed += t6 - t5;
+			hash_elapsed += t8 - t7;
+			bytes += result->length();
+			walked += nodes.length();
+		}
+		checksum += sum + scan + (hashes & 1);
+	}
+	const auto n = ids.length() * bench.iterations;
+	bench.report("lookup", name, input.length() * bench.iterations, n, "node", lookup_elapsed, 0);
+	bench.report("dump", name, bytes, n, "node", dump_elapsed, 0);
+	bench.report("walk", name, input.length() * bench.iterations, walked, "node", walk_elapsed, 0);
+	bench.report("scan", name, input.length() * bench.iterations, walked, "node", scan_elapsed, 0);
+	bench.report("hash", name, input.length() * bench.iterations, walked, "node", hash_elapsed, 0);
+	if (checksum == 0) {
+		bench.sys.console.write(bench.sys, StringView { "lookup: no nodes\n" });
+	}
+}
+
+// Parse all of [input] without and then with AstFile::intern(). The nodes are
+// those kept and the peak is the most allocated while parsing, so the two show
+// how much interning saves and what it costs.
+static void measure_intern(Bench& bench, StringView name, Slice<const Uint8> input) {
+	for (Uint32 intern = 0; intern < 2; intern++) {
+		Ulen nodes = 0;
+		Seconds elapsed{0.0};
+		Ulen peak = 0;
+		for (Uint32 i = 0; i < bench.warmup + bench.iterations; i++) {
+			TemporaryAllocator temporary{bench.heap};
+			auto data = bench.copy(temporary, input);
+			if (!data) {
+				return;
+			}
+			auto lexer = Lexer::open(move(*data));
+			if (!lexer) {
+				return;
+			}
+			auto tokens = TokenBuffer::tokenize(*lexer, temporary);
+			if (!tokens) {
+				return;
+			}
+			const auto base = Bench::reset_peak();
+			const auto t0 = MonotonicTime::now(bench.sys);
+			auto parser = Parser::open(bench.sys, name, move(*lexer), move(*tokens));
+			if (!parser) {
+				return;
+			}
+			parser->ast().intern(intern != 0);
+			for (;;) {
+				if (!parser->parse_stmt(false, {}, {})) {
+					break;
+				}
+			}
+			const auto t1 = MonotonicTime::now(bench.sys);
+			if (const auto used = Bench::peak() - base; used > peak) {
+				peak = used;
+			}
+			if (i >= bench.warmup) {
+				elapsed += t1 - t0;
+				nodes += parser->ast().nodes();
+			}
+		}
+		const auto suite = intern ? StringView { "interned" } : StringView { "parsed" };
+		bench.report(suite, name, input.length() * bench.iterations, nodes, "node", elapsed, peak);
+	}
+}
+
+void bench_ast(Bench& bench) {
+	TemporaryAllocator temporary{bench.heap};
+	if (!bench.files.is_empty()) {
+		for (auto file : bench.files) {
+			if (auto data = bench.load(temporary, file)) {
+				measure_ast(bench, file, data->slice().cast<const Uint8>());
+				measure_intern(bench, file, data->slice().cast<const Uint8>());
+			}
+		}
+		return;
+	}
+	if (auto data = bench.generate(temporary, AST_FRAGMENT.cast<const Uint8>(), AST_SIZE)) {
+		measure_ast(bench, "source", data->slice().cast<const Uint8>());
+		measure_intern(bench, "source", data->slice().cast<const Uint8>());
+	}
+}
+
+} // namespace Thor
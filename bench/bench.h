@@ -0,0 +1,62 @@
+#ifndef THOR_BENCH_H
+#define THOR_BENCH_H
+#include "util/system.h"
+#include "util/time.h"
+
+namespace Thor {
+
+// State shared by all the benchmark suites.
+struct Bench {
+	Bench(System& sys)
+		: sys{sys}
+		, heap{sys}
+		, files{sys.allocator}
+	{
+	}
+
+	// Read the contents of [file] into memory allocated from [allocator].
+	Maybe<Array<Uint8>> load(Allocator& allocator, StringView file) const;
+
+	// Make a copy of [data] into memory allocated from [allocator].
+	Maybe<Array<Uint8>> copy(Allocator& allocator, Slice<const Uint8> data) const;
+
+	// Repeat [fragment] into memory allocated from [allocator] until it's at least
+	// [size] bytes.
+	Maybe<Array<Uint8>> generate(Allocator& allocator, Slice<const Uint8> fragment, Ulen size) const;
+
+	// Add [path] to the input files, when it's a directory every .odin file in it
+	// and the directories under it are added instead.
+	Bool add(StringView path);
+
+	// Report a single result line for [suite] over [input]. The [peak] is the most
+	// bytes allocated from the heap at once while measuring.
+	void report(StringView suite,
+	            StringView input,
+	            Ulen       bytes,
+	            Ulen       items,
+	            StringView unit,
+	            Seconds    elapsed,
+	            Ulen       peak) const;
+
+	// Start tracking the most bytes allocated from the heap at once from now on.
+	// Returns the number of bytes allocated right now, peak() less that is how
+	// much more was needed since.
+	static Ulen reset_peak();
+	static Ulen peak();
+
+	System&           sys;
+	SystemAllocator   heap;         // For per-iteration TemporaryAllocator
+	Array<StringView> files;        // Input files given on the command line
+	Uint32            warmup = 1;   // Iterations run before measuring
+	Uint32            iterations = 10;
+};
+
+void bench_lexer(Bench& bench);
+void bench_identifier(Bench& bench);
+void bench_parser(Bench& bench);
+void bench_ast(Bench& bench);
+void bench_driver(Bench& bench);
+
+} // namespace Thor
+
+#endif // THOR_BENCH_H
@@ -0,0 +1,59 @@
+#include "util/string.h"
+
+#include "driver.h"
+#include "bench.h"
+
+namespace Thor {
+
+// The most threads measured, the count doubles from one up to this.
+static constexpr const Ulen DRIVER_THREADS = 32;
+
+// Parse all of the input files with the Driver on a growing number of threads
+// to see how it scales. There is no generated input for this one, give it files
+// or a directory of them, e.g made with thor-gen.
+void bench_driver(Bench& bench) {
+	if (bench.files.is_empty()) {
+		bench.sys.console.write(bench.sys, StringView { "driver    needs input files\n" });
+		return;
+	}
+	Driver driver{bench.sys};
+	for (auto file : bench.files) {
+		if (!driver.add(file)) {
+			return;
+		}
+	}
+	for (Ulen threads = 1; threads <= DRIVER_THREADS; threads *= 2) {
+		Ulen bytes = 0;
+		Ulen nodes = 0;
+		Ulen peak = 0;
+		Seconds elapsed{0.0};
+		for (Uint32 i = 0; i < bench.warmup + bench.iterations; i++) {
+			const auto base = Bench::reset_peak();
+			const auto t0 = MonotonicTime::now(bench.sys);
+			if (!driver.parse(threads, false)) {
+				return;
+			}
+			const auto t1 = MonotonicTime::now(bench.sys);
+			if (const auto used = Bench::peak() - base; used > peak) {
+				peak = used;
+			}
+			if (i < bench.warmup) {
+				continue;
+			}
+			elapsed += t1 - t0;
+			for (const auto unit : driver.units()) {
+				bytes += unit->bytes;
+				nodes += unit->nodes;
+			}
+		}
+		ScratchAllocator<64> scratch{bench.sys.allocator};
+		StringBuilder name{scratch};
+		name.put(Uint64(threads));
+		name.put(threads == 1 ? StringView { " thread" } : StringView { " threads" });
+		if (auto result = name.result()) {
+			bench.report("driver", *result, bytes, nodes, "node", elapsed, peak);
+		}
+	}
+}
+
+} // namespace Thor
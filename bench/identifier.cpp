@@ -0,0 +1,118 @@
+#include "util/string.h"
+
+#include "lexer.h"
+#include "bench.h"
+
+namespace Thor {
+
+// The linear scan Lexer::advance used before Lexer::classify, kept here as the
+// reference to measure against.
+static Token classify_linear(StringView str, Uint32 offset) {
+	static constexpr const struct {
+		StringView   match;
+		OperatorKind kind;
+	} OPERATORS[] = {
+		#define OPERATOR_true(ENUM, MATCH) \
+			{ MATCH, OperatorKind::ENUM },
+		#define OPERATOR_false(...)
+		#define OPERATOR(ENUM, NAME, MATCH, PREC, NAMED, ASI) \
+			OPERATOR_ ## NAMED (ENUM, MATCH)
+		#include "lexer.inl"
+		#undef OPERATOR_true
+		#undef OPERATOR_false
+	};
+	const auto len = Uint16(str.length());
+	for (Ulen i = 0; i < countof(OPERATORS); i++) {
+		if (const auto& op = OPERATORS[i]; op.match == str) {
+			return { op.kind, offset, len };
+		}
+	}
+	static constexpr const struct {
+		StringView  match;
+		KeywordKind kind;
+	} KEYWORDS[] = {
+		#define KEYWORD(ENUM, MATCH, ASI) \
+			{ MATCH, KeywordKind::ENUM },
+		#include "lexer.inl"
+	};
+	for (Ulen i = 0; i < countof(KEYWORDS); i++) {
+		if (const auto& kw = KEYWORDS[i]; kw.match == str) {
+			return { kw.kind, offset, len };
+		}
+	}
+	return { TokenKind::IDENTIFIER, offset, len };
+}
+
+// Identifiers typical of Odin source, a fair number of which share a prefix or
+// length with a keyword so the string compares are not trivially rejected.
+static constexpr const StringView WORDS[] = {
+	"x", "i", "n", "ok", "err", "value", "result", "context", "index", "items",
+	"in", "if", "for", "proc", "return", "struct", "cast", "or_else", "import",
+	"package", "when", "switch", "case", "defer", "using", "distinct", "matrix",
+	"int", "f32", "string", "allocator", "do_thing", "in_range", "formatted",
+	"map_key", "structure", "dynamic_array", "transmuted", "bit_set", "enum",
+	"make", "len", "append", "procedure_name", "fallthrough", "continue_loop",
+};
+
+void bench_identifier(Bench& bench) {
+	static constexpr const Ulen COUNT = 1 << 20;
+
+	TemporaryAllocator temporary{bench.heap};
+	Array<StringView> idents{temporary};
+	if (!idents.reserve(COUNT)) {
+		return;
+	}
+	Ulen bytes = 0;
+	Uint32 state = 0x12345678;
+	for (Ulen i = 0; i < COUNT; i++) {
+		state = state * 1664525 + 1013904223; // LCG
+		const auto& word = WORDS[(state >> 16) % countof(WORDS)];
+		bytes += word.length();
+		if (!idents.push_back(word)) {
+			return;
+		}
+	}
+
+	auto run = [&](StringView name, Token (*classify)(StringView, Uint32)) -> Ulen {
+		Ulen checksum = 0;
+		Seconds elapsed{0.0};
+		for (Uint32 i = 0; i < bench.warmup + bench.iterations; i++) {
+			Ulen sum = 0;
+			const auto beg = MonotonicTime::now(bench.sys);
+			for (auto ident : idents) {
+				const auto token = classify(ident, 0);
+				switch (token.kind) {
+				case TokenKind::OPERATOR:
+					sum += 1 + Ulen(token.as_operator);
+					break;
+				case TokenKind::KEYWORD:
+					sum += 65 + Ulen(token.as_keyword);
+					break;
+				default:
+					break;
+				}
+			}
+			const auto end = MonotonicTime::now(bench.sys);
+			if (i >= bench.warmup) {
+				elapsed += end - beg;
+			}
+			checksum = sum;
+		}
+		bench.report("classify",
+		             name,
+		             bytes * bench.iterations,
+		             idents.length() * bench.iterations,
+		             "id",
+		             elapsed,
+		             0);
+		return checksum;
+	};
+
+	const auto linear = run("linear", classify_linear);
+	const auto perfect = run("perfect hash", Lexer::classify);
+	if (linear != perfect) {
+		bench.sys.console.write(bench.sys, StringView { "classify: results differ\n" });
+	}
+}
+
+} // namespace Thor
@@ -0,0 +1,99 @@
+#include "util/string.h"
+
+#include "lexer.h"
+#include "bench.h"
+
+namespace Thor {
+
+// Each generated input is a short fragment repeated until it is at least this
+// large so that the fixed per-token costs are amortized in the measurement.
+static constexpr const Ulen GENERATED_SIZE = 16 << 20;
+
+// Fragments which stress the different scanning paths of the lexer.
+static constexpr const struct {
+	StringView name;
+	StringView fragment;
+} GENERATED[] = {
+	{ "whitespace",  "\t\t\t\t\t\tvalue            =            other\r\n\n" },
+	{ "identifiers", "a_reasonably_long_identifier_0123 another_much_longer_identifier_for_lexing\n" },
+	{ "comments",    "// A line comment which goes on for a while like most prose does.\n"
+	                 "/* A block comment\n   which spans multiple lines /* nested */ */\n" },
+	{ "strings",     "\"a string literal with some text in it and an \\n escape\"\n"
+	                 "`a raw string literal without any escapes in it at all`\n" },
+	// Identifiers, comments and strings in Latin, Han, Katakana and Cyrillic
+	{ "unicode",     "na\xc3\xafve_caf\xc3\xa9 := gr\xc3\xb6\xc3\x9f" "e * \xe6\x95\xb0\xe6\x8d\xae"
+	                 " // \xe3\x82\xb3\xe3\x83\xa1\xe3\x83\xb3\xe3\x83\x88\n"
+	                 "\"\xd1\x81\xd1\x82\xd1\x80\xd0\xbe\xd0\xba\xd0\xb0\"\n" },
+};
+
+// Lex all of [data] and return the number of tokens.
+static Ulen lex(Array<Uint8>&& data) {
+	auto lexer = Lexer::open(move(data));
+	if (!lexer) {
+		return 0;
+	}
+	Ulen tokens = 0;
+	for (;;) {
+		const auto token = lexer->next();
+		tokens++;
+		if (token.kind == TokenKind::ENDOF) {
+			break;
+		}
+	}
+	return tokens;
+}
+
+static void run(Bench& bench, StringView name, Slice<const Uint8> input) {
+	Ulen tokens = 0;
+	Seconds elapsed{0.0};
+	Ulen peak = 0;
+	for (Uint32 i = 0; i < bench.warmup + bench.iterations; i++) {
+		TemporaryAllocator temporary{bench.heap};
+		auto data = bench.copy(temporary, input);
+		if (!data) {
+			return;
+		}
+		const auto base = Bench::reset_peak();
+		const auto beg = MonotonicTime::now(bench.sys);
+		const auto n = lex(move(*data));
+		const auto end = MonotonicTime::now(bench.sys);
+		if (const auto used = Bench::peak() - base; used > peak) {
+			peak = used;
+		}
+		if (i >= bench.warmup) {
+			elapsed += end - beg;
+			tokens += n;
+		}
+	}
+	bench.report("lexer",
+	             name,
+	             input.length() * bench.iterations,
+	             tokens,
+	             "tok",
+	             elapsed,
+	             peak);
+}
+
+void bench_lexer(Bench& bench) {
+	TemporaryAllocator temporary{bench.heap};
+	if (!bench.files.is_empty()) {
+		for (auto file : bench.files) {
+			if (auto data = bench.load(temporary, file)) {
+				run(bench, file, data->slice().cast<const Uint8>());
+			}
+		}
+		return;
+	}
+	if (auto source = bench.load(temporary, "test/ks.odin")) {
+		if (auto data = bench.generate(temporary, source->slice().cast<const Uint8>(), GENERATED_SIZE)) {
+			run(bench, "source", data->slice().cast<const Uint8>());
+		}
+	}
+	for (const auto& input : GENERATED) {
+		if (auto data = bench.generate(temporary, input.fragment.cast<const Uint8>(), GENERATED_SIZE)) {
+			run(bench, input.name, data->slice().cast<const Uint8>());
+		}
+	}
+}
+
+} // namespace Thor
@@ -0,0 +1,238 @@
+#include "util/atomic.h"
+#include "util/file.h"
+#include "util/string.h"
+
+#include "bench.h"
+
+namespace Thor {
+	extern const Filesystem STD_FILESYSTEM;
+	extern const Heap       STD_HEAP;
+	extern const Console    STD_CONSOLE;
+	extern const Process    STD_PROCESS;
+	extern const Linker     STD_LINKER;
+	extern const Scheduler  STD_SCHEDULER;
+	extern const Chrono     STD_CHRONO;
+
+// The heap is wrapped to count the bytes allocated from it. Everything else
+// allocates from the heap eventually, including the threads of the parallel
+// tokenizer, so the counts are atomic.
+static Atomic<Ulen> g_used{0};
+static Atomic<Ulen> g_peak{0};
+
+static void* counted_allocate(System& sys, Ulen length, Bool zero) {
+	auto addr = STD_HEAP.allocate(sys, length, zero);
+	if (addr) {
+		const auto used = g_used.fetch_add(length) + length;
+		for (auto peak = g_peak.load(); used > peak; peak = g_peak.load()) {
+			if (g_peak.compare_exchange_weak(peak, used)) {
+				break;
+			}
+		}
+	}
+	return addr;
+}
+
+static void counted_deallocate(System& sys, void* addr, Ulen length) {
+	STD_HEAP.deallocate(sys, addr, length);
+	g_used.fetch_sub(length);
+}
+
+static constexpr const Heap BENCH_HEAP = {
+	.allocate   = counted_allocate,
+	.deallocate = counted_deallocate,
+};
+
+Ulen Bench::reset_peak() {
+	const auto used = g_used.load();
+	g_peak.store(used);
+	return used;
+}
+
+Ulen Bench::peak() {
+	return g_peak.load();
+}
+
+Bool Bench::add(StringView path) {
+	auto dir = sys.filesystem.open_dir(sys, path);
+	if (!dir) {
+		return ends_with(path, ".odin") && files.push_back(path);
+	}
+	Bool ok = true;
+	Filesystem::Item item;
+	while (ok && sys.filesystem.read_dir(sys, dir, item)) {
+		using Kind = Filesystem::Item::Kind;
+		if (item.kind == Kind::FILE && !ends_with(item.name, ".odin")) {
+			continue;
+		}
+		// The names of the files are needed for as long as the benchmark runs.
+		const auto length = path.length() + 1 + item.name.length();
+		auto name = sys.allocator.allocate<char>(length, false);
+		if (!name) {
+			ok = false;
+			break;
+		}
+		Allocator::memcopy(Address(name), Address(path.data()), path.length());
+		name[path.length()] = '/';
+		Allocator::memcopy(Address(name + path.length() + 1), Address(item.name.data()), item.name.length());
+		const StringView entry{name, length};
+		ok = item.kind == Kind::FILE ? files.push_back(entry) : add(entry);
+	}
+	sys.filesystem.close_dir(sys, dir);
+	return ok;
+}
+
+Maybe<Array<Uint8>> Bench::load(Allocator& allocator, StringView name) const {
+	auto file = File::open(sys, name, File::Access::RD);
+	if (!file) {
+		return {};
+	}
+	auto map = file->map(allocator);
+	if (map.is_empty()) {
+		return {};
+	}
+	return map;
+}
+
+Maybe<Array<Uint8>> Bench::copy(Allocator& allocator, Slice<const Uint8> data) const {
+	Array<Uint8> result{allocator};
+	if (!result.resize(data.length())) {
+		return {};
+	}
+	Allocator::memcopy(Address(result.data()), Address(data.data()), data.length());
+	return result;
+}
+
+Maybe<Array<Uint8>> Bench::generate(Allocator& allocator, Slice<const Uint8> fragment, Ulen size) const {
+	Array<Uint8> result{allocator};
+	if (fragment.is_empty() || !result.reserve(size + fragment.length())) {
+		return {};
+	}
+	while (result.length() < size) {
+		for (auto ch : fragment) {
+			if (!result.push_back(ch)) {
+				return {};
+			}
+		}
+	}
+	return result;
+}
+
+void Bench::report(StringView suite,
+                   StringView input,
+                   Ulen       bytes,
+                   Ulen       items,
+                   StringView unit,
+                   Seconds    elapsed,
+                   Ulen       peak) const
+{
+	ScratchAllocator<1024> scratch{sys.allocator};
+	StringBuilder builder{scratch};
+	const auto seconds = elapsed.value();
+	builder.rpad(10, suite);
+	builder.rpad(24, input);
+	builder.put(Float64(bytes) / seconds / (1024.0 * 1024.0));
+	builder.put(" MiB/s\t");
+	builder.put(Float64(items) / seconds / 1e6);
+	builder.put(" M");
+	builder.put(unit);
+	builder.put("/s\t");
+	builder.put(seconds * 1e3);
+	builder.put(" ms\t");
+	builder.put(Float64(peak) / (1024.0 * 1024.0));
+	builder.put(" MiB peak\n");
+	if (auto result = builder.result()) {
+		sys.console.write(sys, *result);
+	}
+}
+
+} // namespace Thor
+
+using namespace Thor;
+
+static constexpr const struct {
+	StringView name;
+	void (*run)(Bench& bench);
+} SUITES[] = {
+	{ "lexer",    bench_lexer },
+	{ "classify", bench_identifier },
+	{ "parser",   bench_parser },
+	{ "ast",      bench_ast },
+	{ "driver",   bench_driver },
+};
+static constexpr const Ulen N_SUITES = sizeof SUITES / sizeof *SUITES;
+
+static StringView from_cstr(const char* str) {
+	Ulen length = 0;
+	while (str[length]) length++;
+	return { str, length };
+}
+
+static Maybe<Uint32> parse_uint(StringView str) {
+	if (str.is_empty()) {
+		return {};
+	}
+	Uint32 value = 0;
+	for (auto ch : str) {
+		if (ch < '0' || ch > '9') {
+			return {};
+		}
+		value = value * 10 + (ch - '0');
+	}
+	return value;
+}
+
+// Usage: thor-bench [-w warmup] [-n iterations] [suite...] [file.odin|dir...]
+//
+// With no suites named all of them are run. With no files given each suite uses
+// its own generated inputs. A directory stands for all the .odin files in it.
+int main(int argc, char** argv) {
+	System sys {
+		STD_FILESYSTEM,
+		BENCH_HEAP,
+		STD_CONSOLE,
+		STD_PROCESS,
+		STD_LINKER,
+		STD_SCHEDULER,
+		STD_CHRONO,
+	};
+
+	Bench bench{sys};
+	Bool selected[N_SUITES] = {};
+	Bool any = false;
+	for (int i = 1; i < argc; i++) {
+		const auto arg = from_cstr(argv[i]);
+		if (arg == "-n" && i + 1 < argc) {
+			if (auto n = parse_uint(from_cstr(argv[i + 1])); n && *n) {
+				bench.iterations = *n;
+			}
+			i++;
+			continue;
+		}
+		if (arg == "-w" && i + 1 < argc) {
+			if (auto n = parse_uint(from_cstr(argv[i + 1]))) {
+				bench.warmup = *n;
+			}
+			i++;
+			continue;
+		}
+		Bool suite = false;
+		for (Ulen j = 0; j < N_SUITES; j++) {
+			if (SUITES[j].name == arg) {
+				selected[j] = true;
+				suite = any = true;
+			}
+		}
+		if (!suite && !bench.add(arg)) {
+			sys.console.write(sys, StringView { "Unknown suite, file or directory\n" });
+			return 1;
+		}
+	}
+
+	for (Ulen i = 0; i < N_SUITES; i++) {
+		if (!any || selected[i]) {
+			SUITES[i].run(bench);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,311 @@
+#include "util/string.h"
+
+#include "parser.h"
+#include "bench.h"
+
+namespace Thor {
+
+// The parser does not handle all of test/ks.odin yet so the generated input is
+// a fragment of the declarations, statements and expressions which it does.
+static constexpr const StringView PARSER_FRAGMENT =
+	"Item :: struct {\n"
+	"\tname:   string,\n"
+	"\tweight: int,\n"
+	"\tvalue:  int,\n"
+	"}\n"
+	"\n"
+	"foo :: proc(items: []Item, a, b: int, d: f32) {\n"
+	"\tx := (a + b) * 2 - a / 2\n"
+	"\tif x > 10 && b != 0 {\n"
+	"\t\tfmt.printf(\"%d:%d:%f\\n\", a, b, d)\n"
+	"\t} else {\n"
+	"\t\tx = items[a].weight\n"
+	"\t}\n"
+	"\tfor i := 0; i < len(items); i += 1 {\n"
+	"\t\ty := items[i].weight * items[i].value\n"
+	"\t}\n"
+	"}\n"
+	"\n";
+
+// Smaller than the lexer inputs since the AST for it has to fit too.
+static constexpr const Ulen PARSER_SIZE = 4 << 20;
+
+// Tokenize and then parse all of [input], measuring each on its own. Tokenizing
+// is measured both on a single thread and on all of them.
+static void measure(Bench& bench, StringView name, Slice<const Uint8> input) {
+	const auto threads = bench.sys.scheduler.thread_count(bench.sys);
+	Ulen tokens = 0;
+	Ulen nodes = 0;
+	Seconds lex_elapsed{0.0};
+	Seconds parallel_elapsed{0.0};
+	Seconds parse_elapsed{0.0};
+	Ulen lex_peak = 0;
+	Ulen parallel_peak = 0;
+	Ulen parse_peak = 0;
+	// The peak of each is the most allocated while it runs in any iteration.
+	auto peak = [](Ulen& result, Ulen base) {
+		if (const auto peak = Bench::peak() - base; peak > result) {
+			result = peak;
+		}
+	};
+	for (Uint32 i = 0; i < bench.warmup + bench.iterations; i++) {
+		TemporaryAllocator temporary{bench.heap};
+		auto data = bench.copy(temporary, input);
+		auto copy = bench.copy(temporary, input);
+		if (!data || !copy) {
+			return;
+		}
+		auto lexer = Lexer::open(move(*data));
+		auto other = Lexer::open(move(*copy));
+		if (!lexer || !other) {
+			return;
+		}
+		auto base = Bench::reset_peak();
+		const auto t0 = MonotonicTime::now(bench.sys);
+		auto buffer = TokenBuffer::tokenize(*lexer, temporary);
+		const auto t1 = MonotonicTime::now(bench.sys);
+		peak(lex_peak, base);
+		base = Bench::reset_peak();
+		const auto t2 = MonotonicTime::now(bench.sys);
+		auto parallel = TokenBuffer::tokenize(bench.sys, *other, temporary, threads);
+		const auto t3 = MonotonicTime::now(bench.sys);
+		peak(parallel_peak, base);
+		if (!buffer || !parallel || buffer->length() != parallel->length()) {
+			return;
+		}
+		const auto n = buffer->length();
+		base = Bench::reset_peak();
+		const auto t4 = MonotonicTime::now(bench.sys);
+		auto parser = Parser::open(bench.sys, name, move(*lexer), move(*buffer));
+		if (!parser) {
+			return;
+		}
+		for (;;) {
+			if (!parser->parse_stmt(false, {}, {})) {
+				break;
+			}
+		}
+		const auto t5 = MonotonicTime::now(bench.sys);
+		peak(parse_peak, base);
+		if (i >= bench.warmup) {
+			lex_elapsed += t1 - t0;
+			parallel_elapsed += t3 - t2;
+			parse_elapsed += t5 - t4;
+			tokens += n;
+			nodes += parser->ast().nodes();
+		}
+	}
+	const auto bytes = input.length() * bench.iterations;
+	bench.report("tokenize", name, bytes, tokens, "tok", lex_elapsed, lex_peak);
+	bench.report("parallel", name, bytes, tokens, "tok", parallel_elapsed, parallel_peak);
+	bench.report("parse", name, bytes, nodes, "node", parse_elapsed, parse_peak);
+}
+
+// Parse all of [input] and then measure parsing it again after a one byte edit
+// in the middle of it, as is typical of editing a file and building again.
+static void measure_reparse(Bench& bench, StringView name, Slice<const Uint8> input) {
+	// A space added before the newline nearest the middle changes no tokens but
+	// moves every one after it.
+	Ulen middle = input.length() / 2;
+	while (middle < input.length() && input[middle] != '\n') {
+		middle++;
+	}
+	Ulen nodes = 0;
+	Seconds elapsed{0.0};
+	Ulen peak = 0;
+	for (Uint32 i = 0; i < bench.warmup + bench.iterations; i++) {
+		TemporaryAllocator temporary{bench.heap};
+		auto data = bench.copy(temporary, input);
+		Array<Uint8> edit{temporary};
+		if (!data || !edit.resize(input.length() + 1)) {
+			return;
+		}
+		for (Ulen j = 0; j < input.length(); j++) {
+			edit[j + (j >= middle)] = input[j];
+		}
+		edit[middle] = ' ';
+		auto lexer = Lexer::open(move(*data));
+		auto edited = Lexer::open(move(edit));
+		if (!lexer || !edited) {
+			return;
+		}
+		auto tokens = TokenBuffer::tokenize(*lexer, temporary);
+		if (!tokens) {
+			return;
+		}
+		auto parser = Parser::open(bench.sys, name, move(*lexer), move(*tokens));
+		if (!parser || !parser->parse_file()) {
+			return;
+		}
+		const auto base = Bench::reset_peak();
+		const auto t0 = MonotonicTime::now(bench.sys);
+		auto reparsed = Parser::reparse(move(*parser), name, move(*edited));
+		const auto t1 = MonotonicTime::now(bench.sys);
+		if (!reparsed) {
+			return;
+		}
+		if (const auto used = Bench::peak() - base; used > peak) {
+			peak = used;
+		}
+		if (i >= bench.warmup) {
+			elapsed += t1 - t0;
+			nodes += reparsed->ast().nodes();
+		}
+	}
+	bench.report("reparse", name, input.length() * bench.iterations, nodes, "node", elapsed, peak);
+}
+
+// Parse all of [input] skipping the bodies of procedures and then measure lexing
+// and parsing every one of them from its source with Parser::parse_body, as
+// would be done for those of a library which turn out to be called. The bodies
+// of the procedures in a body are skipped too, they are walked to as the walk
+// goes on into each body once it's parsed.
+static void measure_lazy(Bench& bench, StringView name, Slice<const Uint8> input) {
+	Ulen nodes = 0;
+	Ulen bodies = 0;
+	Seconds lazy_elapsed{0.0};
+	Seconds body_elapsed{0.0};
+	for (Uint32 i = 0; i < bench.warmup + bench.iterations; i++) {
+		TemporaryAllocator temporary{bench.heap};
+		auto data = bench.copy(temporary, input);
+		if (!data) {
+			return;
+		}
+		auto lexer = Lexer::open(move(*data));
+		if (!lexer) {
+			return;
+		}
+		auto tokens = TokenBuffer::tokenize(*lexer, temporary);
+		if (!tokens) {
+			return;
+		}
+		auto parser = Parser::open(bench.sys, name, move(*lexer), move(*tokens));
+		if (!parser) {
+			return;
+		}
+		parser->lazy_bodies(true);
+		const auto t0 = MonotonicTime::now(bench.sys);
+		if (!parser->parse_file()) {
+			return;
+		}
+		const auto t1 = MonotonicTime::now(bench.sys);
+		const auto lazy = parser->ast().nodes();
+		AstWalker walker{parser->ast(), temporary};
+		if (!walker.push(parser->stmts())) {
+			return;
+		}
+		Ulen n = 0;
+		const auto t2 = MonotonicTime::now(bench.sys);
+		while (auto node = walker.next()) {
+			if (auto proc = node->as<AstProcExpr>()) {
+				if (!parser->parse_body(proc)) {
+					return;
+				}
+				n++;
+			}
+		}
+		const auto t3 = MonotonicTime::now(bench.sys);
+		if (walker.failed()) {
+			return;
+		}
+		if (i >= bench.warmup) {
+			lazy_elapsed += t1 - t0;
+			body_elapsed += t3 - t2;
+			nodes += lazy;
+			bodies += n;
+		}
+	}
+	bench.report("lazy", name, input.length() * bench.iterations, nodes, "node", lazy_elapsed, 0);
+	bench.report("bodies", name, input.length() * bench.iterations, bodies, "body", body_elapsed, 0);
+}
+
+// Parse all of [input] while it's lexed on another thread. The time for both
+// compares with tokenize plus parse above. How long each stage was busy and how
+// often each had to wait on the other tells whether the two really overlap: a
+// lexer always waiting for room is just ahead of a slower parser, a parser
+// always waiting for tokens is as slow as the lexer.
+static void measure_stream(Bench& bench, StringView name, Slice<const Uint8> input) {
+	Ulen nodes = 0;
+	Seconds elapsed{0.0};
+	Ulen peak = 0;
+	TokenStream::Stats total;
+	for (Uint32 i = 0; i < bench.warmup + bench.iterations; i++) {
+		TemporaryAllocator temporary{bench.heap};
+		auto data = bench.copy(temporary, input);
+		if (!data) {
+			return;
+		}
+		auto lexer = Lexer::open(move(*data));
+		if (!lexer) {
+			return;
+		}
+		const auto base = Bench::reset_peak();
+		const auto t0 = MonotonicTime::now(bench.sys);
+		auto parser = Parser::open_streaming(bench.sys, name, move(*lexer));
+		if (!parser) {
+			return;
+		}
+		for (;;) {
+			if (!parser->parse_stmt(false, {}, {})) {
+				break;
+			}
+		}
+		const auto t1 = MonotonicTime::now(bench.sys);
+		if (const auto used = Bench::peak() - base; used > peak) {
+			peak = used;
+		}
+		const auto stats = parser->stream()->stats();
+		if (i >= bench.warmup) {
+			elapsed += t1 - t0;
+			nodes += parser->ast().nodes();
+			total.tokens += stats.tokens;
+			total.full += stats.full;
+			total.empty += stats.empty;
+			total.lexing += stats.lexing;
+			total.full_wait += stats.full_wait;
+			total.empty_wait += stats.empty_wait;
+		}
+	}
+	const auto bytes = input.length() * bench.iterations;
+	bench.report("stream", name, bytes, nodes, "node", elapsed, peak);
+	bench.report("  lexer", name, bytes, total.tokens, "tok", total.lexing - total.full_wait, 0);
+	bench.report("  parser", name, bytes, nodes, "node", elapsed - total.empty_wait, 0);
+	ScratchAllocator<1024> scratch{bench.sys.allocator};
+	StringBuilder builder{scratch};
+	builder.rpad(10, StringView { "  stalls" });
+	builder.rpad(24, name);
+	builder.put(Uint64(total.full / bench.iterations));
+	builder.put(" lexer waits (");
+	builder.put(total.full_wait.value() * 1e3);
+	builder.put(" ms)\t");
+	builder.put(Uint64(total.empty / bench.iterations));
+	builder.put(" parser waits (");
+	builder.put(total.empty_wait.value() * 1e3);
+	builder.put(" ms)\n");
+	if (auto result = builder.result()) {
+		bench.sys.console.write(bench.sys, *result);
+	}
+}
+
+void bench_parser(Bench& bench) {
+	TemporaryAllocator temporary{bench.heap};
+	if (!bench.files.is_empty()) {
+		for (auto file : bench.files) {
+			if (auto data = bench.load(temporary, file)) {
+				measure(bench, file, data->slice().cast<const Uint8>());
+				measure_stream(bench, file, data->slice().cast<const Uint8>());
+				measure_reparse(bench, file, data->slice().cast<const Uint8>());
+				measure_lazy(bench, file, data->slice().cast<const Uint8>());
+			}
+		}
+		return;
+	}
+	if (auto data = bench.generate(temporary, PARSER_FRAGMENT.cast<const Uint8>(), PARSER_SIZE)) {
+		measure(bench, "source", data->slice().cast<const Uint8>());
+		measure_stream(bench, "source", data->slice().cast<const Uint8>());
+		measure_reparse(bench, "source", data->slice().cast<const Uint8>());
+		measure_lazy(bench, "source", data->slice().cast<const Uint8>());
+	}
+}
+
+} // namespace Thor
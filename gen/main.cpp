@@ -0,0 +1,1075 @@
+#include "util/file.h"
+#include "util/string.h"
+
+namespace Thor {
+	extern const Filesystem STD_FILESYSTEM;
+	extern const Heap       STD_HEAP;
+	extern const Console    STD_CONSOLE;
+	extern const Process    STD_PROCESS;
+	extern const Linker     STD_LINKER;
+	extern const Scheduler  STD_SCHEDULER;
+	extern const Chrono     STD_CHRONO;
+
+// SplitMix64, the whole corpus is a function of the seed alone so the same seed
+// gives the same bytes on every platform.
+struct Random {
+	constexpr Random(Uint64 seed)
+		: state_{seed}
+	{
+	}
+	Uint64 next() {
+		auto z = state_ += 0x9e3779b97f4a7c15_u64;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9_u64;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111eb_u64;
+		return z ^ (z >> 31);
+	}
+	// Uniform in [0, n)
+	Uint32 below(Uint32 n) {
+		return Uint32(next() % n);
+	}
+	// True [percent] percent of the time.
+	Bool chance(Uint32 percent) {
+		return below(100) < percent;
+	}
+	template<typename T, Ulen E>
+	const T& pick(const T(&items)[E]) {
+		return items[below(E)];
+	}
+private:
+	Uint64 state_;
+};
+
+static constexpr const StringView WORDS[] = {
+	"item",   "value",  "count",  "index",  "buffer", "node",
+	"entry",  "result", "offset", "length", "data",   "state",
+	"width",  "height", "name",   "key",    "total",  "cursor",
+	"parent", "child",  "flags",  "mode",   "size",   "scale",
+	"first",  "last",   "delta",  "depth",  "limit",  "score",
+};
+
+static constexpr const Ulen N_WORDS = sizeof WORDS / sizeof *WORDS;
+
+static constexpr const StringView VERBS[] = {
+	"update", "create", "destroy", "find",  "insert", "remove",
+	"read",   "write",  "parse",   "emit",  "reset",  "resize",
+	"push",   "pop",    "visit",   "merge", "split",  "compute",
+};
+
+static constexpr const StringView TYPES[] = {
+	"Node",   "Item",   "Entry",   "Buffer", "State",  "Token",
+	"Vertex", "Mesh",   "Texture", "Packet", "Header", "Config",
+	"Record", "Handle", "Window",  "Event",  "Span",   "Shape",
+};
+
+static constexpr const Ulen N_TYPES = sizeof TYPES / sizeof *TYPES;
+
+static constexpr const StringView BUILTINS[] = {
+	"int",  "uint", "i32", "u8",   "u32",   "u64",  "i64",    "f32",
+	"f64",  "bool", "string", "rawptr", "byte", "rune", "cstring", "uintptr",
+};
+
+static constexpr const StringView INTEGERS[] = {
+	"int", "uint", "i32", "u8", "u16", "u32", "u64", "i64",
+};
+
+static constexpr const StringView ARITHMETIC[] = {
+	"+", "-", "*", "/", "%", "%%", "|", "&", "~", "&~", "<<", ">>",
+};
+
+static constexpr const StringView COMPARISON[] = {
+	"<", ">", "<=", ">=", "!=",
+};
+
+static constexpr const StringView ASSIGNMENT[] = {
+	"=", "+=", "-=", "/=", "%=", "%%=", "|=", "&=", "~=", "&~=", "<<=", ">>=",
+};
+
+static constexpr const StringView PACKAGES[] = {
+	"fmt", "mem", "strings", "os",
+};
+
+// Emits one Odin source file at a time made of the declarations, statements and
+// expressions the parser supports. Everything is on its own line and indented
+// with tabs the way Odin code usually is.
+//
+// Only the forms the parser currently accepts are emitted, in particular there
+// are no result types on procedures, no '==', no 'when' with an 'else' branch
+// and only decimal numeric literals.
+struct Generator {
+	Generator(Allocator& allocator, Uint64 seed)
+		: out{allocator}
+		, random_{seed}
+	{
+	}
+
+	// Start a new file.
+	void header() {
+		structs_ = 0;
+		enums_ = 0;
+		out.put("package gen\n\n");
+		for (auto package : PACKAGES) {
+			out.put("import \"core:");
+			out.put(package);
+			out.put("\"\n");
+		}
+		out.put("foreign import libc \"system:c\"\n\n");
+	}
+
+	// Emit a top-level declaration.
+	void decl() {
+		switch (random_.below(16)) {
+		case 0: case 1: case 2:
+			return struct_decl(0);
+		case 3: case 4:
+			return enum_decl(0);
+		case 5:
+			return union_decl(0);
+		case 6:
+			return alias_decl(0);
+		case 7:
+			return value_decl(0);
+		case 8:
+			return when_decl();
+		default:
+			return proc_decl(0);
+		}
+	}
+
+	StringBuilder out;
+
+private:
+	void indent(Uint32 depth) {
+		out.rep(depth, '\t');
+	}
+
+	void number(Uint32 max) {
+		out.put(random_.below(max));
+	}
+
+	void word() {
+		out.put(random_.pick(WORDS));
+	}
+
+	// Local names are a word with an optional suffix, e.g "offset" or "node_2".
+	void name() {
+		word();
+		if (random_.chance(40)) {
+			out.put('_');
+			number(8);
+		}
+	}
+
+	void proc_name() {
+		out.put(random_.pick(VERBS));
+		out.put('_');
+		word();
+	}
+
+	void constant_name() {
+		for (auto ch : random_.pick(WORDS)) {
+			out.put(char(ch - 'a' + 'A'));
+		}
+		out.put('_');
+		number(64);
+	}
+
+	// The structures and enumerations of a file are named by the order they are
+	// declared in so that later declarations can refer to earlier ones.
+	void struct_name(Uint32 index) {
+		out.put(TYPES[index % N_TYPES]);
+		out.put('_');
+		out.put(index);
+	}
+
+	void enum_name(Uint32 index) {
+		out.put(TYPES[index % N_TYPES]);
+		out.put("_Kind_");
+		out.put(index);
+	}
+
+	void attributes() {
+		switch (random_.below(12)) {
+		case 0:
+			out.put("@(private)\n");
+			break;
+		case 1:
+			out.put("@private\n");
+			break;
+		case 2:
+			out.put("@(private=\"file\")\n");
+			break;
+		case 3:
+			out.put("@(require_results, link_name=\"");
+			proc_name();
+			out.put("\")\n");
+			break;
+		case 4:
+			out.put("#force_inline\n");
+			break;
+		case 5:
+			out.put("#cold\n");
+			break;
+		}
+	}
+
+	void type(Uint32 depth) {
+		if (depth >= 2) {
+			out.put(random_.pick(BUILTINS));
+			return;
+		}
+		switch (random_.below(16)) {
+		case 0:
+			out.put("[]");
+			return type(depth + 1);
+		case 1:
+			out.put('[');
+			out.put(1 + random_.below(16));
+			out.put(']');
+			return type(depth + 1);
+		case 2:
+			out.put("[dynamic]");
+			return type(depth + 1);
+		case 3:
+			out.put('^');
+			return type(depth + 1);
+		case 4:
+			out.put("[^]");
+			return type(depth + 1);
+		case 5:
+			out.put("map[string]");
+			return type(depth + 1);
+		case 6:
+			out.put("matrix[4, 4]f32");
+			return;
+		case 7:
+			if (enums_) {
+				out.put("bit_set[");
+				enum_name(random_.below(enums_));
+				out.put("; ");
+				out.put(random_.pick(INTEGERS));
+				out.put(']');
+				return;
+			}
+			break;
+		case 8: case 9:
+			if (structs_) {
+				return struct_name(random_.below(structs_));
+			}
+			break;
+		case 10:
+			if (enums_) {
+				return enum_name(random_.below(enums_));
+			}
+			break;
+		}
+		out.put(random_.pick(BUILTINS));
+	}
+
+	void literal() {
+		switch (random_.below(10)) {
+		case 0: case 1: case 2: case 3:
+			return number(1000);
+		case 4:
+			number(100);
+			out.put('.');
+			return number(100);
+		case 5:
+			number(10);
+			out.put(".5e");
+			return number(10);
+		case 6:
+			number(10);
+			return out.put('i');
+		case 7:
+			out.put('"');
+			word();
+			out.put(' ');
+			word();
+			return out.put("\\n\"");
+		case 8:
+			out.put('`');
+			word();
+			out.put('/');
+			word();
+			return out.put('`');
+		default:
+			return out.put(random_.chance(50) ? StringView { "true" } : StringView { "false" });
+		}
+	}
+
+	void arguments(Uint32 depth) {
+		out.put('(');
+		for (Uint32 i = 0, n = random_.below(4); i < n; i++) {
+			if (i) out.put(", ");
+			expr(depth);
+		}
+		out.put(')');
+	}
+
+	void call(Uint32 depth) {
+		switch (random_.below(6)) {
+		case 0:
+			out.put(random_.pick(PACKAGES));
+			out.put('.');
+			out.put(random_.pick(VERBS));
+			break;
+		case 1:
+			name();
+			out.put('.');
+			proc_name();
+			break;
+		default:
+			proc_name();
+			break;
+		}
+		arguments(depth);
+	}
+
+	// An expression which is safe to use before a '{' or 'do', i.e one which does
+	// not end in a type that could be taken as the start of a compound literal.
+	void operand(Uint32 depth) {
+		switch (depth ? random_.below(10) : 0) {
+		case 0: case 1: case 2:
+			return name();
+		case 3:
+			return literal();
+		case 4:
+			return call(depth - 1);
+		case 5:
+			name();
+			out.put('.');
+			return word();
+		case 6:
+			name();
+			out.put('[');
+			expr(depth - 1);
+			return out.put(']');
+		case 7:
+			out.put("len(");
+			name();
+			return out.put(')');
+		case 8:
+			name();
+			return out.put('^');
+		default:
+			out.put('(');
+			expr(depth - 1);
+			return out.put(')');
+		}
+	}
+
+	void condition(Uint32 depth) {
+		operand(depth);
+		out.put(' ');
+		out.put(random_.pick(COMPARISON));
+		out.put(' ');
+		operand(depth);
+		if (random_.chance(30)) {
+			out.put(random_.chance(50) ? StringView { " && " } : StringView { " || " });
+			condition(depth);
+		}
+	}
+
+	void unary(Uint32 depth) {
+		switch (depth ? random_.below(16) : 0) {
+		case 0: case 1: case 2: case 3: case 4: case 5: case 6:
+			return operand(depth);
+		case 7:
+			out.put(random_.chance(50) ? '-' : '~');
+			return operand(depth);
+		case 8:
+			out.put('!');
+			return operand(depth);
+		case 9:
+			out.put("cast(");
+			out.put(random_.pick(BUILTINS));
+			out.put(')');
+			return operand(depth - 1);
+		case 10:
+			out.put("transmute(");
+			out.put(random_.pick(INTEGERS));
+			out.put(')');
+			return operand(depth - 1);
+		case 11:
+			out.put("auto_cast ");
+			return operand(depth - 1);
+		case 12:
+			out.put('&');
+			return name();
+		case 13:
+			out.put(random_.chance(50) ? StringView { "size_of(" } : StringView { "align_of(" });
+			type(1);
+			return out.put(')');
+		case 14:
+			name();
+			out.put('[');
+			if (random_.chance(70)) expr(depth - 1);
+			out.put(':');
+			if (random_.chance(70)) expr(depth - 1);
+			return out.put(']');
+		default:
+			name();
+			if (random_.chance(50)) {
+				return out.put(".?");
+			}
+			out.put(".(");
+			out.put(random_.pick(BUILTINS));
+			return out.put(')');
+		}
+	}
+
+	void expr(Uint32 depth) {
+		unary(depth);
+		for (Uint32 i = 0, n = depth ? random_.below(3) : 0; i < n; i++) {
+			out.put(' ');
+			out.put(random_.pick(ARITHMETIC));
+			out.put(' ');
+			unary(depth - 1);
+		}
+	}
+
+	void compound(Uint32 depth) {
+		switch (random_.below(5)) {
+		case 0:
+			if (structs_) {
+				struct_name(random_.below(structs_));
+				break;
+			}
+			[[fallthrough]];
+		case 1:
+			out.put("[]");
+			out.put(random_.pick(INTEGERS));
+			break;
+		case 2:
+			out.put('[');
+			out.put(1 + random_.below(4));
+			out.put("]f32");
+			break;
+		case 3:
+			out.put("[dynamic]");
+			word();
+			out.put("{}");
+			return;
+		default:
+			out.put("map[string]int{}");
+			return;
+		}
+		out.put('{');
+		for (Uint32 i = 0, n = random_.below(5); i < n; i++) {
+			if (i) out.put(", ");
+			expr(depth);
+		}
+		out.put('}');
+	}
+
+	// The right-hand side of a declaration or assignment.
+	void value(Uint32 depth) {
+		switch (random_.below(20)) {
+		case 0: case 1:
+			return compound(depth);
+		case 2:
+			expr(depth);
+			out.put(" if ");
+			condition(depth);
+			out.put(" else ");
+			return expr(depth);
+		case 3:
+			expr(depth);
+			out.put(" when ODIN_DEBUG else ");
+			return expr(depth);
+		case 4:
+			call(depth);
+			out.put(" or_else ");
+			return expr(depth);
+		case 5:
+			call(depth);
+			return out.put(" or_return");
+		case 6:
+			return out.put("context.allocator");
+		case 7:
+			out.put("typeid_of(");
+			type(0);
+			return out.put(')');
+		default:
+			return expr(depth);
+		}
+	}
+
+	void fields(Uint32 depth) {
+		const auto first = random_.below(N_WORDS);
+		for (Uint32 i = 0, n = 1 + random_.below(8); i < n; i++) {
+			indent(depth + 1);
+			out.put(WORDS[(first + i) % N_WORDS]);
+			if (i + 1 < n && random_.chance(15)) {
+				out.put(", ");
+				out.put(WORDS[(first + ++i) % N_WORDS]);
+			}
+			out.put(": ");
+			type(0);
+			out.put(",\n");
+		}
+	}
+
+	void struct_decl(Uint32 depth) {
+		if (random_.chance(20)) {
+			indent(depth);
+			out.put("@(private)\n");
+		}
+		indent(depth);
+		struct_name(structs_++);
+		out.put(" :: struct {\n");
+		fields(depth);
+		indent(depth);
+		out.put("}\n\n");
+	}
+
+	void enum_decl(Uint32 depth) {
+		indent(depth);
+		enum_name(enums_++);
+		out.put(" :: enum ");
+		if (random_.chance(50)) {
+			out.put(random_.pick(INTEGERS));
+			out.put(' ');
+		}
+		out.put("{\n");
+		const auto first = random_.below(N_WORDS);
+		for (Uint32 i = 0, n = 2 + random_.below(10); i < n; i++) {
+			indent(depth + 1);
+			for (auto ch : WORDS[(first + i) % N_WORDS]) {
+				out.put(char(ch - 'a' + 'A'));
+			}
+			switch (random_.below(4)) {
+			case 0:
+				out.put(" = 1 << ");
+				out.put(i);
+				break;
+			case 1:
+				out.put(" = ");
+				out.put(i * 2);
+				break;
+			}
+			out.put(",\n");
+		}
+		indent(depth);
+		out.put("}\n\n");
+	}
+
+	void union_decl(Uint32 depth) {
+		indent(depth);
+		out.put(random_.pick(TYPES));
+		out.put("_Variant_");
+		number(1000);
+		out.put(" :: union {\n");
+		for (Uint32 i = 0, n = 2 + random_.below(4); i < n; i++) {
+			indent(depth + 1);
+			type(1);
+			out.put(",\n");
+		}
+		indent(depth);
+		out.put("}\n\n");
+	}
+
+	void alias_decl(Uint32 depth) {
+		indent(depth);
+		out.put(random_.pick(TYPES));
+		switch (random_.below(3)) {
+		case 0:
+			out.put("_Handle_");
+			number(1000);
+			out.put(" :: distinct ");
+			out.put(random_.pick(INTEGERS));
+			break;
+		case 1:
+			out.put("_Flags_");
+			number(1000);
+			out.put(" :: ");
+			if (enums_) {
+				out.put("bit_set[");
+				enum_name(random_.below(enums_));
+				out.put("; u32]");
+			} else {
+				out.put("distinct u32");
+			}
+			break;
+		default:
+			out.put("_Array_");
+			number(1000);
+			out.put(" :: ");
+			type(0);
+			break;
+		}
+		out.put("\n\n");
+	}
+
+	void value_decl(Uint32 depth) {
+		indent(depth);
+		switch (random_.below(3)) {
+		case 0:
+			constant_name();
+			out.put(" :: ");
+			expr(1);
+			break;
+		case 1:
+			word();
+			out.put("_global_");
+			number(1000);
+			out.put(": ");
+			type(0);
+			break;
+		default:
+			word();
+			out.put("_global_");
+			number(1000);
+			out.put(" := ");
+			literal();
+			break;
+		}
+		out.put("\n\n");
+	}
+
+	void when_decl() {
+		out.put("when ODIN_DEBUG {\n");
+		for (Uint32 i = 0, n = 1 + random_.below(3); i < n; i++) {
+			switch (random_.below(3)) {
+			case 0:
+				struct_decl(1);
+				break;
+			case 1:
+				value_decl(1);
+				break;
+			default:
+				proc_decl(1);
+				break;
+			}
+		}
+		out.put("}\n\n");
+	}
+
+	void parameters() {
+		out.put('(');
+		const auto n = random_.below(5);
+		for (Uint32 i = 0; i < n; i++) {
+			if (i) out.put(", ");
+			name();
+			if (random_.chance(20)) {
+				out.put(", ");
+				name();
+			}
+			out.put(": ");
+			type(0);
+		}
+		switch (random_.below(8)) {
+		case 0:
+			if (n) out.put(", ");
+			out.put("allocator := context.allocator");
+			break;
+		case 1:
+			if (n) out.put(", ");
+			name();
+			out.put(": int = ");
+			number(100);
+			break;
+		}
+		out.put(')');
+	}
+
+	void proc_decl(Uint32 depth) {
+		if (!depth) {
+			attributes();
+		}
+		indent(depth);
+		proc_name();
+		out.put('_');
+		number(10000);
+		out.put(" :: proc");
+		parameters();
+		out.put(" {\n");
+		body(depth + 1, 3 + random_.below(12));
+		if (random_.chance(30)) {
+			indent(depth + 1);
+			out.put("return ");
+			expr(2);
+			if (random_.chance(30)) {
+				out.put(", ");
+				expr(2);
+			}
+			out.put('\n');
+		}
+		indent(depth);
+		out.put("}\n\n");
+	}
+
+	void body(Uint32 depth, Uint32 n) {
+		for (Uint32 i = 0; i < n; i++) {
+			stmt(depth);
+		}
+	}
+
+	void block(Uint32 depth, Bool space = true) {
+		out.put(space ? StringView { " {\n" } : StringView { "{\n" });
+		// Keep nesting from running away, the deeper the fewer statements.
+		body(depth + 1, random_.below(depth < 4 ? 5 : 2));
+		indent(depth);
+		out.put('}');
+	}
+
+	// The body of a loop, which is the only place break and continue are emitted.
+	void loop(Uint32 depth) {
+		out.put(" {\n");
+		body(depth + 1, random_.below(depth < 4 ? 5 : 2));
+		if (random_.chance(25)) {
+			indent(depth + 1);
+			out.put("if ");
+			condition(2);
+			out.put(" {\n");
+			indent(depth + 2);
+			out.put(random_.chance(50) ? StringView { "break\n" } : StringView { "continue\n" });
+			indent(depth + 1);
+			out.put("}\n");
+		}
+		indent(depth);
+		out.put('}');
+	}
+
+	void stmt(Uint32 depth) {
+		const auto leaf = depth >= 6;
+		indent(depth);
+		switch (random_.below(leaf ? 8 : 20)) {
+		case 0: case 1: case 2:
+			name();
+			out.put(" := ");
+			value(2);
+			break;
+		case 3:
+			name();
+			out.put(": ");
+			type(0);
+			if (random_.chance(50)) {
+				out.put(" = ");
+				expr(2);
+			}
+			break;
+		case 4:
+			name();
+			out.put(", ");
+			name();
+			if (random_.chance(50)) {
+				out.put(" := ");
+				expr(2);
+				out.put(", ");
+				expr(2);
+			} else {
+				out.put(" = ");
+				name();
+				out.put(", ");
+				name();
+			}
+			break;
+		case 5: case 6:
+			switch (random_.below(4)) {
+			case 0:
+				name();
+				out.put('.');
+				word();
+				break;
+			case 1:
+				name();
+				out.put('[');
+				name();
+				out.put(']');
+				break;
+			case 2:
+				name();
+				out.put('^');
+				break;
+			default:
+				name();
+				break;
+			}
+			out.put(' ');
+			out.put(random_.pick(ASSIGNMENT));
+			out.put(' ');
+			expr(2);
+			break;
+		case 7:
+			call(2);
+			break;
+		case 8: case 9:
+			out.put("if ");
+			if (random_.chance(20)) {
+				name();
+				out.put(" := ");
+				call(1);
+				out.put("; ");
+			}
+			condition(2);
+			if (random_.chance(15)) {
+				out.put(" do ");
+				call(1);
+				break;
+			}
+			block(depth);
+			while (random_.chance(25)) {
+				out.put(" else if ");
+				condition(2);
+				block(depth);
+			}
+			if (random_.chance(40)) {
+				out.put(" else");
+				block(depth);
+			}
+			break;
+		case 10: case 11:
+			if (random_.chance(15)) {
+				out.put("#no_bounds_check ");
+			}
+			out.put("for ");
+			switch (random_.below(5)) {
+			case 0:
+				out.put("i := 0; i < ");
+				operand(1);
+				out.put("; i += 1");
+				break;
+			case 1:
+				out.put("i in 0");
+				out.put(random_.chance(50) ? StringView { "..<" } : StringView { "..=" });
+				operand(1);
+				break;
+			case 2:
+				word();
+				out.put(", i in ");
+				name();
+				break;
+			case 3:
+				word();
+				out.put(" in ");
+				name();
+				break;
+			default:
+				// A condition which starts with '(' is taken to be the whole of
+				// the header, the range 'in' of a later loop is then mistaken.
+				name();
+				out.put(' ');
+				out.put(random_.pick(COMPARISON));
+				out.put(' ');
+				operand(2);
+				break;
+			}
+			loop(depth);
+			break;
+		case 12:
+			out.put("when ODIN_DEBUG");
+			block(depth);
+			break;
+		case 13:
+			out.put("defer");
+			switch (random_.below(3)) {
+			case 0:
+				out.put(' ');
+				call(1);
+				break;
+			case 1:
+				out.put(" if ");
+				condition(1);
+				out.put(" do ");
+				call(1);
+				break;
+			default:
+				block(depth);
+				break;
+			}
+			break;
+		case 14:
+			if (random_.chance(30)) {
+				out.put("#no_bounds_check");
+				block(depth);
+			} else {
+				block(depth, false);
+			}
+			break;
+		case 15:
+			constant_name();
+			out.put(" :: ");
+			literal();
+			break;
+		case 16:
+			name();
+			out.put(" := proc");
+			parameters();
+			block(depth);
+			break;
+		case 17:
+			out.put("using ");
+			out.put(random_.pick(PACKAGES));
+			break;
+		default:
+			call(2);
+			break;
+		}
+		out.put('\n');
+	}
+
+	Random random_;
+	Uint32 structs_ = 0; // Structures declared so far in this file
+	Uint32 enums_   = 0; // Enumerations declared so far in this file
+};
+
+} // namespace Thor
+
+using namespace Thor;
+
+static StringView from_cstr(const char* str) {
+	Ulen length = 0;
+	while (str[length]) length++;
+	return { str, length };
+}
+
+// A size in bytes with an optional K, M or G suffix for KiB, MiB or GiB.
+static Maybe<Uint64> parse_size(StringView str) {
+	if (str.is_empty()) {
+		return {};
+	}
+	Uint64 value = 0;
+	Uint64 scale = 1;
+	for (Ulen i = 0; i < str.length(); i++) {
+		const auto ch = str[i];
+		if (ch >= '0' && ch <= '9') {
+			value = value * 10 + (ch - '0');
+			continue;
+		}
+		if (i + 1 != str.length() || i == 0) {
+			return {};
+		}
+		switch (ch) {
+		case 'K': case 'k': scale = 1_u64 << 10; break;
+		case 'M': case 'm': scale = 1_u64 << 20; break;
+		case 'G': case 'g': scale = 1_u64 << 30; break;
+		default: return {};
+		}
+	}
+	return value * scale;
+}
+
+static Bool flush(File& file, Uint64& offset, StringBuilder& builder) {
+	auto result = builder.result();
+	if (!result) {
+		return false;
+	}
+	const auto data = result->cast<const Uint8>();
+	if (file.write(offset, data) != data.length()) {
+		return false;
+	}
+	offset += data.length();
+	builder.reset();
+	return true;
+}
+
+// Usage: thor-gen [-s seed] [-f file_size] size directory
+//
+// Writes [size] bytes of Odin source to files named gen_N.odin in [directory],
+// each of them [file_size] bytes (1M by default) except maybe the last. The
+// directory must already exist. The same seed always generates the same files.
+int main(int argc, char** argv) {
+	System sys {
+		STD_FILESYSTEM,
+		STD_HEAP,
+		STD_CONSOLE,
+		STD_PROCESS,
+		STD_LINKER,
+		STD_SCHEDULER,
+		STD_CHRONO,
+	};
+
+	Uint64 seed = 0;
+	Uint64 file_size = 1_u64 << 20;
+	Maybe<Uint64> size;
+	Maybe<StringView> directory;
+	for (int i = 1; i < argc; i++) {
+		const auto arg = from_cstr(argv[i]);
+		if (arg == "-s" && i + 1 < argc) {
+			auto n = parse_size(from_cstr(argv[++i]));
+			if (!n) {
+				sys.console.write(sys, StringView { "Invalid seed\n" });
+				return 1;
+			}
+			seed = *n;
+		} else if (arg == "-f" && i + 1 < argc) {
+			// Files cannot be 4 GiB or larger since the lexer uses 32-bit offsets.
+			auto n = parse_size(from_cstr(argv[++i]));
+			if (!n || !*n || *n >= 4_u64 << 30) {
+				sys.console.write(sys, StringView { "Invalid file size\n" });
+				return 1;
+			}
+			file_size = *n;
+		} else if (!size) {
+			size = parse_size(arg);
+			if (!size) {
+				sys.console.write(sys, StringView { "Invalid size\n" });
+				return 1;
+			}
+		} else if (!directory) {
+			directory = StringView { arg };
+		} else {
+			sys.console.write(sys, StringView { "Unexpected argument\n" });
+			return 1;
+		}
+	}
+
+	if (!size || !directory) {
+		sys.console.write(sys, StringView { "Usage: thor-gen [-s seed] [-f file_size] size directory\n" });
+		return 1;
+	}
+
+	// Flush to the file in chunks so the memory used does not depend on the size
+	// of the files.
+	static constexpr const Ulen CHUNK = 1 << 20;
+
+	Generator gen{sys.allocator, seed};
+	Uint64 total = 0;
+	for (Uint64 index = 0; total < *size; index++) {
+		ScratchAllocator<1024> scratch{sys.allocator};
+		StringBuilder name{scratch};
+		name.put(*directory);
+		name.put("/gen_");
+		for (Uint64 digit = 1000; digit > 1 && index < digit; digit /= 10) {
+			name.put('0');
+		}
+		name.put(index);
+		name.put(".odin");
+		auto path = name.result();
+		if (!path) {
+			return 1;
+		}
+		auto file = File::open(sys, *path, File::Access::WR);
+		if (!file) {
+			ScratchAllocator<1024> error{sys.allocator};
+			StringBuilder message{error};
+			message.put("Could not open '");
+			message.put(*path);
+			message.put("' for writing\n");
+			if (auto result = message.result()) {
+				sys.console.write(sys, *result);
+			}
+			return 1;
+		}
+		const auto limit = *size - total < file_size ? *size - total : file_size;
+		Uint64 offset = 0;
+		gen.header();
+		for (;;) {
+			gen.decl();
+			const auto length = gen.out.result() ? gen.out.result()->length() : 0;
+			if (offset + length >= limit || length >= CHUNK) {
+				if (!flush(*file, offset, gen.out)) {
+					sys.console.write(sys, StringView { "Could not write file\n" });
+					return 1;
+				}
+				if (offset >= limit) {
+					break;
+				}
+			}
+		}
+		total += offset;
+	}
+
+	return 0;
+}
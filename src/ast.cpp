@@ -9,11 +9,52 @@
 
 namespace Thor {
 
+// The layout of a file written by AstFile::save. Everything after the header
+// is found by its offset from the start of the file so the file can be mapped
+// anywhere, and every section starts on a page so that the nodes are as aligned
+// in the mapping as they were when allocated.
+//
+// 	AstFileHeader header
+// 	AstFileSlab   slabs[popcount(header.slabs)]
+// 	char          strings[]           (page aligned)
+// 	AstID         ids[]               (page aligned)
+// 	Uint64        used[] of each slab (page aligned)
+// 	Uint8         data[] of each slab (page aligned)
+//
+// The used and data sections of a slab are the flat form from Slab::save_used
+// and Slab::save_data.
+struct AstFileSection {
+	Uint64 offset;
+	Uint64 length; // In bytes
+};
+
 struct AstFileHeader {
-	Uint8  magic[4]; // tast
-	Uint32 version;
-	Uint64 slabs;
+	Uint8          magic[4]; // tast
+	Uint32         version;
+	Uint64         size;     // Of the whole file
+	Uint64         slabs;    // Bit N is set when slab N is in the file
+	Uint64         nodes;
+	AstFileSection strings;
+	AstFileSection ids;
+	AstStringRef   filename;
+	AstIDArray     stmts;    // See AstFile::stmts
 };
+static_assert(sizeof(AstFileHeader) == 88);
+
+struct AstFileSlab {
+	Uint64         size;     // Of a node
+	Uint64         capacity; // Nodes in a cache
+	AstFileSection used;
+	AstFileSection data;
+};
+static_assert(sizeof(AstFileSlab) == 48);
+
+static constexpr const Uint32 AST_FILE_VERSION = 5;
+static constexpr const Uint64 AST_FILE_PAGE = 4096;
+
+static constexpr Uint64 ast_file_align(Uint64 offset) {
+	return (offset + AST_FILE_PAGE - 1) & ~(AST_FILE_PAGE - 1);
+}
 
 Maybe<AstFile> AstFile::create(System& sys, StringView filename) {
 	StringTable table{sys.allocator};
@@ -24,84 +65,250 @@ Maybe<AstFile> AstFile::create(System& sys, StringView filename) {
 	return AstFile { sys, move(table), ref };
 }
 
-Maybe<AstFile> AstFile::load(System& sys, Stream& stream) {
-	AstFileHeader header;
-	if (!stream.read(Slice{&header, 1}.cast<Uint8>())) {
+// The size of the nodes in each slab, zero for a slab no type of node is in.
+struct AstSlabSizes {
+	Ulen size[AstSlabID::MAX] = {};
+};
+
+template<typename... Ts>
+static constexpr AstSlabSizes ast_slab_sizes() {
+	AstSlabSizes result;
+	((result.size[AstSlabID::id<Ts>()] = sizeof(Ts)), ...);
+	return result;
+}
+
+static constexpr const auto AST_SLAB_SIZES = ast_slab_sizes<
+	AstField, AstDirective,
+	AstBinExpr, AstUnaryExpr, AstIfExpr, AstWhenExpr, AstForInExpr,
+	AstDerefExpr, AstOrReturnExpr, AstOrBreakExpr, AstOrContinueExpr,
+	AstCallExpr, AstIdentExpr, AstUndefExpr, AstContextExpr, AstProcExpr,
+	AstSliceExpr, AstIndexExpr, AstIntExpr, AstFloatExpr, AstStringExpr,
+	AstImaginaryExpr, AstCompoundExpr, AstCastExpr, AstSelectorExpr,
+	AstAccessExpr, AstAssertExpr, AstTypeExpr,
+	AstTypeIDType, AstUnionType, AstStructType, AstEnumType, AstProcType,
+	AstPtrType, AstMultiPtrType, AstSliceType, AstArrayType,
+	AstDynArrayType, AstMapType, AstMatrixType, AstBitsetType,
+	AstNamedType, AstParamType, AstParenType, AstDistinctType,
+	AstEmptyStmt, AstExprStmt, AstAssignStmt, AstBlockStmt, AstImportStmt,
+	AstPackageStmt, AstDeferStmt, AstReturnStmt, AstBreakStmt,
+	AstContinueStmt, AstFallthroughStmt, AstForeignImportStmt, AstIfStmt,
+	AstWhenStmt, AstForStmt, AstDeclStmt, AstUsingStmt, AstBadStmt>();
+
+static constexpr Hash ast_layout() {
+	auto h = FNV_OFFSET;
+	for (Uint32 i = 0; i < AstSlabID::MAX; i++) {
+		if (const auto size = AST_SLAB_SIZES.size[i]) {
+			h = hash(Uint64(size), hash(Uint64(i), h));
+		}
+	}
+	return h;
+}
+
+Hash AstFile::layout() {
+	static constexpr const auto LAYOUT = ast_layout();
+	return LAYOUT;
+}
+
+Maybe<AstFile> AstFile::map(System& sys, StringView name) {
+	auto map = FileMap::open(sys, name);
+	if (!map) {
 		return {};
 	}
-	if (header.magic != Slice{"tast"}.cast<const Uint8>()) {
+	return AstFile::map(sys, move(*map), 0);
+}
+
+Maybe<AstFile> AstFile::map(System& sys, FileMap&& map, Ulen offset) {
+	if (offset % AST_FILE_PAGE != 0 || offset > map.data().length()) {
 		return {};
 	}
-	if (header.version != 1) {
+	const auto data = map.data().slice(offset);
+	// The sections are within the file and aligned for what is in them.
+	auto section = [&](const AstFileSection& s, Ulen align) -> Maybe<Slice<const Uint8>> {
+		if (s.offset % align != 0 || s.length % align != 0
+		 || s.offset > data.length() || s.length > data.length() - s.offset)
+		{
+			return {};
+		}
+		return data.slice(Ulen(s.offset)).truncate(Ulen(s.length));
+	};
+	if (data.length() < sizeof(AstFileHeader)) {
 		return {};
 	}
-	auto string_table = StringTable::load(sys.allocator, stream);
-	if (!string_table) {
+	const auto& header = *reinterpret_cast<const AstFileHeader*>(data.data());
+	if (Slice<const Uint8>{header.magic} != Slice{"tast"}.cast<const Uint8>()) {
 		return {};
 	}
-	// Read in the filename AstStringRef which is just Uint32[2]
-	AstStringRef filename;
-	if (!stream.read(Slice{&filename, 1}.cast<Uint8>())) {
+	if (header.version != AST_FILE_VERSION || header.size != data.length()) {
 		return {};
 	}
-	// Count the # of slabs indicated by the bitset.
+	// The slabs in the file and how many there are up to the last of them.
+	Ulen n_descs = 0;
 	Ulen n_slabs = 0;
-	for (Uint64 i = 0; i < 64; i++) {
-		if ((header.slabs & (1_u64 << Uint64(i))) != 0) {
-			n_slabs++;
+	for (Uint64 i = 0; i < AstSlabID::MAX; i++) {
+		if ((header.slabs & (1_u64 << i)) != 0) {
+			n_descs++;
+			n_slabs = i + 1;
 		}
 	}
+	auto descs = section({ sizeof header, sizeof(AstFileSlab) * n_descs }, 8);
+	auto strings = section(header.strings, 1);
+	auto ids = section(header.ids, sizeof(AstID));
+	if (!descs || !strings || !ids) {
+		return {};
+	}
+	auto table = StringTable::view(sys.allocator, strings->cast<const char>());
+	const auto filename = header.filename;
+	if (filename.offset > strings->length() || filename.length > strings->length() - filename.offset) {
+		return {};
+	}
 	Array<Maybe<Slab>> slabs{sys.allocator};
 	if (!slabs.resize(n_slabs)) {
 		return {};
 	}
+	auto desc = descs->cast<const AstFileSlab>().data();
 	for (Ulen i = 0; i < n_slabs; i++) {
-		if ((header.slabs & (1_u64 << Uint64(i))) != 0) {
-			if (!slabs[i]->load(sys.allocator, stream)) {
-				return {};
-			}
+		if ((header.slabs & (1_u64 << Uint64(i))) == 0) {
+			continue;
+		}
+		auto used = section(desc->used, sizeof(Uint64));
+		auto nodes = section(desc->data, 1);
+		// The nodes are looked up with the geometry this build was compiled with.
+		if (!used || !nodes || desc->size != AST_SLAB_SIZES.size[i] || desc->capacity != AstNode::MAX) {
+			return {};
+		}
+		auto slab = Slab::view(sys.allocator,
+		                       Ulen(desc->size),
+		                       Ulen(desc->capacity),
+		                       used->cast<const Uint64>(),
+		                       *nodes);
+		if (!slab) {
+			return {};
 		}
+		slabs[i] = move(*slab);
+		desc++;
+	}
+	// Every ID in a list has to be a node in the file. The nodes themselves are
+	// not looked into, the file is trusted to be one which save() wrote.
+	const auto refs = ids->cast<const AstID>();
+	for (auto id : refs) {
+		const auto slab_idx = id.value_ / MAX;
+		if (slab_idx >= n_slabs || !slabs[slab_idx] || !slabs[slab_idx]->contains(SlabRef { id.value_ % MAX })) {
+			return {};
+		}
+	}
+	const auto stmts = header.stmts;
+	if (stmts.offset_ > refs.length() || stmts.length_ > refs.length() - stmts.offset_) {
+		return {};
 	}
-	// Read in the IDs
-	Array<AstID> ids{sys.allocator};
-	// Read the AstID list in.
 	return AstFile {
 		sys,
-		move(*string_table),
+		move(table),
 		filename,
 		move(slabs),
-		move(ids)
+		refs,
+		stmts,
+		Ulen(header.nodes),
+		move(map)
 	};
 }
 
 Bool AstFile::save(Stream& stream) const {
-	AstFileHeader header {
-		.magic   = { 't', 'a', 's', 't' },
-		.version = 1,
-		.slabs   = 0
-	};
 	// Determine which slabs are in-use. There is only 64 possible slab types
 	// due to a 6-bit AstSlabID. We can store the occupancy in one 64-bit word.
+	AstFileHeader header {
+		.magic    = { 't', 'a', 's', 't' },
+		.version  = AST_FILE_VERSION,
+		.size     = 0,
+		.slabs    = 0,
+		.nodes    = Uint64(nodes_),
+		.strings  = {},
+		.ids      = {},
+		.filename = filename_,
+		.stmts    = stmts_.id_,
+	};
+	Ulen n_slabs = 0;
 	Ulen i = 0;
 	for (const auto& slab : slabs_) {
 		if (slab) {
 			header.slabs |= 1_u64 << Uint64(i);
+			n_slabs++;
 		}
 		i++;
 	}
-	auto src = Slice{&header, 1}.cast<const Uint8>();
-	if (!stream.write(src)) {
+	// Lay the sections out before writing anything.
+	const auto strings = string_table_.data();
+	auto offset = ast_file_align(sizeof header + sizeof(AstFileSlab) * n_slabs);
+	auto place = [&](AstFileSection& section, Uint64 length) {
+		section = { offset, length };
+		offset = ast_file_align(offset + length);
+	};
+	place(header.strings, strings.length());
+	place(header.ids, ids_.length() * sizeof(AstID));
+	ScratchAllocator<4096> scratch{sys_.allocator};
+	auto descs = scratch.allocate<AstFileSlab>(n_slabs, true);
+	if (n_slabs && !descs) {
 		return false;
 	}
-	if (!string_table_.save(stream)) {
+	auto desc = descs;
+	for (const auto& slab : slabs_) {
+		if (slab) {
+			desc->size = Uint64(slab->size());
+			desc->capacity = Uint64(slab->capacity());
+			place(desc->used, slab->used_words() * sizeof(Uint64));
+			desc++;
+		}
+	}
+	desc = descs;
+	for (const auto& slab : slabs_) {
+		if (slab) {
+			place(desc->data, slab->data_bytes());
+			desc++;
+		}
+	}
+	header.size = offset;
+
+	// Then write it all out, padding each section to the start of the next.
+	Uint64 written = 0;
+	auto write = [&](Slice<const Uint8> data) {
+		written += data.length();
+		return stream.write(data);
+	};
+	auto pad = [&](const AstFileSection& section) {
+		const auto n = section.offset - written;
+		written += n;
+		return stream.zero(n);
+	};
+	if (!write(Slice{&header, 1}.cast<const Uint8>())
+	 || !write(Slice{descs, n_slabs}.cast<const Uint8>())
+	 || !pad(header.strings)
+	 || !write(strings.cast<const Uint8>())
+	 || !pad(header.ids)
+	 || !write(ids_.cast<const Uint8>()))
+	{
 		return false;
 	}
+	desc = descs;
 	for (const auto& slab : slabs_) {
-		if (slab && !slab->save(stream)) {
-			return false;
+		if (slab) {
+			if (!pad(desc->used) || !slab->save_used(stream)) {
+				return false;
+			}
+			written += desc->used.length;
+			desc++;
 		}
 	}
-	return true;
+	desc = descs;
+	for (const auto& slab : slabs_) {
+		if (slab) {
+			if (!pad(desc->data) || !slab->save_data(stream)) {
+				return false;
+			}
+			written += desc->data.length;
+			desc++;
+		}
+	}
+	// The last section is padded too so the size is a whole number of pages.
+	return pad({ header.size, 0 });
 }
 
 AstFile::~AstFile() {
@@ -110,13 +317,549 @@ AstFile::~AstFile() {
 
 AstIDArray AstFile::insert(Slice<const AstID> ids) {
 	const auto offset = ids_.length();
-	if (ids.is_empty() || !ids_.resize(offset + ids.length())) {
+	// The IDs of a mapped file are copied the first time around.
+	const auto mapped = ids_.data() != id_storage_.data();
+	if (ids.is_empty() || !id_storage_.resize(offset + ids.length())) {
 		return {};
 	}
-	memcpy(ids_.data() + offset, ids.data(), ids.length() * sizeof(AstID));
+	if (mapped) {
+		memcpy(id_storage_.data(), ids_.data(), offset * sizeof(AstID));
+	}
+	memcpy(id_storage_.data() + offset, ids.data(), ids.length() * sizeof(AstID));
+	ids_ = id_storage_.slice().cast<const AstID>();
 	return AstIDArray { Uint64(offset), Uint64(ids.length()) };
 }
 
+template<typename T>
+inline constexpr auto is_ast_ref = false;
+template<typename T>
+inline constexpr auto is_ast_ref<AstRef<T>> = true;
+template<typename T>
+inline constexpr auto is_ast_ref_array = false;
+template<typename T>
+inline constexpr auto is_ast_ref_array<AstRefArray<T>> = true;
+
+// Calls [f] with each field of the node [id] of the type in [slab] but the offset
+// and the kind, in the order they're declared in. A field is an AstRef<T> or an
+// AstRefArray<T> for children, an AstStringRef, or a Bool, an enum, a Uint64 or
+// a Float64 the node holds. A Uint32 is an offset in the source, see
+// AstProcExpr::begin and AstBadStmt::end.
+template<typename F>
+static void ast_fields(const AstFile& ast, AstID id, Uint32 slab, F&& f) {
+	switch (slab) {
+	case AstSlabID::id<AstField>():
+		{
+			const auto& n = ast[AstRef<AstField>{id}];
+			f(n.operand);
+			f(n.expr);
+		}
+		break;
+	case AstSlabID::id<AstDirective>():
+		{
+			const auto& n = ast[AstRef<AstDirective>{id}];
+			f(n.name);
+			f(n.args);
+		}
+		break;
+	case AstSlabID::id<AstBinExpr>():
+		{
+			const auto& n = ast[AstRef<AstBinExpr>{id}];
+			f(n.lhs);
+			f(n.rhs);
+			f(n.op);
+		}
+		break;
+	case AstSlabID::id<AstUnaryExpr>():
+		{
+			const auto& n = ast[AstRef<AstUnaryExpr>{id}];
+			f(n.operand);
+			f(n.op);
+		}
+		break;
+	case AstSlabID::id<AstIfExpr>():
+		{
+			const auto& n = ast[AstRef<AstIfExpr>{id}];
+			f(n.cond);
+			f(n.on_true);
+			f(n.on_false);
+		}
+		break;
+	case AstSlabID::id<AstWhenExpr>():
+		{
+			const auto& n = ast[AstRef<AstWhenExpr>{id}];
+			f(n.cond);
+			f(n.on_true);
+			f(n.on_false);
+		}
+		break;
+	case AstSlabID::id<AstForInExpr>():
+		{
+			const auto& n = ast[AstRef<AstForInExpr>{id}];
+			f(n.lhs);
+			f(n.rhs);
+		}
+		break;
+	case AstSlabID::id<AstDerefExpr>():
+		f(ast[AstRef<AstDerefExpr>{id}].operand);
+		break;
+	case AstSlabID::id<AstOrReturnExpr>():
+		f(ast[AstRef<AstOrReturnExpr>{id}].operand);
+		break;
+	case AstSlabID::id<AstOrBreakExpr>():
+		f(ast[AstRef<AstOrBreakExpr>{id}].operand);
+		break;
+	case AstSlabID::id<AstOrContinueExpr>():
+		f(ast[AstRef<AstOrContinueExpr>{id}].operand);
+		break;
+	case AstSlabID::id<AstCallExpr>():
+		{
+			const auto& n = ast[AstRef<AstCallExpr>{id}];
+			f(n.operand);
+			f(n.args);
+		}
+		break;
+	case AstSlabID::id<AstIdentExpr>():
+		f(ast[AstRef<AstIdentExpr>{id}].ident);
+		break;
+	case AstSlabID::id<AstProcExpr>():
+		{
+			const auto& n = ast[AstRef<AstProcExpr>{id}];
+			f(n.type);
+			f(n.body);
+			f(n.begin);
+			f(n.end);
+		}
+		break;
+	case AstSlabID::id<AstSliceExpr>():
+		{
+			const auto& n = ast[AstRef<AstSliceExpr>{id}];
+			f(n.operand);
+			f(n.lhs);
+			f(n.rhs);
+		}
+		break;
+	case AstSlabID::id<AstIndexExpr>():
+		{
+			const auto& n = ast[AstRef<AstIndexExpr>{id}];
+			f(n.operand);
+			f(n.lhs);
+			f(n.rhs);
+		}
+		break;
+	case AstSlabID::id<AstIntExpr>():
+		f(ast[AstRef<AstIntExpr>{id}].value);
+		break;
+	case AstSlabID::id<AstFloatExpr>():
+		f(ast[AstRef<AstFloatExpr>{id}].value);
+		break;
+	case AstSlabID::id<AstStringExpr>():
+		f(ast[AstRef<AstStringExpr>{id}].value);
+		break;
+	case AstSlabID::id<AstImaginaryExpr>():
+		f(ast[AstRef<AstImaginaryExpr>{id}].value);
+		break;
+	case AstSlabID::id<AstCompoundExpr>():
+		f(ast[AstRef<AstCompoundExpr>{id}].fields);
+		break;
+	case AstSlabID::id<AstCastExpr>():
+		{
+			const auto& n = ast[AstRef<AstCastExpr>{id}];
+			f(n.type);
+			f(n.expr);
+		}
+		break;
+	case AstSlabID::id<AstSelectorExpr>():
+		f(ast[AstRef<AstSelectorExpr>{id}].name);
+		break;
+	case AstSlabID::id<AstAccessExpr>():
+		{
+			const auto& n = ast[AstRef<AstAccessExpr>{id}];
+			f(n.operand);
+			f(n.field);
+			f(n.is_arrow);
+		}
+		break;
+	case AstSlabID::id<AstAssertExpr>():
+		{
+			const auto& n = ast[AstRef<AstAssertExpr>{id}];
+			f(n.operand);
+			f(n.type);
+		}
+		break;
+	case AstSlabID::id<AstTypeExpr>():
+		f(ast[AstRef<AstTypeExpr>{id}].type);
+		break;
+	case AstSlabID::id<AstUnionType>():
+		f(ast[AstRef<AstUnionType>{id}].types);
+		break;
+	case AstSlabID::id<AstStructType>():
+		f(ast[AstRef<AstStructType>{id}].decls);
+		break;
+	case AstSlabID::id<AstEnumType>():
+		{
+			const auto& n = ast[AstRef<AstEnumType>{id}];
+			f(n.base);
+			f(n.enums);
+		}
+		break;
+	case AstSlabID::id<AstProcType>():
+		{
+			const auto& n = ast[AstRef<AstProcType>{id}];
+			f(n.fields);
+			f(n.types);
+		}
+		break;
+	case AstSlabID::id<AstPtrType>():
+		f(ast[AstRef<AstPtrType>{id}].base);
+		break;
+	case AstSlabID::id<AstMultiPtrType>():
+		f(ast[AstRef<AstMultiPtrType>{id}].base);
+		break;
+	case AstSlabID::id<AstSliceType>():
+		f(ast[AstRef<AstSliceType>{id}].base);
+		break;
+	case AstSlabID::id<AstArrayType>():
+		{
+			const auto& n = ast[AstRef<AstArrayType>{id}];
+			f(n.size);
+			f(n.base);
+		}
+		break;
+	case AstSlabID::id<AstDynArrayType>():
+		f(ast[AstRef<AstDynArrayType>{id}].base);
+		break;
+	case AstSlabID::id<AstMapType>():
+		{
+			const auto& n = ast[AstRef<AstMapType>{id}];
+			f(n.kt);
+			f(n.vt);
+		}
+		break;
+	case AstSlabID::id<AstMatrixType>():
+		{
+			const auto& n = ast[AstRef<AstMatrixType>{id}];
+			f(n.rows);
+			f(n.cols);
+			f(n.base);
+		}
+		break;
+	case AstSlabID::id<AstBitsetType>():
+		{
+			const auto& n = ast[AstRef<AstBitsetType>{id}];
+			f(n.expr);
+			f(n.type);
+		}
+		break;
+	case AstSlabID::id<AstNamedType>():
+		{
+			const auto& n = ast[AstRef<AstNamedType>{id}];
+			f(n.pkg);
+			f(n.name);
+		}
+		break;
+	case AstSlabID::id<AstParamType>():
+		{
+			const auto& n = ast[AstRef<AstParamType>{id}];
+			f(n.name);
+			f(n.exprs);
+		}
+		break;
+	case AstSlabID::id<AstParenType>():
+		f(ast[AstRef<AstParenType>{id}].type);
+		break;
+	case AstSlabID::id<AstDistinctType>():
+		f(ast[AstRef<AstDistinctType>{id}].type);
+		break;
+	case AstSlabID::id<AstExprStmt>():
+		f(ast[AstRef<AstExprStmt>{id}].expr);
+		break;
+	case AstSlabID::id<AstAssignStmt>():
+		{
+			const auto& n = ast[AstRef<AstAssignStmt>{id}];
+			f(n.lhs);
+			f(n.rhs);
+			f(n.kind);
+		}
+		break;
+	case AstSlabID::id<AstBlockStmt>():
+		f(ast[AstRef<AstBlockStmt>{id}].stmts);
+		break;
+	case AstSlabID::id<AstImportStmt>():
+		{
+			const auto& n = ast[AstRef<AstImportStmt>{id}];
+			f(n.alias);
+			f(n.expr);
+		}
+		break;
+	case AstSlabID::id<AstPackageStmt>():
+		f(ast[AstRef<AstPackageStmt>{id}].name);
+		break;
+	case AstSlabID::id<AstDeferStmt>():
+		f(ast[AstRef<AstDeferStmt>{id}].stmt);
+		break;
+	case AstSlabID::id<AstReturnStmt>():
+		f(ast[AstRef<AstReturnStmt>{id}].exprs);
+		break;
+	case AstSlabID::id<AstBreakStmt>():
+		f(ast[AstRef<AstBreakStmt>{id}].label);
+		break;
+	case AstSlabID::id<AstContinueStmt>():
+		f(ast[AstRef<AstContinueStmt>{id}].label);
+		break;
+	case AstSlabID::id<AstForeignImportStmt>():
+		{
+			const auto& n = ast[AstRef<AstForeignImportStmt>{id}];
+			f(n.ident);
+			f(n.names);
+		}
+		break;
+	case AstSlabID::id<AstIfStmt>():
+		{
+			const auto& n = ast[AstRef<AstIfStmt>{id}];
+			f(n.init);
+			f(n.cond);
+			f(n.on_true);
+			f(n.on_false);
+		}
+		break;
+	case AstSlabID::id<AstWhenStmt>():
+		{
+			const auto& n = ast[AstRef<AstWhenStmt>{id}];
+			f(n.cond);
+			f(n.on_true);
+			f(n.on_false);
+		}
+		break;
+	case AstSlabID::id<AstForStmt>():
+		{
+			const auto& n = ast[AstRef<AstForStmt>{id}];
+			f(n.in);
+			f(n.init);
+			f(n.cond);
+			f(n.post);
+			f(n.body);
+		}
+		break;
+	case AstSlabID::id<AstDeclStmt>():
+		{
+			const auto& n = ast[AstRef<AstDeclStmt>{id}];
+			f(n.is_const);
+			f(n.is_using);
+			f(n.lhs);
+			f(n.type);
+			f(n.rhs);
+			f(n.directives);
+			f(n.attributes);
+		}
+		break;
+	case AstSlabID::id<AstUsingStmt>():
+		f(ast[AstRef<AstUsingStmt>{id}].expr);
+		break;
+	case AstSlabID::id<AstBadStmt>():
+		f(ast[AstRef<AstBadStmt>{id}].end);
+		break;
+
+	default:
+		// The rest hold nothing but their offset.
+		break;
+	}
+}
+
+Bool AstWalker::push(Slice<const AstID> roots) {
+	// Pushed in reverse so the first of them is on top.
+	for (Ulen i = roots.length(); i-- > 0; /**/) {
+		const auto id = roots[i];
+		if (id && !stack_.push_back(Node { id, 0, id.value_ / AstFile::MAX })) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Maybe<AstWalker::Node> AstWalker::next() {
+	if (last_) {
+		const auto node = *last_;
+		last_.reset();
+		if (!expand(node)) {
+			failed_ = true;
+			return {};
+		}
+	}
+	if (stack_.is_empty()) {
+		return {};
+	}
+	auto node = stack_.last();
+	stack_.pop_back();
+	last_.emplace(node);
+	return node;
+}
+
+Bool AstWalker::flatten(Array<Node>& nodes) {
+	while (auto node = next()) {
+		if (!nodes.push_back(*node)) {
+			return false;
+		}
+	}
+	return !failed_;
+}
+
+Bool AstWalker::expand(const Node& node) {
+	const auto base = stack_.length();
+	const auto depth = node.depth + 1;
+	Bool ok = true;
+	auto one = [&](AstID id) {
+		if (id) {
+			ok = ok && stack_.push_back(Node { id, depth, id.value_ / AstFile::MAX });
+		}
+	};
+	ast_fields(ast_, node.id, node.slab, [&]<typename T>(const T& field) {
+		if constexpr (is_ast_ref<T>) {
+			one(field.id_);
+		} else if constexpr (is_ast_ref_array<T>) {
+			for (const auto ref : ast_[field]) {
+				one(ref.id_);
+			}
+		}
+	});
+	// Pushed in order, so reverse them to have the first child on top.
+	for (Ulen i = base, j = stack_.length(); i + 1 < j; i++, j--) {
+		const auto tmp = stack_[i];
+		stack_[i] = stack_[j - 1];
+		stack_[j - 1] = tmp;
+	}
+	return ok;
+}
+
+AstID AstFile::intern(AstID id) {
+	// What a node holds, where a child is its AstID and a string is where it is
+	// in the string table, which has every string in it once.
+	auto content = [&](AstID id, Array<Uint64>& words) {
+		const auto slab = id.value_ / MAX;
+		Bool ok = words.push_back(slab);
+		ast_fields(*this, id, slab, [&]<typename T>(const T& field) {
+			if constexpr (is_ast_ref<T>) {
+				ok = ok && words.push_back(field.id_.value_);
+			} else if constexpr (is_ast_ref_array<T>) {
+				ok = ok && words.push_back(field.length());
+				for (const auto ref : (*this)[field]) {
+					ok = ok && words.push_back(ref.id_.value_);
+				}
+			} else if constexpr (is_same<T, AstStringRef>) {
+				ok = ok && words.push_back(Uint64(field.offset) << 32 | field.length);
+			} else if constexpr (is_same<T, Float64>) {
+				Uint64 bits = 0;
+				Allocator::memcopy(Address(&bits), Address(&field), sizeof bits);
+				ok = ok && words.push_back(bits);
+			} else {
+				ok = ok && words.push_back(Uint64(field));
+			}
+		});
+		return ok;
+	};
+	// Not sharing a node is never wrong, so running out of memory is not either.
+	ScratchAllocator<1024> scratch{sys_.allocator};
+	Array<Uint64> words{scratch};
+	if (!content(id, words)) {
+		return id;
+	}
+	const auto key = words.slice().hash();
+	if (auto find = interned_.find(key)) {
+		const auto other = AstID { find->v };
+		Array<Uint64> other_words{scratch};
+		if (content(other, other_words) && other_words.slice() == words.slice()) {
+			destroy(id);
+			return other;
+		}
+		// Another node with the same hash, this one is not shared.
+		return id;
+	}
+	interned_.insert(key, id.value_);
+	return id;
+}
+
+Hash AstHasher::find(AstID id) const {
+	const auto slab = id.value_ / AstFile::MAX;
+	const auto index = id.value_ % AstFile::MAX;
+	if (slab >= hashes_.length() || index >= hashes_[slab].length()) {
+		return 0;
+	}
+	return hashes_[slab][index];
+}
+
+Maybe<Hash> AstHasher::hash(AstID id) {
+	if (auto h = find(id)) {
+		return h;
+	}
+	AstWalker walker{ast_, allocator_};
+	const AstRef<AstNode> roots[] = { AstRef<AstNode>{id} };
+	if (!walker.push(Slice{roots})) {
+		return {};
+	}
+	nodes_.clear();
+	while (auto node = walker.next()) {
+		// The trees under the nodes hashed before are as well.
+		if (find(node->id)) {
+			walker.skip();
+		} else if (!nodes_.push_back(*node)) {
+			return {};
+		}
+	}
+	if (walker.failed()) {
+		return {};
+	}
+	// Every child of a node is after it in preorder, so it's hashed before it. A
+	// node shared by more than one parent is walked and hashed more than once.
+	for (Ulen i = nodes_.length(); i-- > 0; /**/) {
+		const auto& node = nodes_[i];
+		const auto index = node.id.value_ % AstFile::MAX;
+		while (node.slab >= hashes_.length()) {
+			if (!hashes_.emplace_back(allocator_)) {
+				return {};
+			}
+		}
+		auto& hashes = hashes_[node.slab];
+		if (index >= hashes.length() && !hashes.resize(index + 1)) {
+			return {};
+		}
+		// Zero is for none.
+		const auto h = combine(node);
+		hashes[index] = h | (h == 0);
+	}
+	return find(id);
+}
+
+Hash AstHasher::combine(const AstWalker::Node& node) const {
+	// Which of a nil child or an absent string it is, is known by the field.
+	static constexpr const Hash NIL = 0;
+	auto h = Thor::hash(Uint64(node.slab));
+	auto child = [&](AstID id) {
+		return id ? find(id) : NIL;
+	};
+	ast_fields(ast_, node.id, node.slab, [&]<typename T>(const T& field) {
+		if constexpr (is_ast_ref<T>) {
+			h = Thor::hash(child(field.id_), h);
+		} else if constexpr (is_ast_ref_array<T>) {
+			h = Thor::hash(Uint64(field.length()), h);
+			for (const auto ref : ast_[field]) {
+				h = Thor::hash(child(ref.id_), h);
+			}
+		} else if constexpr (is_same<T, AstStringRef>) {
+			h = field ? ast_[field].hash(Thor::hash(Uint64(field.length), h)) : Thor::hash(NIL, h);
+		} else if constexpr (is_same<T, Float64>) {
+			Uint64 bits = 0;
+			Allocator::memcopy(Address(&bits), Address(&field), sizeof bits);
+			h = Thor::hash(bits, h);
+		} else if constexpr (is_same<T, Uint32>) {
+			// Only a node for source which was never parsed holds an offset, the
+			// source is not compared so it is unique by its AstID.
+			h = Thor::hash(Uint64(field ? node.id.value_ : 0_u32), h);
+		} else {
+			h = Thor::hash(Uint64(field), h);
+		}
+	});
+	return h;
+}
+
 // Stmt
 void AstStmt::dump(const AstFile& ast, StringBuilder& builder, Ulen nest) const {
 	using enum Kind;
@@ -138,6 +881,7 @@ void AstStmt::dump(const AstFile& ast, StringBuilder& builder, Ulen nest) const
 	case FOR:           return to_stmt<const AstForStmt>()->dump(ast, builder, nest);
 	case DECL:          return to_stmt<const AstDeclStmt>()->dump(ast, builder, nest);
 	case USING:         return to_stmt<const AstUsingStmt>()->dump(ast, builder, nest);
+	case BAD:           return to_stmt<const AstBadStmt>()->dump(ast, builder, nest);
 	}
 }
 
@@ -428,6 +1172,11 @@ void AstUsingStmt::dump(const AstFile& ast, StringBuilder& builder, Ulen nest) c
 	ast[expr].dump(ast, builder);
 }
 
+void AstBadStmt::dump(const AstFile&, StringBuilder& builder, Ulen nest) const {
+	builder.rep(nest * 2, ' ');
+	builder.put("<bad>");
+}
+
 // Expr
 void AstExpr::dump(const AstFile& ast, StringBuilder& builder) const {
 	using enum Kind;
@@ -576,7 +1325,11 @@ void AstContextExpr::dump(const AstFile&, StringBuilder& builder) const {
 
 void AstProcExpr::dump(const AstFile& ast, StringBuilder& builder) const {
 	ast[type].dump(ast, builder);
-	ast[body].dump(ast, builder, 0);
+	if (body) {
+		ast[body].dump(ast, builder, 0);
+	} else {
+		builder.put("{...}");
+	}
 }
 
 void AstSliceExpr::dump(const AstFile& ast, StringBuilder& builder) const {
@@ -1,9 +1,11 @@
 #ifndef THOR_AST_H
 #define THOR_AST_H
 #include "util/slab.h"
+#include "util/map.h"
 #include "util/string.h"
 #include "util/assert.h"
 #include "util/system.h"
+#include "util/file.h"
 
 #include "lexer.h"
 
@@ -61,24 +63,19 @@ private:
 	AstIDArray id_;
 };
 
+// Each type of node is kept in a slab of its own. The index of that slab is
+// fixed at compile-time by the kind of the node so that the same type of node
+// is always in the same slab no matter the order the types were first used in
+// or which thread made them.
 struct AstSlabID {
 	// Only 6-bit slab index (2^6 = 64)
 	static inline constexpr const auto MAX = 64_u32;
 	template<typename T>
-	static Uint32 id([[maybe_unused]] System& sys) {
-		static const Uint32 id = s_id++;
-		// We've run out of IDs for slabs. This indicates that there are too many
-		// distinct types and they will need to be consolidated. The scheme used by
-		// this representation can only support up to [MAX] unique types.
-		THOR_ASSERT(sys, id <= MAX);
-		return id;
-	}
-private:
-	static inline Uint32 s_id;
+	static constexpr Uint32 id();
 };
 
 struct AstNode {
-	// Only 12-bit node index (2^12 = 2048)
+	// Only 12-bit node index (2^12 = 4096)
 	static inline constexpr const auto MAX = 4096_u32;
 	constexpr AstNode(Uint32 offset)
 		: offset{offset}
@@ -106,6 +103,8 @@ private:
 	template<typename>
 	friend struct AstRef;
 	friend struct AstFile;
+	friend struct AstWalker;
+	friend struct AstHasher;
 	Uint32 value_ = ~0_u32;
 };
 static_assert(sizeof(AstID) == 4);
@@ -132,6 +131,8 @@ struct AstRef {
 	}
 private:
 	friend struct AstFile;
+	friend struct AstWalker;
+	friend struct AstHasher;
 	AstID id_;
 };
 
@@ -384,17 +385,24 @@ struct AstContextExpr : AstExpr {
 };
 
 // Represents a procedure literal expression.
+// The body of a procedure can be skipped when parsing, in which case [body] is
+// nil and the source of the body is [begin, end) so that it can be lexed and
+// parsed later on with Parser::parse_body.
 struct AstProcExpr : AstExpr {
 	static constexpr const auto KIND = Kind::PROC;
-	constexpr AstProcExpr(Uint32 offset, AstRef<AstProcType> type, AstRef<AstBlockStmt> body)
+	constexpr AstProcExpr(Uint32 offset, AstRef<AstProcType> type, AstRef<AstBlockStmt> body, Uint32 begin = 0, Uint32 end = 0)
 		: AstExpr{offset, KIND}
 		, type{type}
 		, body{body}
+		, begin{begin}
+		, end{end}
 	{
 	}
 	void dump(const AstFile& ast, StringBuilder& builder) const;
 	AstRef<AstProcType>   type;
 	AstRef<AstBlockStmt>  body;
+	Uint32                begin; // Offset of the '{' of the skipped body or zero
+	Uint32                end;   // Offset just past its '}'
 };
 
 // Represents a slice expression, e.g:
@@ -893,6 +901,7 @@ struct AstStmt : AstNode {
 		FOR,
 		DECL,
 		USING,
+		BAD,
 	};
 
 	constexpr AstStmt(Uint32 offset, Kind kind)
@@ -1171,6 +1180,80 @@ struct AstUsingStmt : AstStmt {
 	AstRef<AstExpr> expr;
 };
 
+// Stands in for a statement which could not be parsed. The parser skips over
+// the rest of it, up to where the next statement should begin, so that it can
+// carry on and find the errors after it too. The source of it is [offset, end).
+struct AstBadStmt : AstStmt {
+	static constexpr const auto KIND = Kind::BAD;
+	constexpr AstBadStmt(Uint32 offset, Uint32 end)
+		: AstStmt{offset, KIND}
+		, end{end}
+	{
+	}
+	void dump(const AstFile& ast, StringBuilder& builder, Ulen nest) const;
+	Uint32 end;
+};
+
+// AstField and AstDirective come first, followed by each kind of AstExpr, then
+// AstType and then AstStmt in the order of their Kind.
+template<typename T>
+constexpr Uint32 AstSlabID::id() {
+	constexpr const auto EXPRS = 2_u32;
+	constexpr const auto TYPES = EXPRS + Uint32(AstExpr::Kind::TYPE) + 1;
+	constexpr const auto STMTS = TYPES + Uint32(AstType::Kind::DISTINCT) + 1;
+	// We've run out of IDs for slabs. This indicates that there are too many
+	// distinct types and they will need to be consolidated. The scheme used by
+	// this representation can only support up to [MAX] unique types.
+	static_assert(STMTS + Uint32(AstStmt::Kind::BAD) < MAX, "Too many types of Ast node");
+	if constexpr (is_same<T, AstField>) {
+		return 0;
+	} else if constexpr (is_same<T, AstDirective>) {
+		return 1;
+	} else if constexpr (DerivedFrom<T, AstExpr>) {
+		return EXPRS + Uint32(T::KIND);
+	} else if constexpr (DerivedFrom<T, AstType>) {
+		return TYPES + Uint32(T::KIND);
+	} else {
+		static_assert(DerivedFrom<T, AstStmt>, "Not an Ast node");
+		return STMTS + Uint32(T::KIND);
+	}
+}
+
+// A type of node with a slab of its own rather than one of the bases a node of
+// any of the kinds derived from it can be referred to as.
+template<typename T>
+concept AstConcrete = is_same<T, AstField> || is_same<T, AstDirective> || requires { T::KIND; };
+static_assert(!AstConcrete<AstNode> && !AstConcrete<AstExpr> && !AstConcrete<AstType> && !AstConcrete<AstStmt>);
+static_assert(AstConcrete<AstIdentExpr> && AstConcrete<AstNamedType> && AstConcrete<AstIfStmt>);
+
+// The types of node AstFile::create() shares when interning. Those are the leaves
+// and the types made of other types, which are the same type wherever they are
+// written. A struct, union, enum or distinct type is a new type each time it is
+// written so those are never shared, nor is a procedure, which the parser fills
+// in after making it.
+template<typename T>
+concept AstInternable = is_same<T, AstIdentExpr>
+                     || is_same<T, AstUndefExpr>
+                     || is_same<T, AstContextExpr>
+                     || is_same<T, AstIntExpr>
+                     || is_same<T, AstFloatExpr>
+                     || is_same<T, AstStringExpr>
+                     || is_same<T, AstImaginaryExpr>
+                     || is_same<T, AstSelectorExpr>
+                     || is_same<T, AstTypeIDType>
+                     || is_same<T, AstNamedType>
+                     || is_same<T, AstParamType>
+                     || is_same<T, AstParenType>
+                     || is_same<T, AstPtrType>
+                     || is_same<T, AstMultiPtrType>
+                     || is_same<T, AstSliceType>
+                     || is_same<T, AstArrayType>
+                     || is_same<T, AstDynArrayType>
+                     || is_same<T, AstMapType>
+                     || is_same<T, AstMatrixType>
+                     || is_same<T, AstBitsetType>
+                     || is_same<T, AstProcType>;
+
 // It is important that none of the Ast node types are polymorphic because they
 // can be serialized as nothing more than a flat array of bytes. This series of
 // static asserts checks that. If you're reading this it's because you added a
@@ -1202,25 +1285,50 @@ static_assert(!is_polymorphic<AstContinueStmt>, "Cannot be polymorphic");
 static_assert(!is_polymorphic<AstFallthroughStmt>, "Cannot be polymorphic");
 static_assert(!is_polymorphic<AstIfStmt>, "Cannot be polymorphic");
 static_assert(!is_polymorphic<AstDeclStmt>, "Cannot be polymorphic");
+static_assert(!is_polymorphic<AstBadStmt>, "Cannot be polymorphic");
 
 struct AstFile {
 	static Maybe<AstFile> create(System& sys, StringView filename);
-	static Maybe<AstFile> load(System& sys, Stream& stream);
 
+	// Map a file written by save() into memory. Nothing is read or copied, the
+	// nodes, the IDs and the strings are used right where they are in the mapping
+	// once the layout of the file has been checked. A mapped file is read-only,
+	// anything created or inserted after is kept on the side.
+	static Maybe<AstFile> map(System& sys, StringView name);
+	// The same for a file written by save() at [offset] into [map], which has to
+	// be a multiple of the page size, e.g after a header of some other format.
+	static Maybe<AstFile> map(System& sys, FileMap&& map, Ulen offset);
+
+	// The file is a header followed by sections which are each aligned to a page
+	// and found by their offset from the start. See ast.cpp for the layout.
 	Bool save(Stream& stream) const;
 
 	StringView filename() const {
 		return string_table_[filename_];
 	}
 
+	// The top-level statements of the file, saved with it.
+	[[nodiscard]] THOR_FORCEINLINE constexpr AstRefArray<AstStmt> stmts() const {
+		return stmts_;
+	}
+	void stmts(AstRefArray<AstStmt> stmts) {
+		stmts_ = stmts;
+	}
+
+	// A hash of the slab every type of node is in and the size of each. A file
+	// saved by a build with another layout cannot be mapped by this one.
+	static Hash layout();
+
 	AstFile(AstFile&&) = default;
 	~AstFile();
 
 	static inline constexpr const auto MAX = AstID::MAX * AstNode::MAX;
+	static_assert((AstID::MAX & (AstID::MAX - 1)) == 0 && (AstNode::MAX & (AstNode::MAX - 1)) == 0,
+	              "Decoding an AstID has to be shifts and masks");
 
 	template<typename T, typename... Ts>
 	AstRef<T> create(Ts&&... args) {
-		auto slab_idx = AstSlabID::id<T>(sys_);
+		constexpr const auto slab_idx = AstSlabID::id<T>();
 		if (slab_idx >= slabs_.length() && !slabs_.resize(slab_idx + 1)) {
 			return {};
 		}
@@ -1230,17 +1338,74 @@ struct AstFile {
 		}
 		if (auto slab_ref = slab->allocate()) {
 			new ((*slab)[*slab_ref], Nat{}) T{forward<Ts>(args)...};
-			return AstID { slab_idx * MAX + slab_ref->index };
+			nodes_++;
+			const auto id = AstID { slab_idx * MAX + slab_ref->index };
+			if constexpr (AstInternable<T>) {
+				if (intern_) {
+					if (const auto found = intern(id); found.value_ != id.value_) {
+						return found;
+					}
+				}
+			}
+			if (log_ && !log_->push_back(id)) {
+				return {};
+			}
+			return id;
 		}
 		return {};
 	}
 
-	// Lookup an Ast node by AstRef
+	// Free the node [id] made with create(), nothing may refer to it any longer.
+	void destroy(AstID id) {
+		slabs_[id.value_ / MAX]->deallocate(SlabRef { id.value_ % MAX });
+		nodes_--;
+	}
+
+	// Append the ID of every node made with create() to [log] from now on, or stop
+	// when [log] is nullptr.
+	void track(Array<AstID>* log) {
+		log_ = log;
+	}
+
+	// Have create() give the node made before rather than a new one when it makes
+	// an AstInternable equal to it, i.e of the same type and holding the same
+	// values, strings and children. The children are compared by AstID so a tree
+	// is shared bottom-up as it's made. A node shared this way is given for each
+	// place it's written, so it has the offset of the first of them, and must not
+	// be changed nor destroyed after.
+	void intern(Bool intern) {
+		intern_ = intern;
+	}
+	[[nodiscard]] THOR_FORCEINLINE constexpr Bool interning() const {
+		return intern_;
+	}
+
+	// The number of nodes made with create().
+	[[nodiscard]] THOR_FORCEINLINE constexpr Ulen nodes() const {
+		return nodes_;
+	}
+
+	// Lookup an Ast node by AstRef. The size of a concrete type of node is known
+	// so only a reference to one of the bases needs the size from the slab.
 	template<typename T>
 	THOR_FORCEINLINE constexpr const T& operator[](AstRef<T> ref) const {
 		const auto slab_idx = ref.id_.value_ / MAX;
-		const auto slab_ref = ref.id_.value_ % MAX;
-		return *reinterpret_cast<const T*>((*slabs_[slab_idx])[SlabRef { slab_ref }]);
+		const auto slab_ref = SlabRef { ref.id_.value_ % MAX };
+		if constexpr (AstConcrete<T>) {
+			return *reinterpret_cast<const T*>(slabs_[slab_idx]->template at<sizeof(T), AstNode::MAX>(slab_ref));
+		} else {
+			return *reinterpret_cast<const T*>((*slabs_[slab_idx])[slab_ref]);
+		}
+	}
+	template<typename T>
+	THOR_FORCEINLINE constexpr T& operator[](AstRef<T> ref) {
+		const auto slab_idx = ref.id_.value_ / MAX;
+		const auto slab_ref = SlabRef { ref.id_.value_ % MAX };
+		if constexpr (AstConcrete<T>) {
+			return *reinterpret_cast<T*>(slabs_[slab_idx]->template at<sizeof(T), AstNode::MAX>(slab_ref));
+		} else {
+			return *reinterpret_cast<T*>((*slabs_[slab_idx])[slab_ref]);
+		}
 	}
 
 	// Lookup a StringView by AstStringRef
@@ -1250,8 +1415,7 @@ struct AstFile {
 	// Lookup a Slice<AstRef<T>> by AstRefArray
 	template<typename T>
 	[[nodiscard]] constexpr Slice<const AstRef<T>> operator[](AstRefArray<T> ref) const {
-		return ids_.slice()
-		           .slice(ref.id_.offset_)
+		return ids_.slice(ref.id_.offset_)
 		           .truncate(ref.id_.length_)
 		           .template cast<const AstRef<T>>();
 	}
@@ -1266,6 +1430,13 @@ struct AstFile {
 		return insert(ids);
 	}
 
+	// The same as above for a list of nodes which are all a T.
+	template<typename T>
+	[[nodiscard]] THOR_FORCEINLINE AstRefArray<T> insert(Slice<const AstRef<AstNode>> refs) {
+		const auto ids = refs.template cast<const AstID>();
+		return insert(ids);
+	}
+
 	[[nodiscard]] THOR_FORCEINLINE const StringTable& string_table() const {
 		return string_table_;
 	}
@@ -1273,21 +1444,31 @@ struct AstFile {
 private:
 	[[nodiscard]] AstIDArray insert(Slice<const AstID> ids);
 
+	// The node equal to [id] made before, in which case [id] is destroyed, or [id]
+	// when there is none.
+	AstID intern(AstID id);
+
 	AstFile(System& sys, StringTable&& string_table, AstStringRef filename)
 		: sys_{sys}
 		, string_table_{move(string_table)}
 		, filename_{filename}
 		, slabs_{sys.allocator}
-		, ids_{sys.allocator}
+		, id_storage_{sys.allocator}
+		, interned_{sys.allocator}
 	{
 	}
 
-	AstFile(System& sys, StringTable&& string_table, AstStringRef filename, Array<Maybe<Slab>>&& slabs, Array<AstID>&& ids)
+	AstFile(System& sys, StringTable&& string_table, AstStringRef filename, Array<Maybe<Slab>>&& slabs, Slice<const AstID> ids, AstRefArray<AstStmt> stmts, Ulen nodes, FileMap&& map)
 		: sys_{sys}
 		, string_table_{move(string_table)}
 		, filename_{filename}
 		, slabs_{move(slabs)}
-		, ids_{move(ids)}
+		, stmts_{stmts}
+		, ids_{ids}
+		, id_storage_{sys.allocator}
+		, nodes_{nodes}
+		, map_{move(map)}
+		, interned_{sys.allocator}
 	{
 	}
 
@@ -1299,19 +1480,130 @@ private:
 	//  * AstRef<T> is a typed AstID which indexes [slab_] based on the type,
 	//    which then further indexes [Slab::caches_], which then further indexes
 	//    [Pool::data_]. The triple indirection works by decomposing a single
-	//    Uint32 index into a 6-bit [slab_] index. A 12-bit [Slab::caches_] index,
-	//    and a 14-bit [Pool::data_] index. You can think of reading the data for
+	//    Uint32 index into a 6-bit [slab_] index. A 14-bit [Slab::caches_] index,
+	//    and a 12-bit [Pool::data_] index. You can think of reading the data for
 	//    a AstRef<T> or AstID as slabs_[d0(id)].caches_[d1(id)].data_[d2(id)]
-	//    where d0, d1, and d2 are decoding functions which take 6, 12 and 14 bits
-	//    from the 32-bit [id] respectively.
+	//    where d0, d1, and d2 are decoding functions which take 6, 14 and 12 bits
+	//    from the 32-bit [id] respectively. Every one of those is a power of two
+	//    so each is a shift and a mask, and for a concrete T the size of the node
+	//    is a constant as well.
 	//  * AstRefArray<T> is a typed AstIDArray which indexes [ids_] based on an
 	//    offset and length stored in the AstRefArray itself. The [ids_] array is
-	//    just an array of AstID, i.e Uint32.
-	System&            sys_;
-	StringTable        string_table_;
-	AstStringRef       filename_;
-	Array<Maybe<Slab>> slabs_;
-	Array<AstID>       ids_;
+	//    just an array of AstID, i.e Uint32. It's [id_storage_] or for a mapped
+	//    file in [map_] until the first insert copies it to [id_storage_].
+	System&              sys_;
+	StringTable          string_table_;
+	AstStringRef         filename_;
+	Array<Maybe<Slab>>   slabs_;
+	AstRefArray<AstStmt> stmts_; // See stmts()
+	Slice<const AstID>   ids_;
+	Array<AstID>         id_storage_;
+	Ulen                 nodes_ = 0;
+	Array<AstID>*        log_ = nullptr; // See track()
+	Maybe<FileMap>       map_; // See map()
+	Bool                 intern_ = false; // See intern()
+	Map<Hash, Uint32>    interned_; // The first node of each content made while interning
+};
+
+// Walks the trees under a list of nodes in preorder with a stack of its own
+// rather than by recursion, giving each node as it's reached along with its type
+// and depth. The children of a node are walked in the order of its fields, nil
+// ones are left out. What a pass needs of the tree is then a loop over next(),
+// or over the Array of every node which flatten() gives, rather than a switch on
+// the kind of each node which recurses through every one of its children.
+struct AstWalker {
+	struct Node {
+		AstID  id;
+		Uint32 depth; // Zero for the nodes the walk began with
+		Uint32 slab;  // AstSlabID::id<T>() of the type of the node
+		template<typename T>
+		[[nodiscard]] THOR_FORCEINLINE constexpr Bool is() const {
+			return slab == AstSlabID::id<T>();
+		}
+		template<typename T>
+		[[nodiscard]] THOR_FORCEINLINE constexpr AstRef<T> as() const {
+			return is<T>() ? AstRef<T>{id} : AstRef<T>{};
+		}
+	};
+
+	AstWalker(const AstFile& ast, Allocator& allocator)
+		: ast_{ast}
+		, stack_{allocator}
+	{
+	}
+
+	// Walk the trees under [roots] after whatever is left of the walk so far, the
+	// first of them first.
+	template<typename T>
+	Bool push(Slice<const AstRef<T>> roots) {
+		return push(roots.template cast<const AstID>());
+	}
+
+	// The next node in preorder. Nothing once every node was walked, or when the
+	// stack could not grow in which case failed() is true.
+	Maybe<Node> next();
+
+	// Leave out the children of the node next() gave last.
+	THOR_FORCEINLINE void skip() {
+		last_.reset();
+	}
+
+	// Append every node left to walk to [nodes].
+	Bool flatten(Array<Node>& nodes);
+
+	[[nodiscard]] THOR_FORCEINLINE constexpr Bool failed() const {
+		return failed_;
+	}
+
+private:
+	Bool push(Slice<const AstID> roots);
+	Bool expand(const Node& node);
+
+	const AstFile& ast_;
+	Array<Node>    stack_; // The top is the next node to walk
+	Maybe<Node>    last_;  // Given by next() with its children not pushed yet
+	Bool           failed_ = false;
+};
+
+// The structural hash of a node is a hash of its type, of what it holds and of
+// the structural hashes of its children, and not of where it is. Subtrees which
+// are written the same hash the same wherever they are, in this file or in any
+// other, which makes it the key to find e.g an instance of a generic made before.
+// Two nodes with the same hash are only likely to be the same, not known to be.
+//
+// The hashes are made bottom-up: the tree under a node is walked with AstWalker
+// and hashed in reverse, so children before their parents, and every one is kept
+// by AstID, so the parent of a tree hashed before is all that is hashed. Nothing
+// is hashed twice when create() shares nodes. A procedure whose body was skipped
+// and a bad statement are each unlike any other node.
+//
+// The hashes are kept like the nodes are, in an array for each slab indexed by
+// the index of the node in it, since there is one for most every node.
+struct AstHasher {
+	AstHasher(const AstFile& ast, Allocator& allocator)
+		: ast_{ast}
+		, allocator_{allocator}
+		, hashes_{allocator}
+		, nodes_{allocator}
+	{
+	}
+
+	// The hash of the tree under [ref], nothing when out of memory.
+	template<typename T>
+	Maybe<Hash> hash(AstRef<T> ref) {
+		return hash(ref.id_);
+	}
+
+private:
+	Maybe<Hash> hash(AstID id);
+	Hash combine(const AstWalker::Node& node) const;
+	// The hash of [id] or zero when it has none yet.
+	Hash find(AstID id) const;
+
+	const AstFile&         ast_;
+	Allocator&             allocator_;
+	Array<Array<Hash>>     hashes_; // By slab and then index, zero for none
+	Array<AstWalker::Node> nodes_;  // Those left to hash, kept to not grow it again
 };
 
 } // namespace Thor
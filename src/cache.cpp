@@ -0,0 +1,140 @@
+#include "util/file.h"
+#include "util/stream.h"
+
+#include "cache.h"
+
+namespace Thor {
+
+// Changes whenever the parser makes something else of the same source without
+// the layout of the nodes changing, so that entries saved before are not used.
+static constexpr const Uint32 CACHE_VERSION = 1;
+
+// An entry is this header on a page of its own followed by the AstFile.
+struct AstCacheHeader {
+	Uint8   magic[4]; // tacf
+	Uint32  version;
+	Hash    key;      // Of the source, the options, and the layout
+	Uint64  length;   // Of the source
+	Float64 parse;    // Seconds it took to parse
+};
+
+static constexpr const Ulen CACHE_PAGE = 4096;
+
+// The length of the source is kept in the header and checked as well, so only
+// sources of the same length could ever be mixed up.
+static Hash cache_key(Slice<const Uint8> source, Uint64 options) {
+	auto h = hash(Uint64(CACHE_VERSION));
+	h = hash(AstFile::layout(), h);
+	h = hash(options, h);
+	return source.hash(h);
+}
+
+static Bool append_string(Array<char>& array, StringView data) {
+	for (auto ch : data) {
+		if (!array.push_back(ch)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static Bool append_hex(Array<char>& array, Uint64 value) {
+	static constexpr const char DIGITS[] = "0123456789abcdef";
+	for (Ulen i = 16; i-- > 0; /**/) {
+		if (!array.push_back(DIGITS[(value >> (i * 4)) & 0xf])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Maybe<AstCache> AstCache::open(System& sys, StringView path) {
+	if (!sys.filesystem.make_dir(sys, path)) {
+		return {};
+	}
+	Array<char> copy{sys.allocator};
+	if (!append_string(copy, path)) {
+		return {};
+	}
+	return AstCache { move(copy) };
+}
+
+Bool AstCache::entry(Array<char>& name, Hash key, StringView suffix) const {
+	return append_string(name, StringView { path_.data(), path_.length() })
+	    && append_string(name, StringView { "/" })
+	    && append_hex(name, key)
+	    && append_string(name, suffix);
+}
+
+Maybe<AstCache::Entry> AstCache::load(System& sys, Slice<const Uint8> source, Uint64 options) const {
+	const auto key = cache_key(source, options);
+	Array<char> name{sys.allocator};
+	if (!entry(name, key, StringView { ".ast" })) {
+		return {};
+	}
+	auto map = FileMap::open(sys, StringView { name.data(), name.length() });
+	if (!map) {
+		return {};
+	}
+	const auto data = map->data();
+	if (data.length() < CACHE_PAGE) {
+		return {};
+	}
+	const auto& header = *reinterpret_cast<const AstCacheHeader*>(data.data());
+	if (Slice<const Uint8>{header.magic} != Slice{"tacf"}.cast<const Uint8>()) {
+		return {};
+	}
+	if (header.version != CACHE_VERSION
+	 || header.key != key
+	 || header.length != source.length())
+	{
+		return {};
+	}
+	const auto parse = Seconds { header.parse };
+	auto ast = AstFile::map(sys, move(*map), CACHE_PAGE);
+	if (!ast) {
+		return {};
+	}
+	return Entry { move(*ast), parse };
+}
+
+Bool AstCache::store(System& sys, Slice<const Uint8> source, Uint64 options, const AstFile& ast, Seconds parse) {
+	const auto key = cache_key(source, options);
+	Array<char> name{sys.allocator};
+	Array<char> temp{sys.allocator};
+	if (!entry(name, key, StringView { ".ast" }) || !entry(temp, key, StringView { "." })) {
+		return false;
+	}
+	// Other threads and other processes could be saving the same entry at once.
+	// The ID of this process and a count of the entries it saved tell its temp
+	// file apart from theirs.
+	if (!append_hex(temp, sys.process.id(sys))
+	 || !append_string(temp, StringView { "." })
+	 || !append_hex(temp, next_.fetch_add(1))
+	 || !append_string(temp, StringView { ".tmp" }))
+	{
+		return false;
+	}
+	const auto src = StringView { temp.data(), temp.length() };
+	const auto dst = StringView { name.data(), name.length() };
+	const AstCacheHeader header {
+		.magic   = { 't', 'a', 'c', 'f' },
+		.version = CACHE_VERSION,
+		.key     = key,
+		.length  = Uint64(source.length()),
+		.parse   = parse.value(),
+	};
+	Bool ok = false;
+	if (auto stream = FileStream::open(sys, src, File::Access::WR)) {
+		ok = stream->write(Slice{&header, 1}.cast<const Uint8>())
+		  && stream->zero(CACHE_PAGE - sizeof header)
+		  && ast.save(*stream);
+	}
+	if (!ok || !sys.filesystem.rename_file(sys, src, dst)) {
+		sys.filesystem.remove_file(sys, src);
+		return false;
+	}
+	return true;
+}
+
+} // namespace Thor
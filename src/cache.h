@@ -0,0 +1,58 @@
+#ifndef THOR_CACHE_H
+#define THOR_CACHE_H
+#include "util/array.h"
+#include "util/atomic.h"
+#include "util/time.h"
+
+#include "ast.h"
+
+namespace Thor {
+
+// A directory of the ASTs of files parsed before. Each is kept in a file named
+// for a hash of the source it was parsed from, so a file which has not changed
+// since, wherever it is and whatever it's called, is mapped from there rather
+// than parsed. The hash also covers the options given and what build of Thor
+// saved it since those change what the same source parses to.
+//
+// An entry is written to a file of its own and then renamed into place so a
+// reader never sees part of one, any number of threads or compilers can share
+// the same directory. Only files which parsed without errors are kept, those
+// with errors are parsed again to report them.
+struct AstCache {
+	// An AST from the cache and how long it took to parse it when it was saved.
+	struct Entry {
+		AstFile ast;
+		Seconds parse;
+	};
+
+	// Use the directory [path] as the cache, it's made when it does not exist.
+	static Maybe<AstCache> open(System& sys, StringView path);
+
+	AstCache(AstCache&& other)
+		: path_{move(other.path_)}
+		, next_{other.next_.load()}
+	{
+	}
+
+	// Find the AST of [source] parsed with [options].
+	Maybe<Entry> load(System& sys, Slice<const Uint8> source, Uint64 options) const;
+
+	// Keep [ast], which took [parse] to parse from [source] with [options].
+	Bool store(System& sys, Slice<const Uint8> source, Uint64 options, const AstFile& ast, Seconds parse);
+
+private:
+	AstCache(Array<char>&& path)
+		: path_{move(path)}
+	{
+	}
+
+	// The name of the entry for [key] followed by [suffix].
+	Bool entry(Array<char>& name, Hash key, StringView suffix) const;
+
+	Array<char>  path_;
+	Atomic<Ulen> next_{0}; // Makes the names of the files written unique
+};
+
+} // namespace Thor
+
+#endif // THOR_CACHE_H
@@ -0,0 +1,57 @@
+#include "util/system.h"
+
+#include "diagnostic.h"
+#include "lexer.h"
+
+namespace Thor {
+
+Bool Diagnostics::report(Uint32 offset, StringView message) {
+	if (full() || !diagnostics_.push_back(Diagnostic { offset, message })) {
+		dropped_ = true;
+		return false;
+	}
+	return true;
+}
+
+void Diagnostics::flush(System& sys, StringView file, Lexer& lexer) {
+	if (is_empty()) {
+		return;
+	}
+	// They're mostly reported in order already, apart from those in the bodies of
+	// procedures parsed later, so an insertion sort is all it takes. It's stable
+	// too, those at the same offset stay in the order they were reported in.
+	auto diagnostics = diagnostics_.slice();
+	for (Ulen i = 1; i < diagnostics.length(); i++) {
+		const auto diagnostic = diagnostics[i];
+		auto j = i;
+		for (; j > 0 && diagnostics[j - 1].offset > diagnostic.offset; j--) {
+			diagnostics[j] = diagnostics[j - 1];
+		}
+		diagnostics[j] = diagnostic;
+	}
+	StringBuilder builder{sys.allocator};
+	for (const auto& diagnostic : diagnostics) {
+		const auto position = lexer.position(diagnostic.offset);
+		builder.put(file);
+		builder.put(':');
+		builder.put(position.line);
+		builder.put(':');
+		builder.put(position.column);
+		builder.put(": error: ");
+		builder.put(diagnostic.message);
+		builder.put('\n');
+	}
+	if (dropped_) {
+		builder.put(file);
+		builder.put(": error: Too many errors, stopped parsing\n");
+	}
+	if (auto result = builder.result()) {
+		sys.console.write(sys, *result);
+	} else {
+		sys.console.write(sys, StringView { "Out of memory" });
+	}
+	diagnostics_.clear();
+	dropped_ = false;
+}
+
+} // namespace Thor
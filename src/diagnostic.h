@@ -0,0 +1,62 @@
+#ifndef THOR_DIAGNOSTIC_H
+#define THOR_DIAGNOSTIC_H
+#include "util/array.h"
+#include "util/string.h"
+
+namespace Thor {
+
+struct System;
+struct Lexer;
+
+// A diagnostic is kept as where it is and what it is, the text for it is only
+// made when it's written out.
+struct Diagnostic {
+	Uint32     offset;  // Byte offset in the file
+	StringView message; // Always a string literal
+};
+
+// The diagnostics of a file. Only the thread parsing the file reports to them so
+// reporting one is just an append to a buffer of its own, no lock is taken and
+// nothing is formatted or written out until flush(). That writes all of them at
+// once, in order of where they are in the file, so a file with any number of
+// diagnostics is a single write to the console.
+//
+// Once [limit] diagnostics are reported the file is given up on, those reported
+// after that are dropped and full() is true so the parser can stop.
+struct Diagnostics {
+	constexpr Diagnostics(Allocator& allocator)
+		: diagnostics_{allocator}
+	{
+	}
+
+	// Give up on the file after [limit] diagnostics, zero is no limit.
+	void limit(Ulen limit) {
+		limit_ = limit;
+	}
+	[[nodiscard]] THOR_FORCEINLINE Ulen limit() const {
+		return limit_;
+	}
+
+	// Report [message] at [offset]. Returns false when it was dropped.
+	Bool report(Uint32 offset, StringView message);
+
+	[[nodiscard]] THOR_FORCEINLINE Bool full() const {
+		return limit_ && diagnostics_.length() >= limit_;
+	}
+	[[nodiscard]] THOR_FORCEINLINE Bool is_empty() const {
+		return diagnostics_.is_empty() && !dropped_;
+	}
+
+	// Write the diagnostics reported for [file] since the last flush, the
+	// positions of them are found with [lexer].
+	void flush(System& sys, StringView file, Lexer& lexer);
+
+private:
+	Array<Diagnostic> diagnostics_;
+	Ulen              limit_ = 0;
+	Bool              dropped_ = false; // Any were dropped for being over the limit
+};
+
+} // namespace Thor
+
+#endif // THOR_DIAGNOSTIC_H
@@ -0,0 +1,532 @@
+#include "util/file.h"
+#include "util/job.h"
+
+#include "driver.h"
+#include "parser.h"
+#include "cache.h"
+
+namespace Thor {
+
+// Byte-wise lexicographic comparison.
+static Bool less(StringView lhs, StringView rhs) {
+	const auto length = lhs.length() < rhs.length() ? lhs.length() : rhs.length();
+	for (Ulen i = 0; i < length; i++) {
+		const auto a = Uint8(lhs[i]);
+		const auto b = Uint8(rhs[i]);
+		if (a != b) {
+			return a < b;
+		}
+	}
+	return lhs.length() < rhs.length();
+}
+
+template<typename T>
+static void swap(T& lhs, T& rhs) {
+	T tmp{move(lhs)};
+	lhs = move(rhs);
+	rhs = move(tmp);
+}
+
+// Heap sort, packages can have thousands of files.
+template<typename T, typename F>
+static void sort(Slice<T> items, F&& before) {
+	const auto n = items.length();
+	auto sift = [&](Ulen root, Ulen end) {
+		for (;;) {
+			auto child = 2 * root + 1;
+			if (child >= end) {
+				return;
+			}
+			if (child + 1 < end && before(items[child], items[child + 1])) {
+				child++;
+			}
+			if (!before(items[root], items[child])) {
+				return;
+			}
+			swap(items[root], items[child]);
+			root = child;
+		}
+	};
+	for (Ulen i = n / 2; i-- > 0; /**/) {
+		sift(i, n);
+	}
+	for (Ulen end = n; end > 1; end--) {
+		swap(items[0], items[end - 1]);
+		sift(0, end - 1);
+	}
+}
+
+static StringView view(const Array<char>& array) {
+	return { array.data(), array.length() };
+}
+
+static Bool append(Array<char>& array, StringView data) {
+	const auto offset = array.length();
+	if (!array.resize(offset + data.length())) {
+		return false;
+	}
+	Allocator::memcopy(Address(array.data() + offset), Address(data.data()), data.length());
+	return true;
+}
+
+// Lexically remove the "." and ".." parts of [path] so that a package has the
+// same path no matter which file imports it.
+static Bool normalize(Array<char>& out, StringView path) {
+	const Bool absolute = !path.is_empty() && path[0] == '/';
+	if (absolute && !out.push_back('/')) {
+		return false;
+	}
+	const auto root = out.length();
+	for (Ulen i = 0; i < path.length(); /**/) {
+		while (i < path.length() && path[i] == '/') i++;
+		auto j = i;
+		while (j < path.length() && path[j] != '/') j++;
+		const auto part = path.slice(i).truncate(j - i);
+		i = j;
+		if (part.is_empty() || part == ".") {
+			continue;
+		}
+		if (part == "..") {
+			auto start = out.length();
+			while (start > root && out[start - 1] != '/') start--;
+			const auto last = view(out).slice(start);
+			if (!last.is_empty() && last != "..") {
+				// Cannot fail, this only shrinks.
+				(void)out.resize(start > root ? start - 1 : start);
+				continue;
+			}
+			if (absolute) {
+				// There is nothing above the root.
+				continue;
+			}
+		}
+		if (out.length() > root && !out.push_back('/')) {
+			return false;
+		}
+		if (!append(out, part)) {
+			return false;
+		}
+	}
+	return !out.is_empty() || out.push_back('.');
+}
+
+Driver::~Driver() {
+	for (auto unit : units_) {
+		heap_.destroy(unit);
+	}
+	if (cache_) {
+		heap_.destroy(cache_);
+	}
+}
+
+Bool Driver::cache(StringView path) {
+	auto cache = AstCache::open(sys_, path);
+	if (!cache) {
+		return false;
+	}
+	if (cache_) {
+		heap_.destroy(cache_);
+	}
+	cache_ = heap_.create<AstCache>(move(*cache));
+	return cache_ != nullptr;
+}
+
+Bool Driver::collection(StringView name, StringView path) {
+	Collection collection{heap_};
+	if (!append(collection.name, name) || !append(collection.path, path)) {
+		return false;
+	}
+	return collections_.push_back(move(collection));
+}
+
+Bool Driver::add(StringView path) {
+	forget();
+	auto dir = sys_.filesystem.open_dir(sys_, path);
+	if (!dir) {
+		return add_file({}, path);
+	}
+	const auto first = units_.length();
+	Bool ok = add_package(path);
+	Filesystem::Item item;
+	while (ok && sys_.filesystem.read_dir(sys_, dir, item)) {
+		if (item.kind == Filesystem::Item::Kind::FILE && ends_with(item.name, ".odin")) {
+			ok = add_file(path, item.name);
+		}
+	}
+	sys_.filesystem.close_dir(sys_, dir);
+	// The order of the files in a directory is up to the filesystem.
+	sort(units_.slice().slice(first), [](const Unit* lhs, const Unit* rhs) {
+		return less(view(lhs->name), view(rhs->name));
+	});
+	return ok;
+}
+
+Maybe<Driver::Unit> Driver::make_unit(System& sys, StringView path, StringView name) {
+	Unit unit{heap_};
+	if (!path.is_empty() && (!append(unit.name, path) || !append(unit.name, StringView { "/" }))) {
+		return {};
+	}
+	if (!append(unit.name, name)) {
+		return {};
+	}
+	// The sizes are only used to decide which files to parse first, a file which
+	// cannot be opened here fails when it's parsed.
+	if (auto file = File::open(sys, view(unit.name), File::Access::RD)) {
+		unit.bytes = file->tell();
+	}
+	return unit;
+}
+
+Bool Driver::add_file(StringView path, StringView name) {
+	auto unit = make_unit(sys_, path, name);
+	if (!unit) {
+		return false;
+	}
+	auto added = heap_.create<Unit>(move(*unit));
+	if (!added) {
+		return false;
+	}
+	if (!units_.push_back(added)) {
+		heap_.destroy(added);
+		return false;
+	}
+	roots_ = units_.length();
+	return true;
+}
+
+Bool Driver::add_package(StringView path) {
+	Array<char> package{heap_};
+	if (!normalize(package, path) || !packages_.push_back(move(package))) {
+		return false;
+	}
+	added_ = packages_.length();
+	return true;
+}
+
+Bool Driver::resolve(StringView dir, StringView path, Array<char>& package) {
+	// Imports are either "collection:path" or relative to the importing file.
+	auto base = dir;
+	for (Ulen i = 0; i < path.length(); i++) {
+		if (path[i] != ':') {
+			continue;
+		}
+		const auto name = path.truncate(i);
+		const Collection* found = nullptr;
+		for (const auto& collection : collections_) {
+			if (view(collection.name) == name) {
+				found = &collection;
+				break;
+			}
+		}
+		if (!found) {
+			return false;
+		}
+		base = view(found->path);
+		path = path.slice(i + 1);
+		break;
+	}
+	Array<char> joined{heap_};
+	if (!append(joined, base) || !append(joined, StringView { "/" }) || !append(joined, path)) {
+		return false;
+	}
+	return normalize(package, view(joined));
+}
+
+void Driver::import(System& sys, JobPool& pool, StringView dir, StringView path) {
+	Array<char> package{heap_};
+	if (!resolve(dir, path, package)) {
+		return;
+	}
+
+	// Only the first import of a package gets to parse it.
+	StringView where;
+	lock_.lock(sys);
+	if (!registry_.find(view(package))) {
+		const auto index = packages_.length();
+		if (packages_.push_back(move(package))) {
+			// The path of a package does not move when [packages_] grows.
+			where = view(packages_[index]);
+			if (!registry_.insert(where, index)) {
+				where = {};
+			}
+		}
+	}
+	lock_.unlock(sys);
+	if (where.is_empty()) {
+		return;
+	}
+
+	// Read the directory outside of the lock, other files may be importing too.
+	auto handle = sys.filesystem.open_dir(sys, where);
+	if (!handle) {
+		return;
+	}
+	Array<Unit*> found{heap_};
+	Filesystem::Item item;
+	while (sys.filesystem.read_dir(sys, handle, item)) {
+		if (item.kind != Filesystem::Item::Kind::FILE || !ends_with(item.name, ".odin")) {
+			continue;
+		}
+		auto unit = make_unit(sys, where, item.name);
+		auto added = unit ? heap_.create<Unit>(move(*unit)) : nullptr;
+		if (!added) {
+			break;
+		}
+		if (!found.push_back(added)) {
+			heap_.destroy(added);
+			break;
+		}
+	}
+	sys.filesystem.close_dir(sys, handle);
+
+	Array<Ulen> jobs{heap_};
+	lock_.lock(sys);
+	for (auto unit : found) {
+		const auto index = units_.length();
+		if (!jobs.reserve(jobs.length() + 1) || !units_.push_back(unit)) {
+			heap_.destroy(unit);
+			continue;
+		}
+		if (!order_.push_back(Uint32(index))) {
+			// Never parsed, it's reported as failed.
+			continue;
+		}
+		// Cannot fail, the space was reserved.
+		(void)jobs.push_back(order_.length() - 1);
+	}
+	lock_.unlock(sys);
+	for (auto job : jobs) {
+		pool.push(job);
+	}
+}
+
+void Driver::forget() {
+	while (units_.length() > roots_) {
+		heap_.destroy(units_[units_.length() - 1]);
+		units_.pop_back();
+	}
+	while (packages_.length() > added_) {
+		packages_.pop_back();
+	}
+}
+
+// Everything written to the console while parsing a file goes to the output of
+// the file instead.
+struct DriverSystem : System {
+	DriverSystem(System& sys, Array<char>& output);
+	Array<char>& output;
+	Bool         ok = true;
+};
+
+static void driver_console_write(System& sys, StringView data) {
+	auto& self = static_cast<DriverSystem&>(sys);
+	self.ok = self.ok && append(self.output, data);
+}
+
+static constexpr const Console DRIVER_CONSOLE = {
+	.write = driver_console_write,
+};
+
+DriverSystem::DriverSystem(System& sys, Array<char>& output)
+	: System{sys.filesystem,
+	         sys.heap,
+	         DRIVER_CONSOLE,
+	         sys.process,
+	         sys.linker,
+	         sys.scheduler,
+	         sys.chrono}
+	, output{output}
+{
+}
+
+static void dump(System& sys, const AstFile& ast, Slice<const AstRef<AstStmt>> stmts) {
+	StringBuilder builder{sys.allocator};
+	for (auto stmt : stmts) {
+		if (ast[stmt].is_stmt<AstEmptyStmt>()) {
+			continue;
+		}
+		ast[stmt].dump(ast, builder, 0);
+		builder.put('\n');
+	}
+	builder.put('\n');
+	if (auto result = builder.result()) {
+		sys.console.write(sys, *result);
+	}
+}
+
+void Driver::run(JobPool& pool, System& sys, void* user, Ulen index) {
+	auto& self = *static_cast<Driver*>(user);
+	// Imports add units while others are parsed.
+	self.lock_.lock(sys);
+	const auto which = self.order_[index];
+	auto& unit = *self.units_[which];
+	self.lock_.unlock(sys);
+	DriverSystem unit_sys{sys, unit.output};
+	auto failed = [&] {
+		// Parser::open only reports invalid UTF-8 itself.
+		if (unit.output.is_empty()) {
+			append(unit.output, view(unit.name));
+			append(unit.output, StringView { ": error: Could not open file\n" });
+		}
+	};
+	// Imports are relative to the directory of the file.
+	auto name = view(unit.name);
+	auto dir = StringView { "." };
+	for (Ulen i = name.length(); i-- > 0; /**/) {
+		if (name[i] == '/') {
+			dir = name.truncate(i);
+			break;
+		}
+	}
+	auto lexer = Lexer::open(unit_sys, name);
+	if (!lexer) {
+		return failed();
+	}
+	const auto lazy = self.lazy_imports_ && which >= self.roots_;
+	// A file parsed lazily is not cached, the bodies it skipped are parsed from
+	// the source by a Parser of the file and a mapped AST has none. The options
+	// which change what a file parses to are part of what it's cached under,
+	// there are none others yet.
+	const auto cache = lazy ? nullptr : self.cache_;
+	const auto options = 0_u64;
+	const auto t0 = MonotonicTime::now(sys);
+	if (cache) {
+		if (auto entry = cache->load(unit_sys, lexer->input().cast<const Uint8>(), options)) {
+			auto& ast = entry->ast;
+			const auto stmts = ast[ast.stmts()];
+			// Only the top-level of a file can import, as the parser would have.
+			for (auto stmt : stmts) {
+				if (auto import_stmt = ast[stmt].to_stmt<AstImportStmt>()) {
+					self.import(unit_sys, pool, dir, ast[ast[import_stmt->expr].value]);
+				}
+			}
+			unit.skipped = entry->parse - (MonotonicTime::now(sys) - t0);
+			if (self.dump_) {
+				dump(unit_sys, ast, stmts);
+			}
+			unit.bytes = lexer->input().length();
+			unit.nodes = ast.nodes();
+			unit.cached = true;
+			unit.ok = unit_sys.ok;
+			return;
+		}
+	}
+	// Files are already parsed in parallel with each other, tokenize on just this
+	// thread unless the file is large enough to be lexed while it's parsed.
+	const auto stream = self.stream_threshold_ && lexer->input().length() >= self.stream_threshold_;
+	auto parser = stream ? Parser::open_streaming(unit_sys, name, move(*lexer))
+	                     : Parser::open(unit_sys, name, move(*lexer), 1);
+	if (!parser) {
+		return failed();
+	}
+	struct Importer {
+		Driver&    driver;
+		System&    sys;
+		JobPool&   pool;
+		StringView dir;
+	} importer{self, unit_sys, pool, dir};
+	parser->on_import([](void* user, StringView path) {
+		auto& importer = *static_cast<Importer*>(user);
+		importer.driver.import(importer.sys, importer.pool, importer.dir, path);
+	}, &importer);
+	parser->lazy_bodies(lazy);
+	parser->error_limit(self.error_limit_);
+	Array<AstRef<AstStmt>> stmts{unit_sys.allocator};
+	for (;;) {
+		auto stmt = parser->parse_top_stmt();
+		if (!stmt) {
+			break;
+		}
+		if (!stmts.push_back(move(stmt))) {
+			break;
+		}
+	}
+	parser->flush();
+	const auto t1 = MonotonicTime::now(sys);
+	auto& ast = parser->ast();
+	if (self.dump_) {
+		dump(unit_sys, ast, stmts.slice().cast<const AstRef<AstStmt>>());
+	}
+	unit.bytes = parser->lexer().input().length();
+	unit.nodes = ast.nodes();
+	unit.ok = unit_sys.ok && parser->errors() == 0;
+	if (cache && unit.ok) {
+		ast.stmts(ast.insert(move(stmts)));
+		// Not being able to save it only means it's parsed again next time.
+		(void)cache->store(unit_sys, parser->lexer().input().cast<const Uint8>(), options, ast, t1 - t0);
+	}
+}
+
+Bool Driver::parse(Ulen threads, Bool dump) {
+	forget();
+	registry_.reset();
+	for (Ulen i = 0; i < packages_.length(); i++) {
+		if (!registry_.insert(view(packages_[i]), i)) {
+			return false;
+		}
+	}
+	if (roots_ > 0xffff'ffff_ulen || !order_.resize(roots_)) {
+		return false;
+	}
+	for (Ulen i = 0; i < roots_; i++) {
+		auto& unit = *units_[i];
+		unit.output.reset();
+		unit.nodes = 0;
+		unit.ok = false;
+		unit.cached = false;
+		unit.skipped = Seconds { 0.0 };
+		order_[i] = Uint32(i);
+	}
+	// The largest files are parsed first so the last jobs are all small ones.
+	// Equal sizes are kept in the order the files were added.
+	sort(order_.slice(), [&](Uint32 lhs, Uint32 rhs) {
+		const auto a = units_[lhs]->bytes;
+		const auto b = units_[rhs]->bytes;
+		return a != b ? a > b : lhs < rhs;
+	});
+	dump_ = dump;
+	if (!JobPool::run(sys_, roots_, threads, run, this)) {
+		return false;
+	}
+	// Which file got to import a package first is down to timing, so the imported
+	// files are put in order of their names.
+	sort(units_.slice().slice(roots_), [](const Unit* lhs, const Unit* rhs) {
+		return less(view(lhs->name), view(rhs->name));
+	});
+	return true;
+}
+
+void Driver::report() const {
+	for (const auto unit : units_) {
+		if (!unit->output.is_empty()) {
+			sys_.console.write(sys_, view(unit->output));
+		}
+	}
+	if (!cache_) {
+		return;
+	}
+	Ulen hits = 0;
+	// Files are parsed in parallel, so this is the parsing that was skipped summed
+	// over files rather than how much sooner parse() returned.
+	Seconds skipped{0.0};
+	for (const auto unit : units_) {
+		if (unit->cached) {
+			hits++;
+			skipped += unit->skipped;
+		}
+	}
+	ScratchAllocator<256> scratch{sys_.allocator};
+	StringBuilder builder{scratch};
+	builder.put("cache: ");
+	builder.put(Uint64(hits));
+	builder.put(hits == 1 ? StringView { " hit, " } : StringView { " hits, " });
+	builder.put(Uint64(units_.length() - hits));
+	builder.put(units_.length() - hits == 1 ? StringView { " miss, " } : StringView { " misses, " });
+	builder.put(skipped.value() * 1e3);
+	builder.put(" ms of parsing skipped over all files\n");
+	if (auto result = builder.result()) {
+		sys_.console.write(sys_, *result);
+	}
+}
+
+} // namespace Thor
@@ -0,0 +1,148 @@
+#ifndef THOR_DRIVER_H
+#define THOR_DRIVER_H
+#include "util/array.h"
+#include "util/lock.h"
+#include "util/map.h"
+#include "util/string.h"
+#include "util/system.h"
+#include "util/time.h"
+
+namespace Thor {
+
+struct JobPool;
+struct AstCache;
+
+// Parses many files at once, one job per file on a JobPool. Each file is parsed
+// with a System of its own so the allocator it uses is private to the thread
+// parsing it and is released as soon as the file is done. Whatever the parser
+// writes to the console is kept with the file and only written out once every
+// file is done, in the order the files were added, so the output is the same no
+// matter how many threads there are or which of them parsed which file.
+//
+// The packages a file imports are parsed too. Each import is acted on the moment
+// the parser reaches it, so the files of the imported package are parsed while
+// the rest of the importing file still is, and a deep import graph is parsed
+// wide rather than one package after another. A registry of the packages seen so
+// far keeps a package imported from many files from being parsed more than once.
+// Imports of a collection which was not given with collection() are skipped, as
+// are imports of a directory which does not exist.
+//
+// With a cache() the AST of a file which parsed before is mapped from there
+// rather than parsed again, see AstCache.
+struct Driver {
+	// A file to parse and the result of parsing it.
+	struct Unit {
+		Unit(Allocator& allocator)
+			: name{allocator}
+			, output{allocator}
+		{
+		}
+		Unit(Unit&&) = default;
+		Unit& operator=(Unit&& other) {
+			this->~Unit();
+			return *new (this, Nat{}) Unit{move(other)};
+		}
+		Array<char> name;
+		Array<char> output;    // Diagnostics and the AST when dumping
+		Uint64      bytes = 0; // Size of the file
+		Ulen        nodes = 0; // Nodes in the AST
+		Bool        ok = false; // Parsed without errors
+		Bool        cached = false; // Found in the cache rather than parsed
+		Seconds     skipped{0.0}; // Time parsing it took less that of loading it from the cache
+	};
+
+	Driver(System& sys)
+		: sys_{sys}
+		, heap_{sys}
+		, units_{heap_}
+	{
+	}
+	~Driver();
+
+	// Resolve imports of "[name]:path" to [path]/path.
+	Bool collection(StringView name, StringView path);
+
+	// Skip over the bodies of the procedures in imported packages when [lazy] is
+	// true, most of a library is never called by any one program.
+	void lazy_imports(Bool lazy) {
+		lazy_imports_ = lazy;
+	}
+
+	// Keep the AST of every file parsed in the directory [path] and look for them
+	// there before parsing, the directory is made when it does not exist. Files
+	// parsed with their bodies skipped, see lazy_imports(), are not kept.
+	Bool cache(StringView path);
+
+	// Lex each file of at least [bytes] on a thread of its own while it's parsed,
+	// see Parser::open_streaming, zero is none. That thread is on top of those
+	// given to parse() so it's only worth it for a file large enough to be parsed
+	// mostly on its own, otherwise the files are already parsed in parallel.
+	void stream_threshold(Uint64 bytes) {
+		stream_threshold_ = bytes;
+	}
+
+	// Give up on a file after [limit] errors, zero is no limit.
+	void error_limit(Ulen limit) {
+		error_limit_ = limit;
+	}
+
+	// Add the file [path] or when it's a directory all of the .odin files in it,
+	// i.e the package. The files of a package are added in order of their names.
+	Bool add(StringView path);
+
+	// Parse every file that was added and every package they import on up to
+	// [threads] threads. The output of a file includes the dump of its AST when
+	// [dump] is true.
+	Bool parse(Ulen threads, Bool dump);
+
+	// Write the output of every file to the console, those added in the order they
+	// were added followed by the imported ones in order of their names. With a
+	// cache() that's followed by how many files were found in it and the time it
+	// took to parse them less that of loading them, summed over the files.
+	void report() const;
+
+	[[nodiscard]] THOR_FORCEINLINE Slice<Unit* const> units() const {
+		return units_.slice();
+	}
+
+private:
+	struct Collection {
+		Collection(Allocator& allocator)
+			: name{allocator}
+			, path{allocator}
+		{
+		}
+		Array<char> name;
+		Array<char> path;
+	};
+
+	Maybe<Unit> make_unit(System& sys, StringView path, StringView name);
+	Bool add_file(StringView path, StringView name);
+	Bool add_package(StringView path);
+	Bool resolve(StringView dir, StringView path, Array<char>& package);
+	void import(System& sys, JobPool& pool, StringView dir, StringView path);
+	// Drop what the last parse imported.
+	void forget();
+	static void run(JobPool& pool, System& sys, void* user, Ulen index);
+
+	System&                sys_;
+	SystemAllocator        heap_; // The parse results are written from many threads
+	Array<Unit*>           units_; // Those added come first, [roots_, length) are imported
+	Ulen                   roots_ = 0;
+	Array<Uint32>          order_{heap_}; // Units by the order they're parsed in
+	Array<Collection>      collections_{heap_};
+	// Every package seen, those added come first, [added_, length) are imported.
+	Array<Array<char>>     packages_{heap_};
+	Ulen                   added_ = 0;
+	Map<StringView, Ulen>  registry_{heap_}; // Index of package by path
+	Lock                   lock_; // Guards the above while parsing
+	Bool                   dump_ = false;
+	Bool                   lazy_imports_ = false;
+	Ulen                   error_limit_ = 32;
+	Uint64                 stream_threshold_ = 0;
+	AstCache*              cache_ = nullptr;
+};
+
+} // namespace Thor
+
+#endif // THOR_DRIVER_H
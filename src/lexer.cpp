@@ -1,14 +1,211 @@
 #include "lexer.h"
 #include "string.h"
 
-#include "util/file.h"
+#include "util/ring.h"
+#include "util/simd.h"
+#include "util/thread.h"
 
 namespace Thor {
 
+// Character classes for the vectorized scanning of the lexer. Each one matches
+// the bytes which stop a run of otherwise uninteresting bytes the lexer would
+// consume one at a time with eat().
+struct ScanBlank {
+	// Stop on anything other than ' ', '\t' or '\r'
+	static THOR_FORCEINLINE Bool stop(Uint8 ch) {
+		return ch != ' ' && ch != '\t' && ch != '\r';
+	}
+#if defined(THOR_SIMD)
+	static THOR_FORCEINLINE Bytes stop(Bytes v) {
+		return ~((v == Bytes::splat(' ')) | (v == Bytes::splat('\t')) | (v == Bytes::splat('\r')));
+	}
+#endif
+};
+
+struct ScanIdent {
+	// Stop on anything other than [A-Za-z0-9_]
+	static THOR_FORCEINLINE Bool stop(Uint8 ch) {
+		return Uint32((ch | 0x20) - 'a') >= 26 && Uint32(ch - '0') >= 10 && ch != '_';
+	}
+#if defined(THOR_SIMD)
+	static THOR_FORCEINLINE Bytes stop(Bytes v) {
+		const auto alpha = (v | Bytes::splat(0x20)).in('a', 'z');
+		const auto digit = v.in('0', '9');
+		return ~(alpha | digit | (v == Bytes::splat('_')));
+	}
+#endif
+};
+
+struct ScanLineComment {
+	// Stop on '\n' or NUL
+	static THOR_FORCEINLINE Bool stop(Uint8 ch) {
+		return ch == '\n' || ch == 0;
+	}
+#if defined(THOR_SIMD)
+	static THOR_FORCEINLINE Bytes stop(Bytes v) {
+		return (v == Bytes::splat('\n')) | (v == Bytes::splat(0));
+	}
+#endif
+};
+
+struct ScanBlockComment {
+	// Stop on '/', '*' or NUL
+	static THOR_FORCEINLINE Bool stop(Uint8 ch) {
+		return ch == '/' || ch == '*' || ch == 0;
+	}
+#if defined(THOR_SIMD)
+	static THOR_FORCEINLINE Bytes stop(Bytes v) {
+		return (v == Bytes::splat('/')) | (v == Bytes::splat('*')) | (v == Bytes::splat(0));
+	}
+#endif
+};
+
+struct ScanString {
+	// Stop on '"', '\\', '\n' or NUL
+	static THOR_FORCEINLINE Bool stop(Uint8 ch) {
+		return ch == '"' || ch == '\\' || ch == '\n' || ch == 0;
+	}
+#if defined(THOR_SIMD)
+	static THOR_FORCEINLINE Bytes stop(Bytes v) {
+		return (v == Bytes::splat('"')) | (v == Bytes::splat('\\'))
+		     | (v == Bytes::splat('\n')) | (v == Bytes::splat(0));
+	}
+#endif
+};
+
+struct ScanRawString {
+	// Stop on '`' or NUL
+	static THOR_FORCEINLINE Bool stop(Uint8 ch) {
+		return ch == '`' || ch == 0;
+	}
+#if defined(THOR_SIMD)
+	static THOR_FORCEINLINE Bytes stop(Bytes v) {
+		return (v == Bytes::splat('`')) | (v == Bytes::splat(0));
+	}
+#endif
+};
+
+struct ScanNewline {
+	// Stop on '\n'
+	static THOR_FORCEINLINE Bool stop(Uint8 ch) {
+		return ch == '\n';
+	}
+#if defined(THOR_SIMD)
+	static THOR_FORCEINLINE Bytes stop(Bytes v) {
+		return v == Bytes::splat('\n');
+	}
+#endif
+};
+
+// Perfect hash table for classifying identifiers as named operators or keywords.
+// The key packs the length with the first, second and last characters, which is
+// unique for every entry. The multiplier is searched for at compile-time until
+// it maps every key to a distinct slot, so a lookup is a single hash and a single
+// string compare against the only possible candidate.
+struct PerfectHash {
+	static inline constexpr const Ulen BITS = 7;
+	static inline constexpr const Ulen SIZE = 1_ulen << BITS;
+	struct Entry {
+		StringView match;
+		Token      token = { TokenKind::IDENTIFIER, 0, 0 };
+	};
+	// Requires str.length() >= 2
+	static constexpr Uint32 key(StringView str) {
+		const auto len = str.length();
+		return Uint32(len)
+		     | Uint32(Uint8(str[0])) << 8
+		     | Uint32(Uint8(str[len - 1])) << 16
+		     | Uint32(Uint8(str[1])) << 24;
+	}
+	constexpr Uint32 index(StringView str) const {
+		return (key(str) * seed) >> (32 - BITS);
+	}
+	Uint32 seed = 0;
+	Ulen   min  = ~0_ulen; // Shortest entry
+	Ulen   max  = 0;       // Longest entry
+	Entry  entries[SIZE];
+};
+
+static constexpr const PerfectHash::Entry IDENTIFIERS[] = {
+	#define OPERATOR_true(ENUM, MATCH) \
+		{ MATCH, { OperatorKind::ENUM, 0, sizeof MATCH - 1 } },
+	#define OPERATOR_false(...)
+	#define OPERATOR(ENUM, NAME, MATCH, PREC, NAMED, ASI) \
+		OPERATOR_ ## NAMED (ENUM, MATCH)
+	#define KEYWORD(ENUM, MATCH, ASI) \
+		{ MATCH, { KeywordKind::ENUM, 0, sizeof MATCH - 1 } },
+	#include "lexer.inl"
+	#undef OPERATOR_true
+	#undef OPERATOR_false
+};
+
+static constexpr PerfectHash build_perfect_hash() {
+	PerfectHash result;
+	for (const auto& entry : IDENTIFIERS) {
+		const auto len = entry.match.length();
+		if (len < result.min) result.min = len;
+		if (len > result.max) result.max = len;
+	}
+	for (result.seed = 0x9e3779b1_u32; /**/; result.seed = (result.seed + 0x3c6ef372_u32) | 1) {
+		Bool used[PerfectHash::SIZE] = {};
+		Bool collision = false;
+		for (const auto& entry : IDENTIFIERS) {
+			const auto index = result.index(entry.match);
+			if (used[index]) {
+				collision = true;
+				break;
+			}
+			used[index] = true;
+		}
+		if (!collision) {
+			break;
+		}
+	}
+	for (const auto& entry : IDENTIFIERS) {
+		result.entries[result.index(entry.match)] = entry;
+	}
+	return result;
+}
+
+static constexpr const auto PERFECT_HASH = build_perfect_hash();
+static_assert(PERFECT_HASH.min >= 2, "PerfectHash::key requires at least two characters");
+
+Token Lexer::classify(StringView ident, Uint32 offset) {
+	const auto len = ident.length();
+	if (len >= PERFECT_HASH.min && len <= PERFECT_HASH.max) {
+		const auto& entry = PERFECT_HASH.entries[PERFECT_HASH.index(ident)];
+		if (entry.match == ident) {
+			auto token = entry.token;
+			token.offset = offset;
+			return token;
+		}
+	}
+	return { TokenKind::IDENTIFIER, offset, Uint16(len) };
+}
+
+// Skip the rest of the run of bytes matching the class [C] starting with the
+// current rune. This is the same as calling eat() while the rune does not stop
+// the class, just without visiting each rune.
+template<typename C>
+THOR_FORCEINLINE void Lexer::skip() {
+	if (rune_ == 0) {
+		return;
+	}
+	skip(simd_scan<C>(input_.data(), position_.this_offset, input_.length()));
+}
+
 Maybe<Lexer> Lexer::open(System& sys, StringView filename) {
 	if (filename.is_empty()) {
 		return {};
 	}
+	// Lex directly out of a mapping of the file when possible.
+	if (auto map = FileMap::open(sys, filename)) {
+		if (map->data().length() >= 0xff'ff'ff'ff_ulen) {
+			return {};
+		}
+		return Lexer{sys.allocator, move(*map)};
+	}
+	// Otherwise fall back to reading a copy of it.
 	auto file = File::open(sys, filename, File::Access::RD);
 	if (!file) {
 		return {};
@@ -17,31 +214,114 @@ Maybe<Lexer> Lexer::open(System& sys, StringView filename) {
 	if (length == 0 || length >= 0xff'ff'ff'ff_ulen) {
 		return {};
 	}
-	auto map = file->map(sys.allocator);
-	if (map.is_empty()) {
+	auto data = file->map(sys.allocator);
+	if (data.is_empty()) {
 		return {};
 	}
-	return Lexer{move(map)};
+	return Lexer{move(data)};
 }
 
-void Lexer::eat() {
-	if (rune_ == '\n') {
-		position_.advance_line();
+Maybe<Lexer> Lexer::open(Array<Uint8>&& data) {
+	const auto length = data.length();
+	if (length == 0 || length >= 0xff'ff'ff'ff_ulen) {
+		return {};
 	}
+	return Lexer{move(data)};
+}
+
+void Lexer::eat() {
 	if (position_.next_offset >= input_.length()) {
 		rune_ = 0; // EOF
 		return;
 	}
-	auto rune = input_[position_.next_offset];
+	auto rune = static_cast<Uint8>(input_[position_.next_offset]);
 	if (rune == 0) {
 		// Error: Unexpected NUL
-	} else if (rune & 0x80) {
-		// TODO(dweiler): UTF-8
 	}
-	position_.advance_column();
+	// Non-ASCII bytes are left as is here, only advance() needs the decoded rune
+	// and every other byte the lexer stops on is ASCII which never appears inside
+	// of a UTF-8 sequence.
+	position_.advance();
 	rune_ = rune;
 }
 
+// Decode the non-ASCII rune beginning at [offset] into the current rune. The
+// input before [invalid_] was validated up front so the sequence needs no checks
+// here.
+void Lexer::decode(Uint32 offset) {
+	const auto data = reinterpret_cast<const Uint8*>(input_.data()) + offset;
+	const Uint32 lead = data[0];
+	if (offset >= invalid_) {
+		position_.advance_to(offset);
+		rune_ = 0xfffd; // Replacement character
+	} else if (lead < 0xe0) {
+		position_.advance_to(offset, 2);
+		rune_ = (lead & 0x1f) << 6 | (data[1] & 0x3f);
+	} else if (lead < 0xf0) {
+		position_.advance_to(offset, 3);
+		rune_ = (lead & 0x0f) << 12 | (data[1] & 0x3f) << 6 | (data[2] & 0x3f);
+	} else {
+		position_.advance_to(offset, 4);
+		rune_ = (lead & 0x07) << 18 | (data[1] & 0x3f) << 12 | (data[2] & 0x3f) << 6 | (data[3] & 0x3f);
+	}
+}
+
+void Lexer::skip(Ulen offset) {
+	const auto length = input_.length();
+	if (offset < length) {
+		position_.advance_to(offset);
+		rune_ = static_cast<Uint8>(input_[offset]);
+	} else {
+		// Like eat() the position remains on the last rune when reaching EOF.
+		position_.advance_to(length - 1);
+		rune_ = 0; // EOF
+	}
+}
+
+// The length of the token from [beg] up to the current rune. When that does not
+// fit in Token::length it's kept in [long_] instead and zero is returned.
+Uint16 Lexer::delta(Uint32 beg) {
+	const auto length = position_.delta(beg);
+	if (length == 0 && position_.this_offset > beg) {
+		// When this fails to allocate Lexer::length gives zero for the token.
+		long_.insert(beg, position_.this_offset - beg);
+	}
+	return length;
+}
+
+Bool Lexer::index_lines() {
+	const auto data = input_.data();
+	const auto length = input_.length();
+	if (!lines_.reserve(simd_count<ScanNewline>(data, length) + 1)) {
+		return false;
+	}
+	if (!lines_.push_back(0)) {
+		return false;
+	}
+	return simd_each<ScanNewline>(data, length, [&](Ulen offset) {
+		return lines_.push_back(Uint32(offset + 1));
+	});
+}
+
+Lexer::SourcePosition Lexer::position(Uint32 offset) {
+	if (lines_.is_empty() && !index_lines()) {
+		lines_.reset();
+		return {};
+	}
+	// Binary search for the last line which starts at or before [offset].
+	Ulen lo = 0;
+	Ulen hi = lines_.length();
+	while (hi - lo > 1) {
+		const auto mid = lo + (hi - lo) / 2;
+		if (lines_[mid] <= offset) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+	return { Uint32(lo + 1), offset - lines_[lo] + 1 };
+}
+
 void Lexer::scan_escape() {
 	Uint32 l = 0;
 	Uint32 b = 0;
@@ -96,13 +376,22 @@ Token Lexer::scan_string() {
 	const auto quote = rune_;
 	const auto raw = quote == '`';
 	for (;;) {
-		if (!raw) {
-			if (rune_ == '\n' || rune_ == 0) {
+		if (raw) {
+			// Raw strings may contain NUL but not run past EOF.
+			if (rune_ == 0 && position_.next_offset >= input_.length()) {
 				// ERROR: String literal is not terminated.
 				break;
 			}
+		} else if (rune_ == '\n' || rune_ == 0) {
+			// ERROR: String literal is not terminated.
+			break;
 		}
 		eat();
+		if (raw) {
+			skip<ScanRawString>();
+		} else {
+			skip<ScanString>();
+		}
 		if (rune_ == quote) {
 			eat(); // Consume quote
 			break;
@@ -111,7 +400,7 @@ Token Lexer::scan_string() {
 			scan_escape();
 		}
 	}
-	return { LiteralKind::STRING, beg, position_.delta(beg) };
+	return { LiteralKind::STRING, beg, delta(beg) };
 }
 
 Token Lexer::scan_number(Bool leading_period) {
@@ -191,7 +480,7 @@ Token Lexer::scan_number(Bool leading_period) {
 		break;
 	}
 
-	token.length = position_.delta(beg);
+	token.length = delta(beg);
 	return token;
 }
 
@@ -200,7 +489,7 @@ Token Lexer::advance() {
 	for (;;) {
 		switch (rune_) {
 		case ' ': case '\t': case '\r':
-			eat(); // Consume
+			skip<ScanBlank>(); // Consume the whole run
 			continue;
 		case '\n':
 			if (!asi_) {
@@ -211,40 +500,22 @@ Token Lexer::advance() {
 		break;
 	}
 	const auto beg = position_.this_offset;
+	if (rune_ >= 0x80) {
+		decode(beg);
+	}
 	if (rune_.is_char()) {
-		while (rune_.is_alpha()) eat();
-		const auto len = position_.delta(beg);
-		const auto str = input_.slice(beg).truncate(len);
-		static constexpr const struct {
-			StringView   match;
-			OperatorKind kind;
-		} OPERATORS[] = {
-			#define OPERATOR_true(ENUM, MATCH) \
-				{ MATCH, OperatorKind::ENUM },
-			#define OPERATOR_false(...)
-			#define OPERATOR(ENUM, NAME, MATCH, PREC, NAMED, ASI) \
-				OPERATOR_ ## NAMED (ENUM, MATCH)
-			#include "lexer.inl"
-		};
-		for (Ulen i = 0; i < countof(OPERATORS); i++) {
-			if (const auto& op = OPERATORS[i]; op.match == str) {
-				return { op.kind, beg, len };
+		for (;;) {
+			skip<ScanIdent>(); // Consume the run of ASCII
+			if (rune_ >= 0x80) {
+				decode(position_.this_offset);
 			}
-		}
-		static constexpr const struct {
-			StringView  match;
-			KeywordKind kind;
-		} KEYWORDS[] = {
-			#define KEYWORD(ENUM, MATCH, ASI) \
-				{ MATCH, KeywordKind::ENUM },
-			#include "lexer.inl"
-		};
-		for (Ulen i = 0; i < countof(KEYWORDS); i++) {
-			if (const auto& kw = KEYWORDS[i]; kw.match == str) {
-				return { kw.kind, beg, len };
+			if (!rune_.is_alpha()) {
+				break;
 			}
+			eat(); // Eat non-ASCII letter or digit
 		}
-		return { TokenKind::IDENTIFIER, beg, len };
+		const auto len = delta(beg);
+		return classify(input_.slice(beg).truncate(len), beg);
 	}
 	switch (rune_) {
 	case '0': case '1': case '2': case '3': case '4':
@@ -310,9 +581,9 @@ Token Lexer::advance() {
 		case '/':
 			// Scan to EOL or EOF
 			eat(); // Eat '/'
-			while (rune_ != '\n' && rune_ != 0) eat();
+			skip<ScanLineComment>();
 			eat(); // Eat '\n'
-			return { TokenKind::COMMENT, beg, position_.delta(beg) }; // '//'
+			return { TokenKind::COMMENT, beg, delta(beg) }; // '//'
 		case '*':
 			eat(); // Eat '*'
 			for (Ulen i = 1; i != 0; /**/) switch (rune_) {
@@ -336,10 +607,11 @@ Token Lexer::advance() {
 				break;
 			default:
 				eat(); // Eat what ever is in the comment
+				skip<ScanBlockComment>();
 				break;
 			}
 			// This also limits comments to no more than 64 KiB
-			return { TokenKind::COMMENT, beg, position_.delta(beg) }; // '/*'
+			return { TokenKind::COMMENT, beg, delta(beg) }; // '/*'
 		case '=':
 			eat(); // '='
 			return { AssignKind::QUO, beg, 2_u16 }; // '/='
@@ -398,10 +670,10 @@ Token Lexer::advance() {
 			switch (rune_) {
 			case '<': // ..<
 				eat(); // Eat '<'
-				return { OperatorKind::RANGEHALF, beg, position_.delta(beg) }; // '..<'
+				return { OperatorKind::RANGEHALF, beg, delta(beg) }; // '..<'
 			case '=': // ..=
 				eat(); // Eat '='
-				return { OperatorKind::RANGEFULL, beg, position_.delta(beg) }; // '..='
+				return { OperatorKind::RANGEFULL, beg, delta(beg) }; // '..='
 			}
 			return { OperatorKind::ELLIPSIS, beg, 2_u16 }; // '..'
 		case '0': case '1': case '2': case '3': case '4':
@@ -481,8 +753,11 @@ Token Lexer::advance() {
 	case '"':
 		return scan_string();
 	default:
-		eat();
-		return { TokenKind::INVALID, beg, 1_u16 };
+		{
+			const auto length = Uint16(position_.next_offset - beg);
+			eat();
+			return { TokenKind::INVALID, beg, length };
+		}
 	}
 	return { TokenKind::ENDOF, beg, 1_u16 };
 }
@@ -517,4 +792,414 @@ Token Lexer::next() {
 	return token;
 }
 
+Bool TokenBuffer::reserve(Ulen length) {
+	return kinds_.reserve(length)
+	    && subs_.reserve(length)
+	    && offsets_.reserve(length)
+	    && lengths_.reserve(length);
+}
+
+// The as_* member of [token] or zero when it does not have one.
+static Uint8 sub_kind(Token token) {
+	switch (token.kind) {
+	case TokenKind::ASSIGNMENT:
+		return Uint8(token.as_assign);
+	case TokenKind::LITERAL:
+		return Uint8(token.as_literal);
+	case TokenKind::OPERATOR:
+		return Uint8(token.as_operator);
+	case TokenKind::KEYWORD:
+		return Uint8(token.as_keyword);
+	case TokenKind::DIRECTIVE:
+		return Uint8(token.as_directive);
+	default:
+		return 0;
+	}
+}
+
+Bool TokenBuffer::push_back(Token token) {
+	return kinds_.push_back(token.kind)
+	    && subs_.push_back(sub_kind(token))
+	    && offsets_.push_back(token.offset)
+	    && lengths_.push_back(token.length);
+}
+
+Bool TokenBuffer::append(const TokenBuffer& other, Ulen index) {
+	if (!reserve(length() + other.length() - index)) {
+		return false;
+	}
+	for (Ulen i = index; i < other.length(); i++) {
+		if (!kinds_.push_back(other.kinds_[i])
+		 || !subs_.push_back(other.subs_[i])
+		 || !offsets_.push_back(other.offsets_[i])
+		 || !lengths_.push_back(other.lengths_[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Lex the tokens from [lexer] which begin before [end] into this buffer. Stops
+// after ENDOF or on the first token at or after [end] which is written to [next]
+// instead.
+Bool TokenBuffer::fill(Lexer& lexer, Uint32 end, Token& next) {
+	for (;;) {
+		const auto token = lexer.next();
+		if (token.kind == TokenKind::COMMENT) {
+			continue;
+		}
+		if (token.offset >= end) {
+			next = token;
+			return true;
+		}
+		if (!push_back(token)) {
+			return false;
+		}
+		if (token.kind == TokenKind::ENDOF) {
+			return true;
+		}
+	}
+}
+
+// Find the index of [token] in this buffer.
+Maybe<Ulen> TokenBuffer::find(Token token) const {
+	// Offsets only ever increase but some tokens like IMPLICITSEMI and ENDOF at the
+	// end of the input can share one.
+	Ulen lo = 0;
+	Ulen hi = length();
+	while (lo < hi) {
+		const auto mid = lo + (hi - lo) / 2;
+		if (offsets_[mid] < token.offset) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	const auto sub = sub_kind(token);
+	for (Ulen i = lo; i < length() && offsets_[i] == token.offset; i++) {
+		if (kinds_[i] == token.kind && subs_[i] == sub && lengths_[i] == token.length) {
+			return i;
+		}
+	}
+	return {};
+}
+
+Maybe<TokenBuffer> TokenBuffer::tokenize(Lexer& lexer, Allocator& allocator) {
+	TokenBuffer buffer{allocator};
+	// Odin source averages about five bytes a token so reserving for one every four
+	// bytes is enough to tokenize most files without having to grow.
+	if (!buffer.reserve(lexer.input().length() / 4 + 1)) {
+		return {};
+	}
+	Token next{TokenKind::ENDOF, 0, 0};
+	if (!buffer.fill(lexer, 0xff'ff'ff'ff_u32, next)) {
+		return {};
+	}
+	return buffer;
+}
+
+// A chunk of the input lexed on a thread of its own. The chunk is [beg, end) of
+// the input but lexing starts at [beg] and stops at the first token beginning at
+// or after [end], which is kept in [next].
+struct TokenBuffer::Chunk {
+	Chunk(Allocator& allocator, const Lexer& other, Uint32 beg, Uint32 end, Ulen size)
+		: lexer{allocator, other, beg}
+		, tokens{allocator}
+		, end{end}
+		, size{size}
+	{
+	}
+	static void run(System&, void* user) {
+		auto& chunk = *static_cast<Chunk*>(user);
+		chunk.ok = chunk.tokens.reserve(chunk.size / 4 + 1)
+		        && chunk.tokens.fill(chunk.lexer, chunk.end, chunk.next);
+	}
+	Lexer       lexer;
+	TokenBuffer tokens;
+	Uint32      end;
+	Ulen        size; // Size of the chunk in bytes
+	Token       next{TokenKind::ENDOF, 0, 0};
+	Uint32      from = 0xff'ff'ff'ff_u32; // Offset of the first token found to be right
+	Bool        ok = false;
+};
+
+Maybe<TokenBuffer> TokenBuffer::tokenize(System& sys, Lexer& lexer, Allocator& allocator, Ulen threads) {
+	// Smallest chunk worth starting a thread for.
+	static constexpr const Ulen CHUNK_MIN = 1 << 20;
+
+	const auto input = lexer.input();
+	const auto length = input.length();
+	auto chunks = length / CHUNK_MIN;
+	if (chunks > threads) {
+		chunks = threads;
+	}
+	if (chunks <= 1) {
+		return tokenize(lexer, allocator);
+	}
+
+	// The chunks are lexed into memory from the system allocator as it's the only
+	// allocator safe to use from multiple threads at once.
+	SystemAllocator heap{sys};
+	Array<Chunk> work{heap};
+	if (!work.reserve(chunks)) {
+		return {};
+	}
+
+	// Split just after the first newline at or after each multiple of the chunk
+	// size. The state of the lexer after lexing a newline is always the same: any
+	// IMPLICITSEMI for it has been produced and asi_ is false, which is the state
+	// a new lexer starts in. Where the newline is actually inside of a string or
+	// comment the chunk is wrong, that is found and fixed when stitching.
+	Ulen beg = 0;
+	for (Ulen i = 1; i <= chunks; i++) {
+		Ulen end = length;
+		if (i != chunks) {
+			end = simd_scan<ScanNewline>(input.data(), i * (length / chunks), length) + 1;
+		}
+		if (end <= beg) {
+			continue;
+		}
+		const auto last = end >= length;
+		if (!work.emplace_back(heap,
+		                       lexer,
+		                       Uint32(beg),
+		                       last ? 0xff'ff'ff'ff_u32 : Uint32(end),
+		                       (last ? length : end) - beg))
+		{
+			return {};
+		}
+		if (last) {
+			break;
+		}
+		beg = end;
+	}
+
+	// The first chunk is lexed on this thread while the others are being lexed.
+	// When a thread cannot be started that chunk is lexed here too.
+	Array<Thread> pool{heap};
+	if (!pool.reserve(work.length())) {
+		return {};
+	}
+	for (Ulen i = 1; i < work.length(); i++) {
+		if (auto thread = Thread::start(sys, Chunk::run, &work[i])) {
+			if (!pool.push_back(move(*thread))) {
+				return {};
+			}
+		} else {
+			Chunk::run(sys, &work[i]);
+		}
+	}
+	Chunk::run(sys, &work[0]);
+	for (auto& thread : pool) {
+		thread.join();
+	}
+	Ulen total = 0;
+	for (const auto& chunk : work) {
+		if (!chunk.ok) {
+			return {};
+		}
+		total += chunk.tokens.length();
+	}
+
+	// The first chunk is always right since it starts at the start. The [next]
+	// token of a chunk which is right is the next token of the whole input. When
+	// the chunk that token begins in has the same token then that chunk is right
+	// from that token onwards, since a lexer that produces the same token at the
+	// same offset is left in the same state. Otherwise the lexer of the chunk that
+	// is right lexes on until the two agree or it reaches the next chunk.
+	TokenBuffer result{allocator};
+	if (!result.reserve(total + 1)) {
+		return {};
+	}
+
+	// The lengths of long tokens are kept by the lexer of each chunk, those of the
+	// tokens from where a chunk is right are moved into [lexer].
+	auto finish = [&]() -> Maybe<TokenBuffer> {
+		for (auto& chunk : work) {
+			for (auto entry : chunk.lexer.long_) {
+				if (entry.k >= chunk.from && !lexer.long_.insert(entry.k, entry.v)) {
+					return {};
+				}
+			}
+		}
+		return move(result);
+	};
+
+	work[0].from = 0;
+	Ulen right = 0; // The last chunk which is right
+	Ulen index = 0; // Index in [work[right].tokens] to append from
+	for (Ulen chunk = 0;;) {
+		auto& source = work[right];
+		if (!result.append(source.tokens, index)) {
+			return {};
+		}
+		if (source.tokens.length() && source.tokens.kinds_.last() == TokenKind::ENDOF) {
+			return finish();
+		}
+		auto next = source.next;
+		for (;;) {
+			while (next.offset >= work[chunk].end) {
+				chunk++;
+			}
+			if (auto found = work[chunk].tokens.find(next)) {
+				right = chunk;
+				index = *found;
+				work[chunk].from = next.offset;
+				break;
+			}
+			// The chunk is wrong here, lex on with the lexer of the right chunk.
+			if (!result.push_back(next)) {
+				return {};
+			}
+			if (next.kind == TokenKind::ENDOF) {
+				return finish();
+			}
+			do {
+				next = source.lexer.next();
+			} while (next.kind == TokenKind::COMMENT);
+		}
+	}
+}
+
+// A token as it goes through the ring, with the whole length of long tokens.
+struct Lexeme {
+	TokenKind kind;
+	Uint8     sub;
+	Uint32    offset;
+	Uint32    length;
+};
+
+struct TokenStream::State {
+	// Tokens are written and read in batches so that the ends of the ring move
+	// once a batch rather than once a token.
+	static constexpr const Ulen BATCH = 256;
+
+	State(System& sys, const Lexer& other)
+		: heap{sys}
+		, lexer{heap, other, 0}
+	{
+	}
+
+	static void run(System& sys, void* user) {
+		auto& self = *static_cast<State*>(user);
+		const auto start = MonotonicTime::now(sys);
+		Lexeme batch[BATCH];
+		Ulen n = 0;
+		for (Bool last = false; !last; /**/) {
+			const auto token = self.lexer.next();
+			if (token.kind == TokenKind::COMMENT) {
+				continue;
+			}
+			batch[n++] = { token.kind, sub_kind(token), token.offset, self.lexer.length(token) };
+			last = token.kind == TokenKind::ENDOF;
+			if (n != BATCH && !last) {
+				continue;
+			}
+			auto pending = Slice<const Lexeme> { batch, n };
+			pending = pending.slice(self.ring.write(pending));
+			if (!pending.is_empty()) {
+				// The ring is full, wait for the reader to make room.
+				const auto wait = MonotonicTime::now(sys);
+				self.stats.full++;
+				do {
+					if (self.stop.load(MemoryOrder::relaxed)) {
+						return;
+					}
+					sys.scheduler.yield(sys);
+					pending = pending.slice(self.ring.write(pending));
+				} while (!pending.is_empty());
+				self.stats.full_wait += MonotonicTime::now(sys) - wait;
+			}
+			self.stats.tokens += n;
+			n = 0;
+		}
+		self.stats.lexing = MonotonicTime::now(sys) - start;
+	}
+
+	SystemAllocator    heap;
+	Lexer              lexer;
+	Maybe<Thread>      thread;
+	Atomic<Bool>       stop{false}; // Set once the reader is done with the stream
+	Bool               done = false; // The reader has read the ENDOF token
+	Stats              stats; // The reader only counts [empty] and [empty_wait]
+	Ring<Lexeme, 8192> ring;
+};
+
+Maybe<TokenStream> TokenStream::start(System& sys, const Lexer& lexer) {
+	SystemAllocator heap{sys};
+	auto state = heap.create<State>(sys, lexer);
+	if (!state) {
+		return {};
+	}
+	auto thread = Thread::start(sys, State::run, state);
+	if (!thread) {
+		heap.destroy(state);
+		return {};
+	}
+	state->thread = move(*thread);
+	return TokenStream { sys, state };
+}
+
+TokenStream::~TokenStream() {
+	if (state_) {
+		state_->stop.store(true);
+		SystemAllocator heap{sys_};
+		heap.destroy(state_);
+	}
+}
+
+Bool TokenStream::read(TokenBuffer& tokens, Lexer& lexer) {
+	auto& self = *state_;
+	if (self.done) {
+		return false;
+	}
+	Lexeme batch[State::BATCH];
+	auto n = self.ring.read(Slice<Lexeme> { batch, State::BATCH });
+	if (n == 0) {
+		const auto wait = MonotonicTime::now(sys_);
+		self.stats.empty++;
+		do {
+			sys_.scheduler.yield(sys_);
+			n = self.ring.read(Slice<Lexeme> { batch, State::BATCH });
+		} while (n == 0);
+		self.stats.empty_wait += MonotonicTime::now(sys_) - wait;
+	}
+	auto fail = [&] {
+		self.done = true;
+		self.stop.store(true);
+		if (tokens.length() != 0) {
+			tokens.kinds_.last() = TokenKind::ENDOF;
+		}
+		return false;
+	};
+	if (!tokens.reserve(tokens.length() + n)) {
+		return fail();
+	}
+	for (Ulen i = 0; i < n; i++) {
+		const auto& lexeme = batch[i];
+		const auto length = lexeme.length <= 0xffff ? Uint16(lexeme.length) : 0_u16;
+		if (length == 0 && lexeme.length != 0 && !lexer.long_.insert(lexeme.offset, lexeme.length)) {
+			return fail();
+		}
+		// Cannot fail, the space was reserved.
+		(void)tokens.kinds_.push_back(lexeme.kind);
+		(void)tokens.subs_.push_back(lexeme.sub);
+		(void)tokens.offsets_.push_back(lexeme.offset);
+		(void)tokens.lengths_.push_back(length);
+		if (lexeme.kind == TokenKind::ENDOF) {
+			self.done = true;
+		}
+	}
+	return true;
+}
+
+TokenStream::Stats TokenStream::stats() {
+	state_->stop.store(true);
+	if (state_->thread) {
+		state_->thread->join();
+	}
+	return state_->stats;
+}
+
 } // namespace Thor
\ No newline at end of file
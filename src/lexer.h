@@ -1,8 +1,11 @@
 #ifndef THOR_LEXER_H
 #define THOR_LEXER_H
 #include "util/array.h"
+#include "util/file.h"
+#include "util/map.h"
 #include "util/maybe.h"
 #include "util/string.h"
+#include "util/time.h"
 #include "util/unicode.h"
 
 namespace Thor {
@@ -91,7 +94,7 @@ struct Token {
 		KeywordKind   as_keyword;
 		DirectiveKind as_directive;
 	};              // 1b
-	Uint16 length;  // 2b (if 0, length is too long and must be re-lexed at the given offset)
+	Uint16 length;  // 2b (if 0, length is too long and is kept by the Lexer, see Lexer::length)
 	Uint32 offset;  // 4b
 };
 static_assert(sizeof(Token) == 8, "Token cannot be larger than 64-bits");
@@ -99,18 +102,17 @@ static_assert(sizeof(Token) == 8, "Token cannot be larger than 64-bits");
 struct Allocator;
 
 struct Position {
-	Uint32 line        = 0;
-	Uint32 column      = 0;
 	Uint32 next_offset = 0;
 	Uint32 this_offset = 0;
-	void advance_column() {
+	// Advance past the current rune onto the next one which is [length] bytes.
+	void advance(Uint32 length = 1) {
 		this_offset = next_offset;
-		next_offset++;
-		column++;
+		next_offset += length;
 	}
-	void advance_line() {
-		line++;
-		column = 0;
+	// Advance directly to the rune at [offset] which is [length] bytes.
+	void advance_to(Uint32 offset, Uint32 length = 1) {
+		this_offset = offset;
+		next_offset = offset + length;
 	}
 	Uint16 delta(Uint32 beg) const {
 		const auto diff = this_offset - beg;
@@ -124,9 +126,14 @@ struct Position {
 
 struct Lexer {
 	static Maybe<Lexer> open(System& sys, StringView file);
+	static Maybe<Lexer> open(Array<Uint8>&& data);
 	Lexer(Lexer&& other)
-		: map_{move(other.map_)}
+		: data_{move(other.data_)}
+		, map_{move(other.map_)}
 		, input_{other.input_}
+		, invalid_{other.invalid_}
+		, lines_{move(other.lines_)}
+		, long_{move(other.long_)}
 		, position_{other.position_}
 		, rune_{exchange(other.rune_, 0)}
 		, asi_{exchange(other.asi_, false)}
@@ -134,50 +141,224 @@ struct Lexer {
 	}
 	Token next();
 	void eat();
+
+	// Classify the identifier [ident] at [offset] as a named operator, keyword or
+	// plain identifier.
+	static Token classify(StringView ident, Uint32 offset);
 	THOR_FORCEINLINE constexpr StringView input() const {
 		return input_;
 	}
-	THOR_FORCEINLINE constexpr StringView string(Token token) const {
-		return input_.slice(token.offset).truncate(token.length);
+	THOR_FORCEINLINE StringView string(Token token) const {
+		return input_.slice(token.offset).truncate(length(token));
+	}
+
+	// The length of [token] in bytes. Tokens 64 KiB or longer do not fit in the
+	// length of Token so theirs are kept in a table by the offset of the token.
+	THOR_FORCEINLINE Uint32 length(Token token) const {
+		if (token.length != 0) {
+			return token.length;
+		}
+		if (auto entry = long_.find(token.offset)) {
+			return entry->v;
+		}
+		return 0;
 	}
 
-	// Calculate the source position for a given token.
+	// The offset of the first byte of the input which is not valid UTF-8, if any.
+	// Non-ASCII bytes at or after it are each lexed as U+FFFD.
+	Maybe<Uint32> invalid_utf8() const {
+		if (invalid_ < input_.length()) {
+			return Uint32{invalid_};
+		}
+		return {};
+	}
+
+	// Calculate the source position for a given token. The table of line offsets
+	// used to find it is only built on the first call since it's only needed when
+	// there are diagnostics to report. If the table cannot be allocated both the
+	// line and column are zero.
 	struct SourcePosition {
 		Uint32 line   = 0;
 		Uint32 column = 0;
 	};
-	SourcePosition position(Uint32 offset) const {
-		Uint32 line   = 1;
-		Uint32 column = 1;
-		for (Uint32 i = 0; i < offset; i++) {
-			if (input_[i] == '\n') {
-				column = 1;
-				line++;
-			} else {
-				column++;
-			}
-		}
-		return SourcePosition { line, column };
-	}
+	SourcePosition position(Uint32 offset);
 
 private:
+	friend struct TokenBuffer;
+	friend struct TokenStream;
+	friend struct Parser;
 	Token advance();
 	Token scan_string();
 	void scan_escape();
 	Token scan_number(Bool leading_period);
-	Lexer(Array<Uint8>&& map)
-		: map_{move(map)}
-		, input_{map_.slice().cast<const char>()}
+	void skip(Ulen offset);
+	void decode(Uint32 offset);
+	Uint16 delta(Uint32 beg);
+	template<typename C>
+	void skip();
+	Bool index_lines();
+	Lexer(Array<Uint8>&& data)
+		: data_{move(data)}
+		, input_{data_.slice().cast<const char>()}
+		, invalid_{validate(input_)}
+		, lines_{data_.allocator()}
+		, long_{data_.allocator()}
 	{
 		eat();
 	}
-	Array<Uint8> map_;
-	StringView   input_;
-	Position     position_;
+	Lexer(Allocator& allocator, FileMap&& map)
+		: data_{allocator}
+		, map_{move(map)}
+		, input_{map_->data().cast<const char>()}
+		, invalid_{validate(input_)}
+		, lines_{allocator}
+		, long_{allocator}
+	{
+		eat();
+	}
+	// A lexer over the input of [other], starting at [offset] which must be where
+	// [other] could also start lexing a token.
+	Lexer(Allocator& allocator, const Lexer& other, Uint32 offset)
+		: data_{allocator}
+		, input_{other.input_}
+		, invalid_{other.invalid_}
+		, lines_{allocator}
+		, long_{allocator}
+	{
+		position_.next_offset = offset;
+		eat();
+	}
+	// The input is either a mapping of the file or a copy of it in [data_] when
+	// the file could not be mapped. Neither has a terminator or padding on the
+	// end, the lexer checks offsets against the length of [input_] to find EOF.
+	static Uint32 validate(StringView input) {
+		return Uint32(utf8_validate(reinterpret_cast<const Uint8*>(input.data()), input.length()));
+	}
+	Array<Uint8>   data_;
+	Maybe<FileMap> map_;
+	StringView     input_;
+	Uint32         invalid_; // Offset of the first byte which is not valid UTF-8
+	Array<Uint32>  lines_; // Offset of the first byte of each line
+	Map<Uint32, Uint32> long_; // Length of each token too long for Token::length by offset
+	Position       position_;
 	Rune         rune_ = 0;
 	Bool         asi_  = false;
 };
 
+// All the tokens of a file stored column-wise, one Array per field of Token. The
+// whole file is lexed up front with tokenize() so that the parser can walk the
+// tokens by index, which keeps the lexer and parser from fighting over the
+// instruction cache and gives arbitrary lookahead for free.
+//
+// Comments are dropped since the parser never looks at them. The last token is
+// always ENDOF.
+struct TokenBuffer {
+	static Maybe<TokenBuffer> tokenize(Lexer& lexer, Allocator& allocator);
+
+	// The same as above except large inputs are split into chunks and lexed on up
+	// to [threads] threads. The tokens are exactly those the single threaded form
+	// gives. The chunks are split at newlines, the lexer state after a newline that
+	// is not inside of a token is always the same so each chunk can be lexed from
+	// that state on its own. Whether the newline really was outside of a token is
+	// only known once the chunk before it is lexed, so the chunks are stitched
+	// together where their tokens agree and any chunk which turns out to have been
+	// split inside of a token is lexed again.
+	static Maybe<TokenBuffer> tokenize(System& sys, Lexer& lexer, Allocator& allocator, Ulen threads);
+
+	THOR_FORCEINLINE Token operator[](Ulen index) const {
+		const auto offset = offsets_[index];
+		const auto length = lengths_[index];
+		const auto sub    = subs_[index];
+		switch (const auto kind = kinds_[index]) {
+		case TokenKind::ASSIGNMENT:
+			return { AssignKind(sub), offset, length };
+		case TokenKind::LITERAL:
+			return { LiteralKind(sub), offset, length };
+		case TokenKind::OPERATOR:
+			return { OperatorKind(sub), offset, length };
+		case TokenKind::KEYWORD:
+			return { KeywordKind(sub), offset, length };
+		case TokenKind::DIRECTIVE:
+			return { DirectiveKind(sub), offset, length };
+		default:
+			return { kind, offset, length };
+		}
+	}
+
+	THOR_FORCEINLINE TokenKind kind(Ulen index) const { return kinds_[index]; }
+	THOR_FORCEINLINE Uint32 offset(Ulen index) const { return offsets_[index]; }
+	[[nodiscard]] THOR_FORCEINLINE Ulen length() const { return kinds_.length(); }
+
+private:
+	friend struct Parser;
+	friend struct TokenStream;
+	struct Chunk;
+	TokenBuffer(Allocator& allocator)
+		: kinds_{allocator}
+		, subs_{allocator}
+		, offsets_{allocator}
+		, lengths_{allocator}
+	{
+	}
+	[[nodiscard]] Bool reserve(Ulen length);
+	[[nodiscard]] Bool push_back(Token token);
+	[[nodiscard]] Bool append(const TokenBuffer& other, Ulen index);
+	[[nodiscard]] Bool fill(Lexer& lexer, Uint32 end, Token& next);
+	Maybe<Ulen> find(Token token) const;
+	Array<TokenKind> kinds_;
+	Array<Uint8>     subs_;    // The as_* member of Token, zero when there is none
+	Array<Uint32>    offsets_;
+	Array<Uint16>    lengths_;
+};
+
+// Lexes a file on a thread of its own while the tokens are read on another, so
+// lexing and parsing a large file overlap on two cores. The lexing thread writes
+// the tokens to a Ring of fixed size and waits whenever it's full, so it never
+// runs more than a ring's worth ahead of the reader and takes no more memory no
+// matter how large the file is. The reader appends the tokens to a TokenBuffer
+// as it needs them, which ends up with the same tokens tokenize() gives.
+struct TokenStream {
+	struct Stats {
+		Ulen    tokens = 0;
+		Ulen    full   = 0;  // Times the lexing thread waited for room in the ring
+		Ulen    empty  = 0;  // Times the reader waited for tokens
+		Seconds lexing{0.0}; // Time the lexing thread ran for, waits included
+		Seconds full_wait{0.0};
+		Seconds empty_wait{0.0};
+	};
+
+	// Start lexing the input of [lexer] from the beginning on a thread of its own.
+	// Gives nothing when the thread could not be started.
+	static Maybe<TokenStream> start(System& sys, const Lexer& lexer);
+
+	TokenStream(TokenStream&& other)
+		: sys_{other.sys_}
+		, state_{exchange(other.state_, nullptr)}
+	{
+	}
+	~TokenStream();
+
+	// Append the tokens lexed so far to [tokens], waiting for at least one when
+	// there are none yet. The lengths of long tokens are given to [lexer], which
+	// must be the lexer the stream was started with. Returns false once the ENDOF
+	// token was appended. When out of memory the last token in [tokens] is made
+	// the ENDOF token so that the reader still comes to an end.
+	Bool read(TokenBuffer& tokens, Lexer& lexer);
+
+	// Waits for the lexing thread to be done, the stats are only final then.
+	Stats stats();
+
+private:
+	struct State;
+	TokenStream(System& sys, State* state)
+		: sys_{sys}
+		, state_{state}
+	{
+	}
+	System& sys_;
+	State*  state_;
+};
+
 } // namespace Thor
 
 #endif // THOR_LEXER_H
@@ -3,7 +3,7 @@
 #include "util/map.h"
 #include "util/stream.h"
 
-#include "parser.h"
+#include "driver.h"
 
 #include "cg_llvm.h"
 
@@ -19,7 +19,39 @@ namespace Thor {
 
 using namespace Thor;
 
-int main(int, char **) {
+static StringView from_cstr(const char* str) {
+	Ulen length = 0;
+	while (str[length]) length++;
+	return { str, length };
+}
+
+static Maybe<Ulen> parse_uint(StringView str) {
+	if (str.is_empty()) {
+		return {};
+	}
+	Ulen value = 0;
+	for (auto ch : str) {
+		if (ch < '0' || ch > '9') {
+			return {};
+		}
+		value = value * 10 + (ch - '0');
+	}
+	return value;
+}
+
+// Usage: thor [-t threads] [-e errors] [-s bytes] [-q] [-l] [-C cache] [-c name=dir...] [file.odin|dir...]
+//
+// Parses each file, a directory stands for all of the .odin files in it, and
+// dumps the AST of each after its diagnostics unless -q is given. The packages
+// the files import are parsed too, an import of "name:path" is found in dir/path
+// for each -c name=dir. With -l the bodies of the procedures in imported packages
+// are skipped rather than parsed. A file is given up on after 32 errors unless
+// -e gives another limit, -e 0 is no limit. The files are parsed on all the
+// hardware threads unless -t is given. A file of at least the bytes given with
+// -s is lexed on a thread of its own while it's parsed. With -C the AST of each
+// file is kept in the directory cache and a file which has not changed since is
+// not parsed again. With no files given it parses test/ks.odin.
+int main(int argc, char** argv) {
 	System sys {
 		STD_FILESYSTEM,
 		STD_HEAP,
@@ -30,35 +62,77 @@ int main(int, char **) {
 		STD_CHRONO,
 	};
 
-
-	auto parser = Parser::open(sys, "test/ks.odin");
-	if (!parser) {
+	Driver driver{sys};
+	Ulen threads = sys.scheduler.thread_count(sys);
+	Bool dump = true;
+	Bool any = false;
+	for (int i = 1; i < argc; i++) {
+		const auto arg = from_cstr(argv[i]);
+		if (arg == "-t" && i + 1 < argc) {
+			if (auto n = parse_uint(from_cstr(argv[i + 1])); n && *n) {
+				threads = *n;
+			}
+			i++;
+			continue;
+		}
+		if (arg == "-e" && i + 1 < argc) {
+			if (auto n = parse_uint(from_cstr(argv[i + 1]))) {
+				driver.error_limit(*n);
+			}
+			i++;
+			continue;
+		}
+		if (arg == "-s" && i + 1 < argc) {
+			if (auto n = parse_uint(from_cstr(argv[i + 1]))) {
+				driver.stream_threshold(*n);
+			}
+			i++;
+			continue;
+		}
+		if (arg == "-c" && i + 1 < argc) {
+			const auto collection = from_cstr(argv[++i]);
+			for (Ulen j = 0; j < collection.length(); j++) {
+				if (collection[j] == '=') {
+					if (!driver.collection(collection.truncate(j), collection.slice(j + 1))) {
+						return 1;
+					}
+					break;
+				}
+			}
+			continue;
+		}
+		if (arg == "-C" && i + 1 < argc) {
+			if (!driver.cache(from_cstr(argv[++i]))) {
+				return 1;
+			}
+			continue;
+		}
+		if (arg == "-l") {
+			driver.lazy_imports(true);
+			continue;
+		}
+		if (arg == "-q") {
+			dump = false;
+			continue;
+		}
+		if (!driver.add(arg)) {
+			return 1;
+		}
+		any = true;
+	}
+	if (!any && !driver.add("test/ks.odin")) {
 		return 1;
 	}
 
-	Array<AstRef<AstStmt>> stmts{sys.allocator};
-	for (;;) {
-		auto stmt = parser->parse_stmt(false, {}, {});
-		if (!stmt) {
-			break;
-		}
-		if (!stmts.push_back(move(stmt))) {
-			break;
-		}
+	if (!driver.parse(threads, dump)) {
+		return 1;
 	}
+	driver.report();
 
-	auto& ast = parser->ast();
-	StringBuilder builder{sys.allocator};
-	for (auto stmt : stmts) {
-		if (ast[stmt].is_stmt<AstEmptyStmt>()) {
-			continue;
+	for (const auto unit : driver.units()) {
+		if (!unit->ok) {
+			return 1;
 		}
-		ast[stmt].dump(ast, builder, 0);
-		builder.put('\n');
-	}
-	if (auto result = builder.result()) {
-		sys.console.write(sys, *result);
-		sys.console.write(sys, StringView { "\n" });
 	}
 
 	return 0;
@@ -36,36 +36,337 @@ struct Debug {
 // 	auto debug_ ## __LINE__ = Debug{sys_, __func__, __FILE__, __LINE__}
 
 Uint32 Parser::eat() {
-	Uint32 offset = 0;
-	do {
-		offset = token_.offset;
-		token_ = lexer_.next();
-	} while (is_kind(TokenKind::COMMENT));
+	const auto offset = token_.offset;
+	if (cursor_ + 1 < tokens_.length() || (stream_ && stream_->read(tokens_, lexer_))) {
+		cursor_++;
+	}
+	token_ = tokens_[cursor_];
 	return offset;
 }
 
 Maybe<Parser> Parser::open(System& sys, StringView filename) {
+	return open(sys, filename, sys.scheduler.thread_count(sys));
+}
+
+Maybe<Parser> Parser::open(System& sys, StringView filename, Ulen threads) {
 	auto lexer = Lexer::open(sys, filename);
 	if (!lexer) {
 		// Could not open filename
 		return {};
 	}
+	return open(sys, filename, move(*lexer), threads);
+}
+
+Maybe<Parser> Parser::open(System& sys, StringView filename, Lexer&& lexer, Ulen threads) {
+	const auto invalid = lexer.invalid_utf8();
+	auto tokens = TokenBuffer::tokenize(sys, lexer, sys.allocator, threads);
+	if (!tokens) {
+		// Out of memory
+		return {};
+	}
+	auto parser = open(sys, filename, move(lexer), move(*tokens));
+	if (parser && invalid) {
+		parser->error(*invalid, "Invalid UTF-8");
+		parser->flush();
+		return {};
+	}
+	return parser;
+}
+
+Maybe<Parser> Parser::open(System& sys, StringView filename, Lexer&& lexer, TokenBuffer&& tokens) {
 	auto file = AstFile::create(sys, filename);
 	if (!file) {
 		// Could not create astfile
 		return {};
 	}
-	return Parser { sys, move(*lexer), move(*file) };
+	return Parser { sys, move(lexer), move(tokens), move(*file) };
 }
 
-Parser::Parser(System& sys, Lexer&& lexer, AstFile&& ast)
+Maybe<Parser> Parser::open_streaming(System& sys, StringView filename, Lexer&& lexer) {
+	const auto invalid = lexer.invalid_utf8();
+	auto stream = TokenStream::start(sys, lexer);
+	if (!stream) {
+		return {};
+	}
+	auto file = AstFile::create(sys, filename);
+	if (!file) {
+		return {};
+	}
+	// The parser begins on the first token so that has to be read first. The
+	// tokens are reserved for as if tokenize() was used.
+	TokenBuffer tokens{sys.allocator};
+	if (!tokens.reserve(lexer.input().length() / 4 + 1) || !stream->read(tokens, lexer)) {
+		return {};
+	}
+	Parser parser{sys, move(lexer), move(tokens), move(*file)};
+	parser.stream_ = move(*stream);
+	if (invalid) {
+		parser.error(*invalid, "Invalid UTF-8");
+		parser.flush();
+		return {};
+	}
+	return parser;
+}
+
+Parser::Parser(System& sys, Lexer&& lexer, TokenBuffer&& tokens, AstFile&& ast)
 	: sys_{sys}
-	, temporary_{static_cast<Allocator&>(sys.allocator)}
 	, ast_{move(ast)}
 	, lexer_{move(lexer)}
-	, token_{TokenKind::INVALID, 0, 0}
+	, tokens_{move(tokens)}
+	, token_{tokens_[0]}
+	, pending_{sys.allocator}
+	, ops_{sys.allocator}
+	, operands_{sys.allocator}
+	, top_{sys.allocator}
+	, stmts_{sys.allocator}
+	, nodes_{sys.allocator}
+	, diagnostics_{sys.allocator}
 {
-	eat();
+}
+
+Bool Parser::parse_file() {
+	ast_.track(&nodes_);
+	const auto ok = parse_top_level(0xff'ff'ff'ff_u32);
+	ast_.track(nullptr);
+	hash_top_level(0, top_.length());
+	return ok;
+}
+
+Bool Parser::parse_top_level(Uint32 end) {
+	while (!is_kind(TokenKind::ENDOF) && token_.offset < end) {
+		const auto begin = top_.is_empty() ? 0_u32 : token_.offset;
+		const auto prev = cursor_ ? tokens_.offset(cursor_ - 1) : 0_u32;
+		const auto first = token_;
+		const auto nodes = nodes_.length();
+		// Every top-level statement is parsed from the same state so that it parses
+		// the same no matter what is before it.
+		expr_level_ = 0;
+		allow_in_expr_ = false;
+		auto stmt = parse_top_stmt();
+		if (!stmt) {
+			return false;
+		}
+		if (!top_.push_back(TopLevel { begin, prev, first, 0, nodes }) || !stmts_.push_back(stmt)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void Parser::hash_top_level(Ulen from, Ulen to) {
+	const auto input = lexer_.input();
+	for (Ulen i = from; i < to; i++) {
+		const auto begin = top_[i].begin;
+		const auto end = i + 1 < top_.length() ? top_[i + 1].begin : input.length();
+		top_[i].hash = input.slice(begin).truncate(end - begin).hash();
+	}
+}
+
+// The same token at the same offset.
+static Bool same_token(Token lhs, Token rhs) {
+	if (lhs.kind != rhs.kind || lhs.offset != rhs.offset || lhs.length != rhs.length) {
+		return false;
+	}
+	switch (lhs.kind) {
+	case TokenKind::ASSIGNMENT:
+		return lhs.as_assign == rhs.as_assign;
+	case TokenKind::LITERAL:
+		return lhs.as_literal == rhs.as_literal;
+	case TokenKind::OPERATOR:
+		return lhs.as_operator == rhs.as_operator;
+	case TokenKind::KEYWORD:
+		return lhs.as_keyword == rhs.as_keyword;
+	case TokenKind::DIRECTIVE:
+		return lhs.as_directive == rhs.as_directive;
+	default:
+		return true;
+	}
+}
+
+Maybe<Parser> Parser::reparse(Parser&& previous, StringView file) {
+	auto lexer = Lexer::open(previous.sys_, file);
+	if (!lexer) {
+		// Could not open file
+		return {};
+	}
+	return reparse(move(previous), file, move(*lexer));
+}
+
+Maybe<Parser> Parser::reparse(Parser&& previous, StringView file, Lexer&& lexer) {
+	auto& sys = previous.sys_;
+	auto reparse_all = [&](Lexer&& lexer) -> Maybe<Parser> {
+		const auto invalid = lexer.invalid_utf8();
+		auto tokens = TokenBuffer::tokenize(sys, lexer, sys.allocator, sys.scheduler.thread_count(sys));
+		if (!tokens) {
+			// Out of memory
+			return {};
+		}
+		auto parser = open(sys, file, move(lexer), move(*tokens));
+		if (!parser) {
+			return {};
+		}
+		if (invalid) {
+			parser->error(*invalid, "Invalid UTF-8");
+			parser->flush();
+			return {};
+		}
+		parser->on_import(previous.on_import_, previous.on_import_user_);
+		parser->error_limit(previous.diagnostics_.limit());
+		parser->ast_.intern(previous.ast_.interning());
+		if (!parser->parse_file()) {
+			parser->flush();
+			return {};
+		}
+		return parser;
+	};
+
+	// Skipped bodies are found by their offsets in the source which are not moved
+	// with the statements after the edit. The errors in statements which are kept would not be
+	// reported again. Nodes shared by interning cannot be destroyed or moved
+	// with the statement they were first made in.
+	const auto& top = previous.top_;
+	if (top.is_empty() || previous.lazy_bodies_ || previous.errors_ || previous.ast_.interning() || lexer.invalid_utf8()) {
+		return reparse_all(move(lexer));
+	}
+
+	// Everything after the edit is moved by [delta], which is unsigned and wraps
+	// around when the file got smaller.
+	const auto old = previous.lexer_.input();
+	const auto now = lexer.input();
+	const auto delta = Uint32(now.length() - old.length());
+	const auto n = top.length();
+	auto unchanged = [&](Ulen i, Uint32 shift) {
+		const auto begin = top[i].begin;
+		const auto end = i + 1 < n ? top[i + 1].begin : old.length();
+		const auto at = Ulen(Uint32(begin + shift));
+		if (at + (end - begin) > now.length()) {
+			return false;
+		}
+		const auto source = now.slice(at).truncate(end - begin);
+		return source.hash() == top[i].hash
+		    && source == old.slice(begin).truncate(end - begin);
+	};
+	// The statements [0, head) are the same at the start and [tail, n) the same at
+	// the end. The last one the same at the start is parsed again anyways as the
+	// parse of it may have looked at the first token of the next one. The first
+	// statement always starts at zero so it cannot be the same at the end.
+	Ulen head = 0;
+	while (head < n && unchanged(head, 0)) {
+		head++;
+	}
+	Ulen tail = n;
+	while (tail > head && tail > 1 && unchanged(tail - 1, delta)) {
+		tail--;
+	}
+	if (head > 0) {
+		head--;
+	}
+	const auto end = tail < n ? top[tail].begin + delta : 0xff'ff'ff'ff_u32;
+	if (end < top[head].begin) {
+		// The same start and end overlap in the edited file.
+		return reparse_all(move(lexer));
+	}
+
+	// Lexing is started from the token before the first statement parsed again.
+	// It lexes the same as before and a lexer that lexes the same token at the
+	// same offset is left in the same state. That token is kept but not parsed.
+	// When it's an IMPLICITSEMI it's skipped over as the newline it's made for
+	// but that leaves the lexer in the same state too.
+	TokenBuffer tokens{sys.allocator};
+	Token next{TokenKind::ENDOF, 0, 0};
+	const auto prev = head ? top[head].prev : 0_u32;
+	Lexer sub{sys.allocator, lexer, prev};
+	if (!tokens.fill(sub, end, next)) {
+		// Out of memory
+		return {};
+	}
+	const auto cursor = head && tokens.length() && tokens.offset(0) == prev ? 1_ulen : 0_ulen;
+	if (tokens.length() <= cursor || (head && !same_token(tokens[cursor], top[head].first))) {
+		// The first statement parsed again does not start with the same token.
+		return reparse_all(move(lexer));
+	}
+	if (tail < n) {
+		// The same goes for the token the statements after the edit start with,
+		// when it's the same so is everything after it.
+		auto first = top[tail].first;
+		first.offset += delta;
+		if (!same_token(next, first)) {
+			return reparse_all(move(lexer));
+		}
+		if (!tokens.push_back(next) || !tokens.push_back(Token { TokenKind::ENDOF, next.offset, 1_u16 })) {
+			return {};
+		}
+	}
+	for (Ulen i = 0; i < tokens.length(); i++) {
+		if (tokens.lengths_[i] == 0) {
+			// The lengths of tokens too long for Token::length are kept by the lexer
+			// that lexed them, which is not the one that's parsed with.
+			return reparse_all(move(lexer));
+		}
+	}
+
+	Parser parser{sys, move(lexer), move(tokens), move(previous.ast_)};
+	parser.on_import(previous.on_import_, previous.on_import_user_);
+	parser.error_limit(previous.diagnostics_.limit());
+	parser.cursor_ = cursor;
+	parser.token_ = parser.tokens_[cursor];
+	const auto& nodes = previous.nodes_;
+	const auto nodes_head = top[head].nodes;
+	const auto nodes_tail = tail < n ? top[tail].nodes : nodes.length();
+	if (!parser.top_.reserve(n) || !parser.stmts_.reserve(n) || !parser.nodes_.reserve(nodes.length())) {
+		return {};
+	}
+	for (Ulen i = 0; i < head; i++) {
+		// Cannot fail, the space was reserved.
+		(void)parser.top_.push_back(top[i]);
+		(void)parser.stmts_.push_back(previous.stmts_[i]);
+	}
+	for (Ulen i = 0; i < nodes_head; i++) {
+		(void)parser.nodes_.push_back(nodes[i]);
+	}
+
+	// Errors are not reported, the whole file is parsed again instead which does.
+	parser.quiet_ = true;
+	parser.ast_.track(&parser.nodes_);
+	auto ok = parser.parse_top_level(end) && parser.errors_ == 0;
+	parser.ast_.track(nullptr);
+	parser.quiet_ = false;
+	// Each statement before the edit must end where the next one starts.
+	if (ok && tail < n) {
+		ok = parser.cursor_ == parser.tokens_.length() - 2;
+	}
+	if (!ok) {
+		return reparse_all(move(parser.lexer_));
+	}
+	if (head && cursor == 0) {
+		// The token before the first one was not kept.
+		parser.top_[head].prev = prev;
+	}
+
+	// The nodes of the statements that were parsed again are no longer used.
+	for (Ulen i = nodes_head; i < nodes_tail; i++) {
+		parser.ast_.destroy(nodes[i]);
+	}
+	const auto parsed = parser.top_.length();
+	for (Ulen i = tail; i < n; i++) {
+		auto entry = top[i];
+		entry.begin += delta;
+		entry.prev = i == tail ? parser.tokens_.offset(parser.tokens_.length() - 3) : entry.prev + delta;
+		entry.first.offset += delta;
+		entry.nodes = parser.nodes_.length() + (entry.nodes - nodes_tail);
+		if (!parser.top_.push_back(entry) || !parser.stmts_.push_back(previous.stmts_[i])) {
+			return {};
+		}
+	}
+	for (Ulen i = nodes_tail; i < nodes.length(); i++) {
+		auto& node = parser.ast_[AstRef<AstNode> { nodes[i] }];
+		node.offset += delta;
+		if (!parser.nodes_.push_back(nodes[i])) {
+			return {};
+		}
+	}
+	parser.hash_top_level(head, parsed);
+	return parser;
 }
 
 AstStringRef Parser::parse_ident(Uint32* poffset) {
@@ -85,6 +386,24 @@ AstRef<AstProcExpr> Parser::parse_proc_expr() {
 	if (!type) {
 		return {};
 	}
+	if (lazy_bodies_ && is_kind(TokenKind::LBRACE)) {
+		// Only the braces have to be matched to find the end of the body, nothing
+		// in it is looked at until parse_body.
+		const auto begin = token_.offset;
+		Uint32 end = 0;
+		Ulen depth = 0;
+		do {
+			if (is_kind(TokenKind::LBRACE)) {
+				depth++;
+			} else if (is_kind(TokenKind::RBRACE)) {
+				depth--;
+			} else if (is_kind(TokenKind::ENDOF)) {
+				return error("Expected '}'");
+			}
+			end = eat() + 1;
+		} while (depth);
+		return ast_.create<AstProcExpr>(ast_[type].offset, type, AstRef<AstBlockStmt>{}, begin, end);
+	}
 	auto block = parse_block_stmt();
 	if (!block) {
 		return {};
@@ -92,6 +411,61 @@ AstRef<AstProcExpr> Parser::parse_proc_expr() {
 	return ast_.create<AstProcExpr>(ast_[type].offset, type, block);
 }
 
+AstRef<AstBlockStmt> Parser::parse_body(AstRef<AstProcExpr> proc) {
+	TRACE();
+	const auto begin = ast_[proc].begin;
+	const auto end = ast_[proc].end;
+	if (ast_[proc].body || !begin) {
+		return ast_[proc].body;
+	}
+	// The body is lexed again from its source into tokens of its own, which are
+	// parsed in place of those of the file. The parser then carries on from
+	// wherever it was before. Whatever is left of a stream is read first so that
+	// it's not read into the tokens of the body.
+	while (stream_ && stream_->read(tokens_, lexer_)) {
+		// Read to the end.
+	}
+	TokenBuffer tokens{sys_.allocator};
+	Token next{TokenKind::ENDOF, 0, 0};
+	Lexer sub{sys_.allocator, lexer_, begin};
+	if (!tokens.reserve((end - begin) / 4 + 2) || !tokens.fill(sub, end, next) || !tokens.push_back(Token { TokenKind::ENDOF, end, 1_u16 })) {
+		// Out of memory
+		return {};
+	}
+	// The lengths of tokens too long for Token::length are looked up in [lexer_].
+	for (auto entry : sub.long_) {
+		if (!lexer_.long_.find(entry.k) && !lexer_.long_.insert(entry.k, entry.v)) {
+			return {};
+		}
+	}
+	TokenBuffer file{move(tokens_)};
+	tokens_ = move(tokens);
+	const auto cursor = cursor_;
+	const auto expr_level = expr_level_;
+	const auto allow_in_expr = allow_in_expr_;
+	cursor_ = 0;
+	token_ = tokens_[cursor_];
+	expr_level_ = 0;
+	allow_in_expr_ = false;
+	auto body = parse_block_stmt();
+	if (body && !is_kind(TokenKind::ENDOF)) {
+		body = error("Expected '}'");
+	}
+	tokens_ = move(file);
+	cursor_ = cursor;
+	token_ = tokens_[cursor_];
+	expr_level_ = expr_level;
+	allow_in_expr_ = allow_in_expr;
+	if (body) {
+		// Looked up again as parsing the body made more nodes.
+		auto& node = ast_[proc];
+		node.body = body;
+		node.begin = 0;
+		node.end = 0;
+	}
+	return body;
+}
+
 AstRef<AstExpr> Parser::parse_paren_expr() {
 	TRACE();
 	eat(); // Eat '('
@@ -210,8 +584,7 @@ AstRef<AstStmt> Parser::parse_stmt(Bool is_using,
 			return ast_.create<AstExprStmt>(ast_[expr].offset, expr);
 		}
 
-		Array<AstRef<AstExpr>> lhs{temporary_};
-		Array<AstRef<AstExpr>> rhs{temporary_};
+		PendingList<AstExpr> lhs{*this};
 		AstRef<AstType> type; // Optional type
 		if (!lhs.push_back(expr)) {
 			return {};
@@ -225,6 +598,8 @@ AstRef<AstStmt> Parser::parse_stmt(Bool is_using,
 				return {};
 			}
 		}
+		// Done before anything else is parsed as only the last list can be added.
+		const auto lhs_refs = lhs.commit();
 
 		// When the left-hand side is proceeded by a colon then everything on the
 		// left-hand side is an IdentExpr and an optional Type is expected after
@@ -249,7 +624,9 @@ AstRef<AstStmt> Parser::parse_stmt(Bool is_using,
 		if (is_operator(OperatorKind::IN)) {
 			eat(); // Eat 'in'
 			auto rhs = parse_expr(false);
-			auto lhs_refs = ast_.insert(move(lhs));
+			if (!rhs) {
+				return {};
+			}
 			auto for_in = ast_.create<AstForInExpr>(ast_[expr].offset, lhs_refs, rhs);
 			return ast_.create<AstExprStmt>(ast_[expr].offset, for_in);
 		}
@@ -263,6 +640,7 @@ AstRef<AstStmt> Parser::parse_stmt(Bool is_using,
 		if (is_kind(TokenKind::ASSIGNMENT)) {
 			assign = token_.as_assign;
 		}
+		PendingList<AstExpr> rhs{*this};
 		if (decl == DeclKind::IMMUTABLE || is_kind(TokenKind::ASSIGNMENT)) {
 			eat(); // Eat ':' or '='
 			auto init = parse_expr(false);
@@ -290,10 +668,9 @@ AstRef<AstStmt> Parser::parse_stmt(Bool is_using,
 			eat(); // Eat ';'
 		}
 
-		AstRefArray<AstExpr> lhs_refs = ast_.insert(move(lhs));
 		AstRefArray<AstExpr> rhs_refs;
 		if (!rhs.is_empty()) {
-			rhs_refs = ast_.insert(move(rhs));
+			rhs_refs = rhs.commit();
 		}
 		const auto offset = ast_[expr].offset;
 		if (decl == DeclKind::NONE) {
@@ -301,8 +678,8 @@ AstRef<AstStmt> Parser::parse_stmt(Bool is_using,
 		} else {
 			AstRefArray<AstDirective> d_refs;
 			AstRefArray<AstAttribute> a_refs;
-			if (directives) d_refs = ast_.insert(move(*directives));
-			if (attributes) a_refs = ast_.insert(move(*attributes));
+			if (directives) d_refs = *directives;
+			if (attributes) a_refs = *attributes;
 			return ast_.create<AstDeclStmt>(offset,
 			                                decl == DeclKind::IMMUTABLE,
 			                                is_using,
@@ -313,7 +690,124 @@ AstRef<AstStmt> Parser::parse_stmt(Bool is_using,
 			                                a_refs);
 		}
 	}
-	return {};
+	// Foreign bindings and switch.
+	return error("Statement not supported yet");
+}
+
+AstRef<AstStmt> Parser::parse_top_stmt() {
+	TRACE();
+	if (is_kind(TokenKind::ENDOF)) {
+		return {};
+	}
+	return parse_stmt_or_recover(false);
+}
+
+AstRef<AstStmt> Parser::parse_stmt_or_recover(Bool block) {
+	TRACE();
+	const auto begin = cursor_;
+	recovered_ = errors_;
+	// Parsing carries on past most errors so a statement can have errors and
+	// still be given, but it cannot be trusted to be whole.
+	auto stmt = parse_stmt(false, {}, {});
+	if (stmt && errors_ == recovered_) {
+		return stmt;
+	}
+	return recover(begin, block);
+}
+
+AstRef<AstBadStmt> Parser::recover(Ulen begin, Bool block) {
+	TRACE();
+	// The brackets the statement is in the middle of are found from the tokens it
+	// was parsed from so far. Braces are counted apart from parentheses and
+	// square brackets, a '}' drops whatever of those were left open since its
+	// '{' so that one which is never closed cannot hide the end of the statement.
+	Ulen braces = 0;
+	Ulen parens = 0;
+	Array<Ulen> outer{sys_.allocator}; // The [parens] at each open '{'
+	auto is_operator_at = [&](Ulen index, OperatorKind kind) {
+		return tokens_.kind(index) == TokenKind::OPERATOR && OperatorKind(tokens_.subs_[index]) == kind;
+	};
+	auto nest = [&](Ulen index) {
+		const auto kind = tokens_.kind(index);
+		if (is_operator_at(index, OperatorKind::LPAREN) || is_operator_at(index, OperatorKind::LBRACKET)) {
+			parens++;
+		} else if (is_operator_at(index, OperatorKind::RPAREN) || is_operator_at(index, OperatorKind::RBRACKET)) {
+			parens -= parens != 0;
+		} else if (kind == TokenKind::LBRACE) {
+			braces++;
+			if (!outer.push_back(parens)) {
+				outer.clear();
+			}
+			parens = 0;
+		} else if (kind == TokenKind::RBRACE) {
+			braces -= braces != 0;
+			parens = 0;
+			if (!outer.is_empty()) {
+				parens = outer.last();
+				outer.pop_back();
+			}
+		}
+	};
+	// At the top level a declaration, 'name ::', at the start of a line begins
+	// the next statement whatever parentheses or brackets were left open before
+	// it. Found once both of its colons were skipped over, the skipping then goes
+	// back to the name.
+	auto is_decl = [&]() {
+		if (cursor_ < begin + 3 || !is_operator(OperatorKind::COLON)
+		 || !is_operator_at(cursor_ - 1, OperatorKind::COLON)
+		 || tokens_.kind(cursor_ - 2) != TokenKind::IDENTIFIER)
+		{
+			return false;
+		}
+		// Nothing but blanks before the name on its line.
+		const auto input = lexer_.input();
+		for (auto i = Ulen(tokens_.offset(cursor_ - 2)); i-- > 0; /**/) {
+			if (input[i] == '\n') {
+				return true;
+			}
+			if (input[i] != ' ' && input[i] != '\t') {
+				return false;
+			}
+		}
+		return true;
+	};
+	for (Ulen i = begin; i < cursor_; i++) {
+		nest(i);
+	}
+	// Some statements are not parsed yet, those fail without an error.
+	if (errors_ == recovered_) {
+		error(tokens_.offset(begin), "Could not parse statement");
+	}
+	recovered_ = errors_;
+	// At least one token has to be skipped for the parser to get anywhere.
+	if (cursor_ == begin && !is_kind(TokenKind::ENDOF)) {
+		nest(cursor_);
+		eat();
+	}
+	while (!is_kind(TokenKind::ENDOF)) {
+		if (braces == 0) {
+			if (block && is_kind(TokenKind::RBRACE)) {
+				break;
+			}
+			if (parens == 0 && is_semi()) {
+				break;
+			}
+			if (!block && (is_keyword(KeywordKind::PACKAGE)
+			            || is_keyword(KeywordKind::IMPORT)
+			            || is_keyword(KeywordKind::FOREIGN)))
+			{
+				break;
+			}
+			if (!block && is_decl()) {
+				cursor_ -= 2;
+				token_ = tokens_[cursor_];
+				break;
+			}
+		}
+		nest(cursor_);
+		eat();
+	}
+	return ast_.create<AstBadStmt>(tokens_.offset(begin), token_.offset);
 }
 
 // EmptyStmt := ';'
@@ -334,9 +828,9 @@ AstRef<AstBlockStmt> Parser::parse_block_stmt() {
 		return {};
 	}
 	auto offset = eat(); // Eat '{'
-	Array<AstRef<AstStmt>> stmts{temporary_};
+	PendingList<AstStmt> stmts{*this};
 	while (!is_kind(TokenKind::RBRACE) && !is_kind(TokenKind::ENDOF)) {
-		auto stmt = parse_stmt(false, {}, {});
+		auto stmt = parse_stmt_or_recover(true);
 		if (!stmt || !stmts.push_back(stmt)) {
 			return {};
 		}
@@ -345,7 +839,7 @@ AstRef<AstBlockStmt> Parser::parse_block_stmt() {
 		return error("Expected '}'");
 	}
 	eat(); // Eat '}'
-	auto refs = ast_.insert(move(stmts));
+	auto refs = stmts.commit();
 	return ast_.create<AstBlockStmt>(offset, refs);
 }
 
@@ -383,6 +877,9 @@ AstRef<AstImportStmt> Parser::parse_import_stmt() {
 		return error("Expected ';' (or newline) after 'import' statement");
 	}
 	eat(); // Eat ';'
+	if (on_import_) {
+		on_import_(on_import_user_, ast_[ast_[expr].value]);
+	}
 	return ast_.create<AstImportStmt>(offset, alias, expr);
 }
 
@@ -451,7 +948,7 @@ AstRef<AstForeignImportStmt> Parser::parse_foreign_import_stmt() {
 			return {};
 		}
 	}
-	Array<AstRef<AstExpr>> exprs{temporary_};
+	PendingList<AstExpr> exprs{*this};
 	if (is_kind(TokenKind::LBRACE)) {
 		eat(); // Eat '{'
 		while (!is_kind(TokenKind::RBRACE) && !is_kind(TokenKind::ENDOF)) {
@@ -477,7 +974,7 @@ AstRef<AstForeignImportStmt> Parser::parse_foreign_import_stmt() {
 		}
 	}
 
-	auto refs = ast_.insert(move(exprs));
+	auto refs = exprs.commit();
 
 	return ast_.create<AstForeignImportStmt>(offset, ident, refs);
 }
@@ -499,7 +996,7 @@ AstRef<AstIfStmt> Parser::parse_if_stmt() {
 	AstRef<AstStmt> body;
 
 	if (!cond) {
-		if (auto node = ast_[init].to_stmt<AstExprStmt>()) {
+		if (auto node = init ? ast_[init].to_stmt<AstExprStmt>() : nullptr) {
 			cond = node->expr;
 			init = {};
 		} else {
@@ -519,6 +1016,9 @@ AstRef<AstIfStmt> Parser::parse_if_stmt() {
 			return error("Expected '{' or 'do' after 'if'");
 		}
 	}
+	if (!body) {
+		return {};
+	}
 
 	if (is_kind(TokenKind::IMPLICITSEMI)) {
 		eat();
@@ -536,6 +1036,9 @@ AstRef<AstIfStmt> Parser::parse_if_stmt() {
 		} else {
 			return error("Expected 'if', '{', or 'do' after 'else'");
 		}
+		if (!elze) {
+			return {};
+		}
 	}
 
 	return ast_.create<AstIfStmt>(offset, init, cond, body, elze);
@@ -547,12 +1050,12 @@ AstRef<AstBlockStmt> Parser::parse_do_stmt() {
 		return error("Expected 'do'");
 	}
 	auto offset = eat(); // Eat 'do'
-	Array<AstRef<AstStmt>> stmts{temporary_};
+	PendingList<AstStmt> stmts{*this};
 	auto stmt = parse_stmt(false, {}, {});
 	if (!stmt || !stmts.push_back(stmt)) {
 		return {};
 	}
-	auto refs = ast_.insert(move(stmts));
+	auto refs = stmts.commit();
 	return ast_.create<AstBlockStmt>(offset, refs);
 }
 
@@ -610,7 +1113,7 @@ AstRef<AstForStmt> Parser::parse_for_stmt() {
 	AstRef<AstStmt> in;
 	AstRef<AstStmt> post;
 	AstRef<AstExpr> cond;
-	Array<AstRef<AstStmt>> stmts{temporary_};
+	PendingList<AstStmt> stmts{*this};
 
 
 	if (is_operator(OperatorKind::LPAREN)) {
@@ -649,10 +1152,13 @@ AstRef<AstForStmt> Parser::parse_for_stmt() {
 	} else if (is_kind(TokenKind::LBRACE)) {
 		body = parse_block_stmt();
 	} else {
-		error("Expected either 'do' or '{'");
+		return error("Expected either 'do' or '{'");
+	}
+	if (!body) {
+		return {};
 	}
 
-	auto refs = ast_.insert(move(stmts));
+	auto refs = stmts.commit();
 	return ast_.create<AstForStmt>(offset,
 	                               in,
 	                               move(refs),
@@ -688,7 +1194,7 @@ AstRef<AstReturnStmt> Parser::parse_return_stmt() {
 		return error("Expected 'return'");
 	}
 	auto offset = eat(); // Eat 'return'
-	Array<AstRef<AstExpr>> exprs{temporary_};
+	PendingList<AstExpr> exprs{*this};
 	for (;;) {
 		auto expr = parse_expr(false);
 		if (!expr) {
@@ -707,7 +1213,7 @@ AstRef<AstReturnStmt> Parser::parse_return_stmt() {
 		return error("Expected ';' (or newline) after 'return' statement");
 	}
 	eat(); // Eat ';'
-	auto refs = ast_.insert(move(exprs));
+	auto refs = exprs.commit();
 	return ast_.create<AstReturnStmt>(offset, refs);
 }
 
@@ -818,36 +1324,6 @@ AstRef<AstImaginaryExpr> Parser::parse_imaginary_expr() {
 	return ast_.create<AstImaginaryExpr>(offset, value);
 }
 
-// CompoundExpr := '{' Field (',' Field)* '}'
-AstRef<AstCompoundExpr> Parser::parse_compound_expr() {
-	TRACE();
-	auto offset = eat(); // Eat '{'
-	if (is_kind(TokenKind::IMPLICITSEMI)) {
-		eat(); // Eat ';'
-	}
-	Array<AstRef<AstField>> fields{temporary_};
-	while (!is_kind(TokenKind::RBRACE) && !is_kind(TokenKind::ENDOF)) {
-		auto field = parse_field(true);
-		if (!field || !fields.push_back(field)) {
-			return {};
-		}
-		if (is_kind(TokenKind::COMMA)) {
-			eat(); // Eat ','
-		} else {
-			break;
-		}
-	}
-	if (is_kind(TokenKind::IMPLICITSEMI)) {
-		eat();
-	}
-	if (!is_kind(TokenKind::RBRACE)) {
-		return error("Expected ',' or '}'");
-	}
-	eat(); // Eat '}'
-	auto refs = ast_.insert(move(fields));
-	return ast_.create<AstCompoundExpr>(offset, refs);
-}
-
 // IdentExpr := Ident
 AstRef<AstIdentExpr> Parser::parse_ident_expr() {
 	TRACE();
@@ -878,71 +1354,6 @@ AstRef<AstContextExpr> Parser::parse_context_expr() {
 	return ast_.create<AstContextExpr>(offset);
 }
 
-// IfExpr := Expr 'if' Expr 'else' Expr
-//         | Expr '?' Expr ':' Expr
-AstRef<AstIfExpr> Parser::parse_if_expr(AstRef<AstExpr> expr) {
-	TRACE();
-	AstRef<AstExpr> cond;
-	AstRef<AstExpr> on_true;
-	AstRef<AstExpr> on_false;
-	if (is_keyword(KeywordKind::IF)) {
-		on_true = expr;
-		eat(); // Eat 'if'
-		cond = parse_expr(false);
-		if (!cond) {
-			return {};
-		}
-		if (!is_keyword(KeywordKind::ELSE)) {
-			return error("Expected 'else' in 'if' expression");
-		}
-		eat(); // Eat 'else'
-		on_false = parse_expr(false);
-		if (!on_false) {
-			return {};
-		}
-	} else if (is_operator(OperatorKind::QUESTION)) {
-		cond = expr;
-		eat(); // Eat '?'
-		on_true = parse_expr(false);
-		if (!on_true) {
-			return {};
-		}
-		if (!is_operator(OperatorKind::COLON)) {
-			return error("Expected ':' after ternary condition");
-		}
-		eat(); // Eat ':'
-		auto on_false = parse_expr(false);
-		if (!on_false) {
-			return {};
-		}
-	} else {
-		return error("Expected 'if' or '?'");
-	}
-	return ast_.create<AstIfExpr>(ast_[expr].offset, cond, on_true, on_false);
-}
-
-// WhenExpr := Expr 'when' Expr 'else' Expr
-AstRef<AstWhenExpr> Parser::parse_when_expr(AstRef<AstExpr> on_true) {
-	TRACE();
-	if (!is_keyword(KeywordKind::WHEN)) {
-		return error("Expected 'when'");
-	}
-	eat(); // Eat 'when'
-	auto cond = parse_expr(false);
-	if (!cond) {
-		return {};
-	}
-	if (!is_keyword(KeywordKind::ELSE)) {
-		return error("Expected 'else' in 'when' expression");
-	}
-	eat(); // Eat 'else'
-	auto on_false = parse_expr(false);
-	if (!on_false) {
-		return {};
-	}
-	return ast_.create<AstWhenExpr>(ast_[on_true].offset, cond, on_true, on_false);
-}
-
 AstRef<AstExpr> Parser::parse_expr(Bool lhs) {
 	TRACE();
 	auto expr = parse_bin_expr(lhs, 1);
@@ -954,53 +1365,610 @@ AstRef<AstExpr> Parser::parse_expr(Bool lhs) {
 
 AstRef<AstExpr> Parser::parse_value(Bool lhs) {
 	TRACE();
-	if (is_kind(TokenKind::LBRACE)) {
-		return parse_compound_expr();
-	}
-	return parse_expr(lhs);
+	return parse_bin_expr(lhs, 1, true);
 }
 
-AstRef<AstExpr> Parser::parse_bin_expr(Bool lhs, Uint32 prec) {
+static constexpr const Uint32 PREC[] = {
+	#define OPERATOR(ENUM, NAME, MATCH, PREC, NAMED, ASI) PREC,
+	#include "lexer.inl"
+};
+
+// BinExpr  := Expr Op Expr
+// IfExpr   := Expr 'if' Expr 'else' Expr
+//           | Expr '?' Expr ':' Expr
+// WhenExpr := Expr 'when' Expr 'else' Expr
+// CallExpr := Expr '(' (Field (',' Field)* ','?)? ')'
+// CompoundExpr := '{' (Field (',' Field)* ','?)? '}'
+// Field    := Value ('=' Value)?
+// Value    := CompoundExpr | Expr
+//
+// Precedence climbing on an explicit stack of operators and operands instead of
+// one call per precedence level, operand and prefix operator. Whatever has an
+// expression nested in it is a marker on the same stack so nesting does not
+// recurse either: a parenthesized expression, the arguments of a call, the
+// fields of a compound literal, the expressions of an index or a slice, and the
+// branches of the 'if', 'when' and '?' ternaries. Binary operators are left-associative, an operator makes the
+// pending ones with the same or a higher precedence into AstBinExpr before it's
+// pushed. The ternaries bind the loosest of all.
+//
+// An expression ends at the first token which does not carry on from what came
+// before it, that token then says what to do with the marker on top: a ')'
+// closes a call, an 'else' moves on to the false branch of a ternary and so on.
+//
+// A compound literal which is a Value, rather than an operand of an expression,
+// is the whole of it: a field, an argument or, when [value] is true, what's
+// parsed. Nothing can come after one.
+//
+// The stacks belong to the parser and are shared with the expressions parsed
+// inside of this one, e.g the types of a cast, which go on top. The arguments
+// of the calls and the fields of the compound literals being parsed are on the
+// stack of pending IDs, each from the mark in its marker.
+AstRef<AstExpr> Parser::parse_bin_expr(Bool lhs, Uint32 prec, Bool value) {
 	TRACE();
-	static constexpr const Uint32 PREC[] = {
-		#define OPERATOR(ENUM, NAME, MATCH, PREC, NAMED, ASI) PREC,
-		#include "lexer.inl"
+	struct Frame {
+		Frame(Parser& parser)
+			: parser{parser}
+			, ops{parser.ops_.length()}
+			, operands{parser.operands_.length()}
+			, pending{parser.pending_.length()}
+		{
+		}
+		~Frame() {
+			// Cannot fail, these only shrink.
+			(void)parser.ops_.resize(ops);
+			(void)parser.operands_.resize(operands);
+			(void)parser.pending_.resize(pending);
+		}
+		Parser& parser;
+		Ulen    ops;
+		Ulen    operands;
+		Ulen    pending;
+	} frame{*this};
+
+	using Kind = PendingOp::Kind;
+	auto top = [&]() -> PendingOp* {
+		return ops_.length() > frame.ops ? &ops_[ops_.length() - 1] : nullptr;
 	};
-	auto expr = parse_unary_expr(lhs);
-	if (!expr) {
+	auto pop_operand = [&]() {
+		auto operand = operands_[operands_.length() - 1];
+		operands_.pop_back();
+		return operand;
+	};
+	// The marker the expression being parsed is nested in, only binary operators
+	// are ever on top of it once there is an operand.
+	auto marker = [&]() -> PendingOp* {
+		for (Ulen i = ops_.length(); i-- > frame.ops; /**/) {
+			if (ops_[i].kind != Kind::BINARY) {
+				return &ops_[i];
+			}
+		}
+		return nullptr;
+	};
+	// Make the binary operators on top into nodes while they bind at least as
+	// tight as [min].
+	auto reduce = [&](Uint32 min) -> Bool {
+		while (auto op = top()) {
+			if (op->kind != Kind::BINARY || PREC[Uint32(op->op)] < min) {
+				break;
+			}
+			const auto kind = op->op;
+			ops_.pop_back();
+			auto rhs = pop_operand();
+			auto lhs = pop_operand();
+			auto expr = ast_.create<AstBinExpr>(ast_[lhs].offset, lhs, rhs, kind);
+			if (!expr || !operands_.push_back(expr)) {
+				return false;
+			}
+		}
+		return true;
+	};
+	// Apply the prefix operators on top to [operand] and push the result.
+	auto push_operand = [&](AstRef<AstExpr> operand) -> Bool {
+		while (operand) {
+			auto op = top();
+			if (!op || (op->kind != Kind::UNARY && op->kind != Kind::CAST)) {
+				break;
+			}
+			if (op->kind == Kind::CAST) {
+				operand = ast_.create<AstCastExpr>(op->offset, op->type, operand);
+			} else {
+				operand = ast_.create<AstUnaryExpr>(op->offset, operand, op->op);
+			}
+			ops_.pop_back();
+		}
+		return operand && operands_.push_back(operand);
+	};
+	auto expected_rhs = [&]() -> Unit {
+		if (auto op = top(); op && op->kind == Kind::BINARY) {
+			error("Expected expression on right-hand side of binary operator");
+		}
 		return {};
-	}
+	};
+
+	// What to parse next: an operand, what may come after one, or the end of the
+	// expression nested in the marker on top.
+	enum class Next { OPERAND, AFTER, END };
+	auto next = Next::OPERAND;
+
+	// The postfix operators after [operand]. A call or an index pushes a marker
+	// and the operand is pushed once it's closed, an 'or_return', 'or_break' or
+	// 'or_continue' ends it.
+	auto postfix = [&](AstRef<AstExpr> operand, Bool is_lhs) -> Bool {
+		for (;;) {
+			// Each of the below can fail.
+			if (!operand) {
+				return false;
+			}
+			if (is_operator(OperatorKind::LPAREN)) {
+				eat(); // Eat '('
+				if (is_operator(OperatorKind::RPAREN)) {
+					eat(); // Eat ')'
+					operand = ast_.create<AstCallExpr>(ast_[operand].offset, operand, AstRefArray<AstField>{});
+					is_lhs = false;
+					continue;
+				}
+				const PendingOp call {
+					.kind    = Kind::CALL,
+					.op      = OperatorKind::LPAREN,
+					.lhs     = false,
+					.offset  = ast_[operand].offset,
+					.operand = operand,
+					.mark    = pending_.length(),
+				};
+				if (!ops_.push_back(call)) {
+					return false;
+				}
+				next = Next::OPERAND;
+				lhs = false;
+				return true;
+			} else if (is_operator(OperatorKind::PERIOD)) {
+				eat(); // Eat '.'
+				if (is_kind(TokenKind::IDENTIFIER)) {
+					auto name = parse_ident();
+					if (!name) {
+						return false;
+					}
+					operand = ast_.create<AstAccessExpr>(ast_[operand].offset, operand, name, false);
+				} else if (is_operator(OperatorKind::LPAREN)) {
+					eat(); // Eat '('
+					auto type = parse_type();
+					if (!type) {
+						return false;
+					}
+					if (!is_operator(OperatorKind::RPAREN)) {
+						error("Expected ')'");
+						return false;
+					}
+					eat(); // Eat ')'
+					operand = ast_.create<AstAssertExpr>(ast_[operand].offset, operand, type);
+				} else if (is_operator(OperatorKind::QUESTION)) {
+					eat(); // Eat '?'
+					operand = ast_.create<AstAssertExpr>(ast_[operand].offset, operand, AstRef<AstType>{});
+				} else {
+					error("Unexpected token after '.'");
+					return false;
+				}
+			} else if (is_operator(OperatorKind::ARROW)) {
+				eat(); // Eat '->'
+				auto ident = parse_ident();
+				if (!ident) {
+					return false;
+				}
+				operand = ast_.create<AstAccessExpr>(ast_[operand].offset, operand, ident, true);
+			} else if (is_operator(OperatorKind::LBRACKET)) {
+				eat(); // Eat '['
+				if (is_operator(OperatorKind::RBRACKET)) {
+					error("Expected expression in '[]'");
+					return false;
+				}
+				const PendingOp index {
+					.kind    = Kind::INDEX,
+					.op      = OperatorKind::LBRACKET,
+					.lhs     = is_lhs,
+					.offset  = ast_[operand].offset,
+					.operand = operand,
+				};
+				if (!ops_.push_back(index)) {
+					return false;
+				}
+				// Either side of a slice can be left out.
+				if (is_operator(OperatorKind::COLON) || is_kind(TokenKind::COMMA)) {
+					next = Next::END;
+					return operands_.push_back({});
+				}
+				next = Next::OPERAND;
+				lhs = is_lhs;
+				return true;
+			} else if (is_operator(OperatorKind::POINTER)) {
+				operand = parse_deref_expr(operand);
+			} else if (is_operator(OperatorKind::OR_RETURN)) {
+				operand = parse_or_return_expr(operand);
+				break;
+			} else if (is_operator(OperatorKind::OR_BREAK)) {
+				operand = parse_or_break_expr(operand);
+				break;
+			} else if (is_operator(OperatorKind::OR_CONTINUE)) {
+				operand = parse_or_continue_expr(operand);
+				break;
+			} else {
+				break;
+			}
+			is_lhs = false;
+		}
+		next = Next::AFTER;
+		return push_operand(operand);
+	};
+
+	// The next argument of the call on top, or its value after a '='.
+	auto argument = [&]() -> Bool {
+		if (is_kind(TokenKind::ENDOF)) {
+			error("Expected ')'");
+			return false;
+		}
+		next = Next::OPERAND;
+		lhs = false;
+		value = true;
+		return true;
+	};
+
+	// The next field of the compound literal on top, or its value after a '='.
+	// The literal is closed when there are no more.
+	auto field = [&](PendingOp& op) {
+		if (is_kind(TokenKind::RBRACE) || is_kind(TokenKind::ENDOF)) {
+			op.phase = 2;
+			next = Next::END;
+			return;
+		}
+		next = Next::OPERAND;
+		lhs = false;
+		value = true;
+	};
+
 	for (;;) {
-		if (!is_kind(TokenKind::OPERATOR)) {
-			// Could be if or when ternary expressions
-			if (is_keyword(KeywordKind::IF)) {
-				expr = parse_if_expr(expr);
-			} else if (is_keyword(KeywordKind::WHEN)) {
-				expr = parse_when_expr(expr);
+		if (next == Next::OPERAND) {
+			// Operand, with any prefix operators before it.
+			const auto mark = ops_.length();
+			for (;;) {
+				if (is_operator(OperatorKind::TRANSMUTE) || is_operator(OperatorKind::CAST)) {
+					auto offset = eat(); // Eat 'transmute' or 'cast'
+					if (!is_operator(OperatorKind::LPAREN)) {
+						return error("Expected '(' after cast");
+					}
+					eat(); // Eat '('
+					auto type = parse_type();
+					if (!type) {
+						return {};
+					}
+					if (!is_operator(OperatorKind::RPAREN)) {
+						return error("Expected ')' after cast");
+					}
+					eat(); // Eat ')'
+					if (!ops_.push_back({ Kind::CAST, OperatorKind::CAST, lhs, offset, type })) {
+						return {};
+					}
+				} else if (is_operator(OperatorKind::AUTO_CAST)) {
+					auto offset = eat(); // Eat 'auto_cast'
+					if (!ops_.push_back({ Kind::CAST, OperatorKind::AUTO_CAST, lhs, offset, {} })) {
+						return {};
+					}
+				} else if (is_operator(OperatorKind::ADD)  ||
+				           is_operator(OperatorKind::SUB)  ||
+				           is_operator(OperatorKind::XOR)  ||
+				           is_operator(OperatorKind::BAND) ||
+				           is_operator(OperatorKind::LNOT) ||
+				           is_operator(OperatorKind::MUL))
+				{
+					const auto op = token_.as_operator;
+					auto offset = eat(); // Eat op
+					if (!ops_.push_back({ Kind::UNARY, op, lhs, offset, {} })) {
+						return {};
+					}
+				} else if (is_operator(OperatorKind::LPAREN)) {
+					auto offset = eat(); // Eat '('
+					if (!ops_.push_back({ Kind::PAREN, OperatorKind::LPAREN, lhs, offset, {} })) {
+						return {};
+					}
+					lhs = false;
+				} else {
+					break;
+				}
 			}
-			break;
+			// Only a '{' before which there were no prefix operators is a value.
+			const auto whole = value && ops_.length() == mark;
+			value = false;
+			if (is_kind(TokenKind::LBRACE) && (!lhs || whole)) {
+				const PendingOp compound {
+					.kind   = Kind::COMPOUND,
+					.op     = OperatorKind::LPAREN,
+					.lhs    = false,
+					.offset = eat(), // Eat '{'
+					.mark   = pending_.length(),
+					.value  = whole,
+				};
+				if (is_kind(TokenKind::IMPLICITSEMI)) {
+					eat(); // Eat ';'
+				}
+				if (!ops_.push_back(compound)) {
+					return {};
+				}
+				field(ops_.last());
+				continue;
+			}
+			if (is_operator(OperatorKind::PERIOD)) {
+				auto offset = eat(); // Eat '.'
+				auto ident = parse_ident();
+				if (!ident) {
+					return error("Expected identifier after '.'");
+				}
+				if (!push_operand(ast_.create<AstSelectorExpr>(offset, ident))) {
+					return {};
+				}
+				next = Next::AFTER;
+			} else {
+				auto operand = parse_operand();
+				if (!operand) {
+					expected_rhs();
+					if (auto op = marker(); op && op->kind == Kind::COMPOUND && op->phase == 1) {
+						return error("Could not parse expression");
+					}
+					return {};
+				}
+				if (!postfix(operand, lhs)) {
+					return {};
+				}
+			}
+			if (next != Next::OPERAND) {
+				lhs = false;
+			}
+			continue;
 		}
-		if (is_operator(OperatorKind::IN) && !allow_in_expr_) {
-			return expr;
+
+		if (next == Next::AFTER) {
+			if (is_keyword(KeywordKind::IF) || is_keyword(KeywordKind::WHEN) || is_operator(OperatorKind::QUESTION)) {
+				if (!reduce(0)) {
+					return {};
+				}
+				auto operand = pop_operand();
+				const auto kind = is_keyword(KeywordKind::IF)   ? Kind::IF
+				                : is_keyword(KeywordKind::WHEN) ? Kind::WHEN
+				                :                                 Kind::TERNARY;
+				const PendingOp ternary {
+					.kind    = kind,
+					.op      = OperatorKind::QUESTION,
+					.lhs     = false,
+					.offset  = ast_[operand].offset,
+					.operand = operand,
+				};
+				eat(); // Eat 'if', 'when' or '?'
+				if (!ops_.push_back(ternary)) {
+					return {};
+				}
+				next = Next::OPERAND;
+				continue;
+			}
+			if (auto op = marker(); op && op->kind == Kind::PAREN && is_operator(OperatorKind::RPAREN)) {
+				if (!reduce(0)) {
+					return {};
+				}
+				auto inner = pop_operand();
+				const auto paren_lhs = top()->lhs;
+				ops_.pop_back();
+				eat(); // Eat ')'
+				if (!postfix(inner, paren_lhs)) {
+					return {};
+				}
+				continue;
+			}
+			const auto binary = is_kind(TokenKind::OPERATOR)
+			                 && !(is_operator(OperatorKind::IN) && !allow_in_expr_)
+			                 && PREC[Uint32(token_.as_operator)] >= prec;
+			if (binary) {
+				const auto op = token_.as_operator;
+				if (!reduce(PREC[Uint32(op)])) {
+					return {};
+				}
+				eat(); // Eat operator
+				if (!ops_.push_back({ Kind::BINARY, op, false, 0, {} })) {
+					return {};
+				}
+				next = Next::OPERAND;
+				continue;
+			}
+			next = Next::END;
+		}
+
+		// The end of the expression in the marker on top, or of all of it.
+		if (!reduce(0)) {
+			return {};
 		}
-		if (PREC[Uint32(token_.as_operator)] < prec) {
-			// Stop climbing, found the correct precedence.
+		auto op = top();
+		if (!op) {
 			break;
 		}
-		if (is_operator(OperatorKind::QUESTION)) {
-			expr = parse_if_expr(expr);
-		} else {
-			auto kind = token_.as_operator;
-			eat(); // Eat operator
-			auto rhs = parse_bin_expr(false, prec+1);
-			if (!rhs) {
-				return error("Expected expression on right-hand side of binary operator");
+		switch (op->kind) {
+		case Kind::PAREN:
+			return error("Expected ')'");
+		case Kind::IF:
+		case Kind::WHEN:
+		case Kind::TERNARY:
+			if (op->phase == 0) {
+				if (op->kind == Kind::TERNARY && !is_operator(OperatorKind::COLON)) {
+					return error("Expected ':' after ternary condition");
+				} else if (op->kind == Kind::IF && !is_keyword(KeywordKind::ELSE)) {
+					return error("Expected 'else' in 'if' expression");
+				} else if (op->kind == Kind::WHEN && !is_keyword(KeywordKind::ELSE)) {
+					return error("Expected 'else' in 'when' expression");
+				}
+				eat(); // Eat 'else' or ':'
+				op->first = pop_operand();
+				op->phase = 1;
+				next = Next::OPERAND;
+				lhs = false;
+			} else {
+				const auto ternary = *op;
+				auto on_false = pop_operand();
+				ops_.pop_back();
+				AstRef<AstExpr> expr;
+				if (ternary.kind == Kind::IF) {
+					expr = ast_.create<AstIfExpr>(ternary.offset, ternary.first, ternary.operand, on_false);
+				} else if (ternary.kind == Kind::WHEN) {
+					expr = ast_.create<AstWhenExpr>(ternary.offset, ternary.first, ternary.operand, on_false);
+				} else {
+					expr = ast_.create<AstIfExpr>(ternary.offset, ternary.operand, ternary.first, on_false);
+				}
+				if (!expr || !operands_.push_back(expr)) {
+					return {};
+				}
+				next = Next::AFTER;
+			}
+			break;
+		case Kind::CALL:
+			{
+				auto value = pop_operand();
+				if (is_assignment(AssignKind::EQ) && !op->first) {
+					eat(); // Eat '='
+					op->first = value;
+					if (!argument()) {
+						return {};
+					}
+					break;
+				}
+				if (!is_kind(TokenKind::COMMA) && !is_operator(OperatorKind::RPAREN)) {
+					return error("Expected ')'");
+				}
+				auto name = op->first;
+				op->first = {};
+				if (name && !ast_[name].is_expr<AstIdentExpr>()) {
+					return error(ast_[name].offset, "Expected identifier when assigning parameter by name");
+				}
+				auto field = name
+					? ast_.create<AstField>(ast_[name].offset, name, value)
+					: ast_.create<AstField>(ast_[value].offset, value, AstRef<AstExpr>{});
+				if (!field || !pending_.push_back(field)) {
+					return {};
+				}
+				if (is_kind(TokenKind::COMMA)) {
+					eat(); // Eat ','
+					if (!is_operator(OperatorKind::RPAREN)) {
+						if (!argument()) {
+							return {};
+						}
+						break;
+					}
+				}
+				eat(); // Eat ')'
+				const auto call = *op;
+				ops_.pop_back();
+				const auto& pending = pending_;
+				auto args = ast_.insert<AstField>(pending.slice().slice(call.mark));
+				// Cannot fail, this only shrinks.
+				(void)pending_.resize(call.mark);
+				auto expr = ast_.create<AstCallExpr>(call.offset, call.operand, args);
+				if (!postfix(expr, false)) {
+					return {};
+				}
+			}
+			break;
+		case Kind::INDEX:
+			{
+				auto value = pop_operand();
+				if (op->phase == 0 && (is_operator(OperatorKind::COLON) || is_kind(TokenKind::COMMA))) {
+					op->phase = is_kind(TokenKind::COMMA) ? 2 : 1;
+					op->first = value;
+					eat(); // Eat ':' or ','
+					if (is_operator(OperatorKind::RBRACKET)) {
+						if (!operands_.push_back({})) {
+							return {};
+						}
+					} else {
+						next = Next::OPERAND;
+						lhs = false;
+					}
+					break;
+				}
+				if (!is_operator(OperatorKind::RBRACKET)) {
+					return error("Expected ']'");
+				}
+				eat(); // Eat ']'
+				const auto index = *op;
+				ops_.pop_back();
+				const auto is_slice = index.phase == 1;
+				auto lhs = index.phase == 0 ? value : index.first;
+				auto rhs = index.phase == 0 ? AstRef<AstExpr>{} : value;
+				if (!is_slice && !lhs) {
+					return error("Expected expression in '[]'");
+				}
+				auto expr = is_slice
+					? AstRef<AstExpr>{ast_.create<AstSliceExpr>(index.offset, index.operand, lhs, rhs)}
+					: AstRef<AstExpr>{ast_.create<AstIndexExpr>(index.offset, index.operand, lhs, rhs)};
+				if (!postfix(expr, false)) {
+					return {};
+				}
 			}
-			expr = ast_.create<AstBinExpr>(ast_[expr].offset, expr, rhs, kind);
+			break;
+		case Kind::COMPOUND:
+			if (op->phase != 2) {
+				auto operand = pop_operand();
+				if (op->phase == 0 && is_assignment(AssignKind::EQ)) {
+					eat(); // Eat '='
+					op->first = operand;
+					op->phase = 1;
+					next = Next::OPERAND;
+					lhs = false;
+					value = true;
+					break;
+				}
+				auto name = op->first;
+				op->first = {};
+				op->phase = 0;
+				auto field_ref = name
+					? ast_.create<AstField>(ast_[name].offset, name, operand)
+					: ast_.create<AstField>(ast_[operand].offset, operand, AstRef<AstExpr>{});
+				if (!field_ref || !pending_.push_back(field_ref)) {
+					return {};
+				}
+				if (is_kind(TokenKind::COMMA)) {
+					eat(); // Eat ','
+					field(*op);
+					if (next == Next::OPERAND) {
+						break;
+					}
+				}
+			}
+			{
+				if (is_kind(TokenKind::IMPLICITSEMI)) {
+					eat(); // Eat ';'
+				}
+				if (!is_kind(TokenKind::RBRACE)) {
+					return error("Expected ',' or '}'");
+				}
+				eat(); // Eat '}'
+				const auto compound = *top();
+				ops_.pop_back();
+				const auto& pending = pending_;
+				auto fields = ast_.insert<AstField>(pending.slice().slice(compound.mark));
+				// Cannot fail, this only shrinks.
+				(void)pending_.resize(compound.mark);
+				auto expr = ast_.create<AstCompoundExpr>(compound.offset, fields);
+				if (compound.value) {
+					if (!expr || !operands_.push_back(expr)) {
+						return {};
+					}
+					next = Next::END;
+				} else if (!postfix(expr, false)) {
+					return {};
+				}
+			}
+			break;
+		case Kind::UNARY:
+		case Kind::CAST:
+		case Kind::BINARY:
+			// Applied or reduced by now.
+			break;
 		}
-		lhs = false;
 	}
-	return expr;
+
+	return pop_operand();
 }
 
 // DerefExpr := Expr '^'
@@ -1039,169 +2007,7 @@ AstRef<AstOrContinueExpr> Parser::parse_or_continue_expr(AstRef<AstExpr> operand
 	return ast_.create<AstOrContinueExpr>(ast_[operand].offset, operand);
 }
 
-// CallExpr := Expr '(' (',' Field)* ')'
-AstRef<AstCallExpr> Parser::parse_call_expr(AstRef<AstExpr> operand) {
-	TRACE();
-	if (!is_operator(OperatorKind::LPAREN)) {
-		return error("Expected '('");
-	}
-	eat(); // Eat '('
-	Array<AstRef<AstField>> args{temporary_};
-	while (!is_operator(OperatorKind::RPAREN) && !is_kind(TokenKind::ENDOF)) {
-		auto field = parse_field(true);
-		if (!field) {
-			return {};
-		}
-		const auto& node = ast_[field];
-		if (node.expr && !ast_[node.operand].is_expr<AstIdentExpr>()) {
-			return error(ast_[node.operand].offset, "Expected identifier when assigning parameter by name");
-		}
-		if (!args.push_back(field)) {
-			return {};
-		}
-		if (is_kind(TokenKind::COMMA)) {
-			eat(); // Eat ','
-		} else {
-			break;
-		}
-	}
-	if (!is_operator(OperatorKind::RPAREN)) {
-		return error("Expected ')'");
-	}
-	eat(); // Eat ')'
-	auto refs = ast_.insert(move(args));
-	return ast_.create<AstCallExpr>(ast_[operand].offset, operand, refs);
-}
-
-AstRef<AstExpr> Parser::parse_unary_atom(AstRef<AstExpr> operand, Bool is_lhs) {
-	TRACE();
-	if (!operand) {
-		return {};
-	}
-	for (;;) {
-		if (is_operator(OperatorKind::LPAREN)) {
-			operand = parse_call_expr(operand);
-		} else if (is_operator(OperatorKind::PERIOD)) {
-			eat(); // Eat '.'
-			if (is_kind(TokenKind::IDENTIFIER)) {
-				auto name = parse_ident();
-				if (!name) {
-					return {};
-				}
-				operand = ast_.create<AstAccessExpr>(ast_[operand].offset, operand, name, false);
-			} else if (is_operator(OperatorKind::LPAREN)) {
-				eat(); // Eat '('
-				auto type = parse_type();
-				if (!type) {
-					return {};
-				}
-				if (!is_operator(OperatorKind::RPAREN)) {
-					return error("Expected ')'");
-				}
-				eat(); // Eat ')'
-				operand = ast_.create<AstAssertExpr>(ast_[operand].offset, operand, type);
-			} else if (is_operator(OperatorKind::QUESTION)) {
-				eat(); // Eat '?'
-				operand = ast_.create<AstAssertExpr>(ast_[operand].offset, operand, AstRef<AstType>{});
-			} else {
-				return error("Unexpected token after '.'");
-			}
-		} else if (is_operator(OperatorKind::ARROW)) {
-			eat(); // Eat '->'
-			auto ident = parse_ident();
-			if (!ident) {
-				return {};
-			}
-			operand = ast_.create<AstAccessExpr>(ast_[operand].offset, operand, ident, true);
-		} else if (is_operator(OperatorKind::LBRACKET)) {
-			eat(); // Eat '['
-			if (is_operator(OperatorKind::RBRACKET)) {
-				return error("Expected expression in '[]'");
-			}
-			// We don't know if we need the expression yet
-			AstRef<AstExpr> lhs = parse_expr(is_lhs);
-			AstRef<AstExpr> rhs;
-			Bool is_slice = is_operator(OperatorKind::COLON);
-			if (is_slice || is_kind(TokenKind::COMMA)) {
-				eat(); // Eat ':' or ','
-				rhs = parse_expr(false);
-			}
-			if (!is_operator(OperatorKind::RBRACKET)) {
-				return error("Expected ']'");
-			}
-			eat(); // Eat ']'
-			if (is_slice) {
-				operand = ast_.create<AstSliceExpr>(ast_[operand].offset, operand, lhs, rhs);
-			} else {
-				operand = ast_.create<AstIndexExpr>(ast_[operand].offset, operand, lhs, rhs);
-			}
-		} else if (is_operator(OperatorKind::POINTER)) {
-			operand = parse_deref_expr(operand);
-		} else if (is_operator(OperatorKind::OR_RETURN)) {
-			return parse_or_return_expr(operand);
-		} else if (is_operator(OperatorKind::OR_BREAK)) {
-			return parse_or_break_expr(operand);
-		} else if (is_operator(OperatorKind::OR_CONTINUE)) {
-			return parse_or_continue_expr(operand);
-		} else {
-			break;
-		}
-		is_lhs = false;
-	}
-	return operand;
-}
-
-AstRef<AstExpr> Parser::parse_unary_expr(Bool lhs) {
-	TRACE();
-	if (is_operator(OperatorKind::TRANSMUTE) ||
-	    is_operator(OperatorKind::CAST))
-	{
-		auto offset = eat(); // Eat 'transmute' or 'cast'
-		if (!is_operator(OperatorKind::LPAREN)) {
-			return error("Expected '(' after cast");
-		}
-		eat(); // Eat '('
-		auto type = parse_type();
-		if (!type) {
-			return {};
-		}
-		if (!is_operator(OperatorKind::RPAREN)) {
-			return error("Expected ')' after cast");
-		}
-		eat(); // Eat ')'
-		if (auto expr = parse_unary_expr(lhs)) {
-			return ast_.create<AstCastExpr>(offset, type, expr);
-		}
-	} else if (is_operator(OperatorKind::AUTO_CAST)) {
-		auto offset = eat(); // Eat 'auto_cast'
-		if (auto expr = parse_unary_expr(lhs)) {
-			return ast_.create<AstCastExpr>(offset, AstRef<AstType>{}, expr);
-		}
-	} else if (is_operator(OperatorKind::ADD)  ||
-	           is_operator(OperatorKind::SUB)  ||
-	           is_operator(OperatorKind::XOR)  ||
-	           is_operator(OperatorKind::BAND) ||
-	           is_operator(OperatorKind::LNOT) ||
-	           is_operator(OperatorKind::MUL))
-	{
-		const auto op = token_.as_operator;
-		auto offset = eat(); // Eat op
-		if (auto expr = parse_unary_expr(lhs)) {
-			return ast_.create<AstUnaryExpr>(offset, expr, op);
-		}
-	} else if (is_operator(OperatorKind::PERIOD)) {
-		auto offset = eat(); // Eat '.'
-		if (auto ident = parse_ident()) {
-			return ast_.create<AstSelectorExpr>(offset, ident);
-		} else {
-			return error("Expected identifier after '.'");
-		}
-	}
-	auto operand = parse_operand(lhs);
-	return parse_unary_atom(operand, lhs);
-}
-
-AstRef<AstExpr> Parser::parse_operand(Bool is_lhs) {
+AstRef<AstExpr> Parser::parse_operand() {
 	TRACE();
 	if (is_literal(LiteralKind::INTEGER)) {
 		return parse_int_expr();
@@ -1221,10 +2027,6 @@ AstRef<AstExpr> Parser::parse_operand(Bool is_lhs) {
 		return parse_proc_expr();
 	} else if (is_operator(OperatorKind::LPAREN)) {
 		return parse_paren_expr();
-	} else if (is_kind(TokenKind::LBRACE)) {
-		if (!is_lhs) {
-			return parse_compound_expr();
-		}
 	}
 	auto type = parse_type();
 	if (!type) {
@@ -1288,7 +2090,7 @@ AstRef<AstType> Parser::parse_type() {
 		}
 		if (is_operator(OperatorKind::LPAREN)) {
 			eat(); // Eat '('
-			Array<AstRef<AstExpr>> exprs{temporary_};
+			PendingList<AstExpr> exprs{*this};
 			while (!is_operator(OperatorKind::RPAREN) && !is_kind(TokenKind::ENDOF)) {
 				auto expr = parse_expr(false);
 				if (!expr || !exprs.push_back(expr)) {
@@ -1304,7 +2106,7 @@ AstRef<AstType> Parser::parse_type() {
 				return error("Expected ')'");
 			}
 			eat(); // Eat ')'
-			auto refs = ast_.insert(move(exprs));
+			auto refs = exprs.commit();
 			return ast_.create<AstParamType>(ast_[named].offset, named, refs);
 		} else {
 			return named;
@@ -1337,7 +2139,7 @@ AstRef<AstUnionType> Parser::parse_union_type() {
 	if (!is_kind(TokenKind::LBRACE)) {
 		return error("Expected '{'");
 	}
-	Array<AstRef<AstType>> types{temporary_};
+	PendingList<AstType> types{*this};
 	eat(); // Eat '}'
 	while (!is_kind(TokenKind::RBRACE) && !is_kind(TokenKind::ENDOF)) {
 		auto type = parse_type();
@@ -1360,7 +2162,7 @@ AstRef<AstUnionType> Parser::parse_union_type() {
 		return error("Expected '}'");
 	}
 	eat(); // '}'
-	auto refs = ast_.insert(move(types));
+	auto refs = types.commit();
 	return ast_.create<AstUnionType>(offset, refs);
 }
 
@@ -1374,7 +2176,7 @@ AstRef<AstStructType> Parser::parse_struct_type() {
 	if (!is_kind(TokenKind::LBRACE)) {
 		return error("Expected '{'");
 	}
-	Array<AstRef<AstStmt>> decls{temporary_};
+	PendingList<AstStmt> decls{*this};
 	eat(); // Eat '}'
 	while (!is_kind(TokenKind::RBRACE) && !is_kind(TokenKind::ENDOF)) {
 		auto decl = parse_stmt(false, {}, {});
@@ -1403,7 +2205,7 @@ AstRef<AstStructType> Parser::parse_struct_type() {
 		return error("Expected '}' to terminate struct");
 	}
 	eat(); // '}'
-	auto refs = ast_.insert(move(decls));
+	auto refs = decls.commit();
 	return ast_.create<AstStructType>(offset, refs);
 }
 
@@ -1424,7 +2226,7 @@ AstRef<AstEnumType> Parser::parse_enum_type() {
 		return error("Expected '{'");
 	}
 	eat(); // Eat '{'
-	Array<AstRef<AstField>> enums{temporary_};
+	PendingList<AstField> enums{*this};
 	while (!is_kind(TokenKind::RBRACE) && !is_kind(TokenKind::ENDOF)) {
 		auto field = parse_field(true);
 		if (!field) {
@@ -1449,7 +2251,7 @@ AstRef<AstEnumType> Parser::parse_enum_type() {
 		return error("Expected '}' to terminate enum");
 	}
 	eat(); // Eat '}'
-	auto refs = ast_.insert(move(enums));
+	auto refs = enums.commit();
 	return ast_.create<AstEnumType>(offset, base, refs);
 }
 
@@ -1488,7 +2290,7 @@ AstRef<AstProcType> Parser::parse_proc_type() {
 	}
 	eat(); // Eat '('
 
-	Array<AstRef<AstStmt>> decls{temporary_};
+	PendingList<AstStmt> decls{*this};
 	while (!is_operator(OperatorKind::RPAREN) && !is_kind(TokenKind::ENDOF)) {
 		auto decl = parse_stmt(false, {}, {});
 		if (!decl) {
@@ -1517,8 +2319,9 @@ AstRef<AstProcType> Parser::parse_proc_type() {
 		return error("Expected ')'");
 	}
 	eat(); // Eat ')'
+	const auto decl_refs = decls.commit();
 
-	Array<AstRef<AstStmt>> types{temporary_};
+	PendingList<AstStmt> types{*this};
 	if (is_operator(OperatorKind::ARROW)) {
 		eat(); // Eat '->'
 
@@ -1566,8 +2369,7 @@ AstRef<AstProcType> Parser::parse_proc_type() {
 		}
 	}
 
-	auto decl_refs = ast_.insert(move(decls));
-	auto type_refs = ast_.insert(move(types));
+	auto type_refs = types.commit();
 	return ast_.create<AstProcType>(offset, decl_refs, type_refs);
 }
 
@@ -1810,7 +2612,7 @@ Parser::AttributeList Parser::parse_attributes() {
 		return error("Expected '@'");
 	}
 	eat(); // Eat '@'
-	Array<AstRef<AstField>> attrs{temporary_};
+	PendingList<AstField> attrs{*this};
 	if (is_operator(OperatorKind::LPAREN)) {
 		eat(); // Eat '('
 		while (!is_operator(OperatorKind::RPAREN) && !is_kind(TokenKind::ENDOF)) {
@@ -1834,19 +2636,19 @@ Parser::AttributeList Parser::parse_attributes() {
 			return {};
 		}
 	}
-	return attrs;
+	return attrs.commit();
 }
 
 Parser::DirectiveList Parser::parse_directives() {
 	TRACE();
-	Array<AstRef<AstDirective>> directives{temporary_};
+	PendingList<AstDirective> directives{*this};
 	while (is_kind(TokenKind::DIRECTIVE) && !is_kind(TokenKind::ENDOF)) {
 		auto directive = parse_directive();
 		if (!directive || !directives.push_back(directive)) {
 			return {};
 		}
 	}
-	return directives;
+	return directives.commit();
 }
 
 // Directive := '#' Ident '(' Expr (',' Expr)* ')'
@@ -1866,7 +2668,7 @@ AstRef<AstDirective> Parser::parse_directive() {
 	AstRefArray<AstExpr> refs;
 	if (is_operator(OperatorKind::LPAREN)) {
 		eat(); // Eat '('
-		Array<AstRef<AstExpr>> exprs{temporary_};
+		PendingList<AstExpr> exprs{*this};
 		while (!is_operator(OperatorKind::RPAREN) && !is_kind(TokenKind::ENDOF)) {
 			auto expr = parse_expr(false);
 			if (!expr || !exprs.push_back(expr)) {
@@ -1882,7 +2684,7 @@ AstRef<AstDirective> Parser::parse_directive() {
 			return error("Expected ')'");
 		}
 		eat(); // Eat ')'
-		refs = ast_.insert(move(exprs));
+		refs = exprs.commit();
 	}
 	return ast_.create<AstDirective>(offset, ident, refs);
 }
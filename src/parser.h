@@ -2,46 +2,121 @@
 #define THOR_PARSER_H
 #include "lexer.h"
 #include "ast.h"
+#include "diagnostic.h"
 #include "util/system.h"
 
 namespace Thor {
 
 struct Parser {
 	static Maybe<Parser> open(System& sys, StringView file);
+	// The same as above except the file is tokenized on up to [threads] threads.
+	static Maybe<Parser> open(System& sys, StringView file, Ulen threads);
+	// The same as above for [file] which was already opened as [lexer].
+	static Maybe<Parser> open(System& sys, StringView file, Lexer&& lexer, Ulen threads);
+	// Parse [tokens] which were produced by [lexer] for [file]. This is what open
+	// does after tokenizing the file, it's separate so that lexing and parsing can
+	// be measured on their own.
+	static Maybe<Parser> open(System& sys, StringView file, Lexer&& lexer, TokenBuffer&& tokens);
+	// Parse [file] which was opened as [lexer] while it's being lexed on a thread
+	// of its own, see TokenStream. The parser only waits for the lexer when it
+	// catches up to it. Worth it for large files parsed on their own.
+	static Maybe<Parser> open_streaming(System& sys, StringView file, Lexer&& lexer);
+
+	// The stream the tokens are read from when opened with open_streaming().
+	[[nodiscard]] THOR_FORCEINLINE TokenStream* stream() {
+		return stream_ ? &*stream_ : nullptr;
+	}
+
+	// Parse the file again after it was edited. The [previous] parser must have
+	// parsed the file with parse_file(). The top-level statements before and after
+	// the edit are kept, with the same AstRefs, and only those in between are lexed
+	// and parsed again. When that cannot be done, e.g because the edit left the
+	// file in a state that does not parse, the whole file is parsed again into an
+	// AstFile of its own instead. Imports are only reported to on_import for the
+	// statements which were parsed again. Gives nothing when the file could not be
+	// opened or parsed, like open, in which case the errors were already written.
+	static Maybe<Parser> reparse(Parser&& previous, StringView file);
+	// The same as above for the file [file] which was already opened as [lexer].
+	static Maybe<Parser> reparse(Parser&& previous, StringView file, Lexer&& lexer);
+
+	// Parse all of the top-level statements of the file. Where each of them is and
+	// a hash of its source is kept for reparse(). Returns false when one of them
+	// could not be parsed.
+	Bool parse_file();
+
+	// The statements parsed by parse_file() or reparse().
+	[[nodiscard]] THOR_FORCEINLINE Slice<const AstRef<AstStmt>> stmts() const {
+		return stmts_.slice();
+	}
+
 	AstStringRef parse_ident(Uint32* poffset = nullptr);
 
-	using DirectiveList = Maybe<Array<AstRef<AstDirective>>>;
-	using AttributeList = Maybe<Array<AstRef<AstField>>>;
+	// Called with the path of each import as soon as the import is parsed, which
+	// is before the rest of the file is.
+	using ImportFn = void(void* user, StringView path);
+	void on_import(ImportFn* fn, void* user) {
+		on_import_ = fn;
+		on_import_user_ = user;
+	}
+
+	// Skip over the bodies of procedures instead of parsing them when [lazy] is
+	// true. A skipped body can still be parsed when it's needed with parse_body.
+	void lazy_bodies(Bool lazy) {
+		lazy_bodies_ = lazy;
+	}
+
+	// Give up on the file after [limit] errors, zero is no limit. Once there are
+	// that many nothing more is parsed.
+	void error_limit(Ulen limit) {
+		diagnostics_.limit(limit);
+	}
+
+	// The number of errors found so far, including those over the limit.
+	[[nodiscard]] THOR_FORCEINLINE Ulen errors() const {
+		return errors_;
+	}
+
+	// Write the errors found so far to the console, in order of where they are in
+	// the file. Nothing is written until this is called.
+	void flush() {
+		diagnostics_.flush(sys_, ast_.filename(), lexer_);
+	}
+
+	// Parse the body of [proc] if it was skipped, otherwise gives the body it has.
+	// The body is lexed again from its source, the AST holds nothing of the tokens
+	// the file was parsed from.
+	AstRef<AstBlockStmt> parse_body(AstRef<AstProcExpr> proc);
+
+	using DirectiveList = Maybe<AstRefArray<AstDirective>>;
+	using AttributeList = Maybe<AstRefArray<AstField>>;
 
 	// Expression parsers
 	AstRef<AstExpr>       parse_expr(Bool lhs);
 	AstRef<AstExpr>       parse_value(Bool lhs);
 
-	AstRef<AstExpr>       parse_operand();
-	AstRef<AstExpr>       parse_bin_expr(Bool lhs, Uint32 prec);
-	AstRef<AstExpr>       parse_unary_expr(Bool lhs);
-	AstRef<AstExpr>       parse_operand(Bool lhs); // Operand parser for AstBinExpr or AstUnaryExpr
+	AstRef<AstExpr>       parse_bin_expr(Bool lhs, Uint32 prec, Bool value = false);
+	AstRef<AstExpr>       parse_operand(); // Operand parser for AstBinExpr or AstUnaryExpr
 
 	AstRef<AstIntExpr> parse_int_expr();
 	AstRef<AstFloatExpr> parse_float_expr();
 	AstRef<AstStringExpr> parse_string_expr();
 	AstRef<AstImaginaryExpr> parse_imaginary_expr();
-	AstRef<AstCompoundExpr> parse_compound_expr();
 	AstRef<AstProcExpr> parse_proc_expr();
 	AstRef<AstExpr> parse_paren_expr();
 	AstRef<AstIdentExpr> parse_ident_expr();
 	AstRef<AstUndefExpr> parse_undef_expr();
 	AstRef<AstContextExpr> parse_context_expr();
-	AstRef<AstIfExpr> parse_if_expr(AstRef<AstExpr> expr);
-	AstRef<AstWhenExpr> parse_when_expr(AstRef<AstExpr> on_true);
 	AstRef<AstDerefExpr> parse_deref_expr(AstRef<AstExpr> operand);
 	AstRef<AstOrReturnExpr> parse_or_return_expr(AstRef<AstExpr> operand);
 	AstRef<AstOrBreakExpr> parse_or_break_expr(AstRef<AstExpr> operand);
 	AstRef<AstOrContinueExpr> parse_or_continue_expr(AstRef<AstExpr> operand);
-	AstRef<AstCallExpr> parse_call_expr(AstRef<AstExpr> operand);
 
 	// Statement parsers
 	AstRef<AstStmt> parse_stmt(Bool use, DirectiveList&& directives, AttributeList&& attributes);
+	// Parse the next statement at the top level of the file, gives nothing at the
+	// end of it. A statement which cannot be parsed is given as an AstBadStmt, see
+	// recover(), so one error does not hide those after it.
+	AstRef<AstStmt> parse_top_stmt();
 	AstRef<AstExprStmt> parse_expr_stmt();
 	AstRef<AstEmptyStmt> parse_empty_stmt();
 	AstRef<AstBlockStmt> parse_block_stmt();
@@ -84,35 +159,80 @@ struct Parser {
 
 	[[nodiscard]] THOR_FORCEINLINE constexpr AstFile& ast() { return ast_; }
 	[[nodiscard]] THOR_FORCEINLINE constexpr const AstFile& ast() const { return ast_; }
+	[[nodiscard]] THOR_FORCEINLINE constexpr const Lexer& lexer() const { return lexer_; }
 private:
-	AstRef<AstExpr> parse_unary_atom(AstRef<AstExpr> operand, Bool lhs);
 	AstRef<AstField> parse_field(Bool allow_assignment);
 
 	AstRef<AstDirective> parse_directive();
 
-	Parser(System& sys, Lexer&& lexer, AstFile&& ast);
+	// Parse a statement in a [block], or at the top level of the file when it's
+	// false. When there are errors in it the statement is given as an AstBadStmt
+	// instead, errors in a block nested in it were already recovered from.
+	AstRef<AstStmt> parse_stmt_or_recover(Bool block);
+	// Skip over the rest of the statement which began at token [begin] but could
+	// not be parsed and give an AstBadStmt for it. The statement is taken to end
+	// at the first semicolon outside of its brackets, or at the '}' which closes
+	// the [block] it's in. One at the top level also ends at the keywords which
+	// can only begin a statement there and at a 'name ::' which begins a line.
+	AstRef<AstBadStmt> recover(Ulen begin, Bool block);
+
+	Parser(System& sys, Lexer&& lexer, TokenBuffer&& tokens, AstFile&& ast);
+
+	// Parse the top-level statements from the current token up to the first one
+	// at or after [end].
+	Bool parse_top_level(Uint32 end);
+	// Hash the source of the top-level statements [from, to) of [top_].
+	void hash_top_level(Ulen from, Ulen to);
+
+	// A list of nodes being parsed. All of the lists being parsed share one stack
+	// of pending IDs, a list nested in another is on top of it. A finished list is
+	// added to the AstFile with one append by commit() which pops it off of the
+	// stack. A list given up on, e.g because parsing failed, is popped when it goes
+	// out of scope. Only the list on top can be pushed to or committed so a list
+	// must be made after the lists it's in have everything they need before it.
+	template<typename T>
+	struct PendingList {
+		PendingList(Parser& parser)
+			: parser_{parser}
+			, mark_{parser.pending_.length()}
+		{
+		}
+		~PendingList() {
+			pop();
+		}
+		[[nodiscard]] Bool push_back(AstRef<T> ref) {
+			return parser_.pending_.push_back(ref);
+		}
+		[[nodiscard]] Ulen length() const {
+			return parser_.pending_.length() - mark_;
+		}
+		[[nodiscard]] Bool is_empty() const {
+			return length() == 0;
+		}
+		AstRefArray<T> commit() {
+			const auto& pending = parser_.pending_;
+			auto refs = parser_.ast_.template insert<T>(pending.slice().slice(mark_));
+			pop();
+			return refs;
+		}
+	private:
+		void pop() {
+			// Cannot fail, this only shrinks.
+			(void)parser_.pending_.resize(mark_);
+		}
+		Parser& parser_;
+		Ulen    mark_;
+	};
 
 	template<Ulen E, typename... Ts>
 	Unit error(Uint32 offset, const char (&msg)[E], Ts&&...) {
-		ScratchAllocator<1024> scratch{sys_.allocator};
-		StringBuilder builder{scratch};
-		auto position = lexer_.position(offset);
-		builder.put(ast_.filename());
-		builder.put(':');
-		builder.put(position.line);
-		builder.put(':');
-		builder.put(position.column);
-		builder.put(':');
-		builder.put(' ');
-		builder.put("error");
-		builder.put(':');
-		builder.put(' ');
-		builder.put(StringView { msg });
-		builder.put('\n');
-		if (auto result = builder.result()) {
-			sys_.console.write(sys_, *result);
-		} else {
-			sys_.console.write(sys_, StringView { "Out of memory" });
+		// Whatever else goes wrong in a statement after its first error likely
+		// follows from it, those are counted but only the first is reported.
+		if (errors_++ != recovered_) {
+			return {};
+		}
+		if (!quiet_ && !diagnostics_.report(offset, StringView { msg })) {
+			stop();
 		}
 		return {};
 	}
@@ -139,19 +259,76 @@ private:
 		return is_kind(TokenKind::ASSIGNMENT) && token_.as_assign == kind;
 	}
 
-	// Eat the current token, advancing the lexer and return the byte position of
-	// the previous token.
+	// Eat the current token, advancing to the next one and return the byte position
+	// of the previous token.
 	Uint32 eat();
 
+	// Skip to the end of the file. Everything being parsed runs into the end and
+	// gives up, which is how parsing stops once there are too many errors.
+	void stop() {
+		while (stream_ && stream_->read(tokens_, lexer_)) {
+			// The end is wherever the stream ends.
+		}
+		cursor_ = tokens_.length() - 1;
+		token_ = tokens_[cursor_];
+	}
+
 	System&            sys_;
-	TemporaryAllocator temporary_;
 	AstFile            ast_;
 	Lexer              lexer_;
+	TokenBuffer        tokens_;
+	Maybe<TokenStream> stream_; // What more of [tokens_] is read from as it's needed
+	Ulen               cursor_ = 0; // Index of [token_] in [tokens_]
 	Token              token_;
 	// >= 0: In Expression
 	// <  0: In Control Clause
 	Sint32             expr_level_ = 0;
 	Bool               allow_in_expr_ = false;
+	ImportFn*          on_import_ = nullptr;
+	void*              on_import_user_ = nullptr;
+	Bool               lazy_bodies_ = false;
+	Array<AstRef<AstNode>> pending_; // The lists being parsed, see PendingList
+	// The operators and operands of the expressions being parsed by parse_bin_expr.
+	// Those with an expression nested in them are markers, PAREN, CALL, COMPOUND,
+	// INDEX and the ternaries IF, WHEN and TERNARY ('?'), which keep what was
+	// parsed of them until they're closed.
+	struct PendingOp {
+		enum class Kind : Uint8 { PAREN, UNARY, CAST, BINARY, CALL, COMPOUND, INDEX, IF, WHEN, TERNARY };
+		Kind            kind;
+		OperatorKind    op;
+		Bool            lhs;          // Only for PAREN and INDEX, if it's the left-hand side
+		Uint32          offset;       // Not for BINARY
+		AstRef<AstType> type = {};    // Only for CAST, nil for auto_cast
+		AstRef<AstExpr> operand = {}; // What's called or indexed, the first of a ternary
+		AstRef<AstExpr> first = {};   // Once it's parsed, the name of a named argument or
+		                              // field, the left of an index or the second of a
+		                              // ternary
+		Uint8           phase = 0;    // Of an INDEX 1 after ':' and 2 after ',', of a
+		                              // ternary 1 in the false branch, of a COMPOUND 1
+		                              // after '=' and 2 once it has no more fields
+		Ulen            mark = 0;     // Of a CALL or COMPOUND: where its arguments or
+		                              // fields begin in [pending_]
+		Bool            value = false; // Of a COMPOUND, if it's a Value, see parse_bin_expr
+	};
+	Array<PendingOp>       ops_;
+	Array<AstRef<AstExpr>> operands_;
+	// A top-level statement parsed by parse_file(). Its source is from [begin] up
+	// to the [begin] of the one after it, or the end of the file for the last one,
+	// so whatever is between two statements is part of the first one.
+	struct TopLevel {
+		Uint32 begin; // Offset of its first token, zero for the first statement
+		Uint32 prev;  // Offset of the token before its first token
+		Token  first; // Its first token
+		Hash   hash;  // Of its source
+		Ulen   nodes; // Index in [nodes_] of the first of its nodes
+	};
+	Array<TopLevel>        top_;
+	Array<AstRef<AstStmt>> stmts_; // The statement of each of [top_]
+	Array<AstID>           nodes_; // Every node of [stmts_] in the order made
+	Diagnostics            diagnostics_;
+	Ulen                   errors_ = 0; // Including those not reported
+	Ulen                   recovered_ = 0; // The errors_ recovered from so far
+	Bool                   quiet_ = false; // Count errors without reporting them
 };
 
 } // namespace Thor
@@ -4,14 +4,15 @@
 #if defined(THOR_HOST_PLATFORM_POSIX)
 
 // Implementation of the System for POSIX systems
-#include <sys/stat.h> // fstat, struct stat
-#include <sys/mman.h> // PROT_READ, PROT_WRITE, MAP_PRIVATE, MAP_ANONYMOUS
-#include <unistd.h> // open, close, pread, pwrite
+#include <sys/stat.h> // fstat, mkdir, struct stat
+#include <sys/mman.h> // mmap, munmap, madvise, PROT_READ, PROT_WRITE, MAP_PRIVATE, MAP_ANONYMOUS
+#include <unistd.h> // open, close, pread, pwrite, sysconf, unlink, getpid
 #include <fcntl.h> // O_CLOEXEC, O_RDONLY, O_WRONLY
 #include <dirent.h> // opendir, readdir, closedir
 #include <string.h> // strlen
 #include <dlfcn.h> // dlopen, dlclose, dlsym, RTLD_NOW
-#include <stdio.h> // printf
+#include <stdio.h> // printf, rename
+#include <errno.h> // errno, EEXIST
 #include <pthread.h> // pthread_create, pthread_join, pthread_sigblock
 #include <signal.h> // sigset, sigfillset
 #include <stdlib.h> // exit needed from libc since it calls destructors
@@ -78,6 +79,52 @@ static Uint64 filesystem_tell_file(System&, Filesystem::File* file) {
 	return 0;
 }
 
+static Slice<const Uint8> filesystem_map_file(System& sys, Filesystem::File* file) {
+	auto fd = reinterpret_cast<Address>(file);
+	const auto length = filesystem_tell_file(sys, file);
+	if (length == 0) {
+		return {};
+	}
+	auto addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED) {
+		return {};
+	}
+#if defined(MADV_SEQUENTIAL)
+	// Source is read front to back so encourage aggressive read-ahead.
+	madvise(addr, length, MADV_SEQUENTIAL);
+#endif
+	return { static_cast<const Uint8*>(addr), Ulen(length) };
+}
+
+static void filesystem_unmap_file(System&, Slice<const Uint8> data) {
+	munmap(const_cast<Uint8*>(data.data()), data.length());
+}
+
+static Bool filesystem_rename_file(System& sys, StringView src, StringView dst) {
+	ScratchAllocator<1024> scratch{sys.allocator};
+	auto src_path = scratch.allocate<char>(src.length() + 1, false);
+	auto dst_path = scratch.allocate<char>(dst.length() + 1, false);
+	if (!src_path || !dst_path) {
+		return false;
+	}
+	memcpy(src_path, src.data(), src.length());
+	src_path[src.length()] = '\0';
+	memcpy(dst_path, dst.data(), dst.length());
+	dst_path[dst.length()] = '\0';
+	return rename(src_path, dst_path) == 0;
+}
+
+static Bool filesystem_remove_file(System& sys, StringView name) {
+	ScratchAllocator<1024> scratch{sys.allocator};
+	auto path = scratch.allocate<char>(name.length() + 1, false);
+	if (!path) {
+		return false;
+	}
+	memcpy(path, name.data(), name.length());
+	path[name.length()] = '\0';
+	return unlink(path) == 0;
+}
+
 Filesystem::Directory* filesystem_open_dir(System& sys, StringView name) {
 	ScratchAllocator<1024> scratch{sys.allocator};
 	auto path = scratch.allocate<char>(name.length() + 1, false);
@@ -123,15 +170,31 @@ Bool filesystem_read_dir(System&, Filesystem::Directory* handle, Filesystem::Ite
 	return false;
 }
 
+static Bool filesystem_make_dir(System& sys, StringView name) {
+	ScratchAllocator<1024> scratch{sys.allocator};
+	auto path = scratch.allocate<char>(name.length() + 1, false);
+	if (!path) {
+		return false;
+	}
+	memcpy(path, name.data(), name.length());
+	path[name.length()] = '\0';
+	return mkdir(path, 0777) == 0 || errno == EEXIST;
+}
+
 extern const Filesystem STD_FILESYSTEM = {
-	.open_file  = filesystem_open_file,
-	.close_file = filesystem_close_file,
-	.read_file  = filesystem_read_file,
-	.write_file = filesystem_write_file,
-	.tell_file  = filesystem_tell_file,
-	.open_dir   = filesystem_open_dir,
-	.close_dir  = filesystem_close_dir,
-	.read_dir   = filesystem_read_dir,
+	.open_file   = filesystem_open_file,
+	.close_file  = filesystem_close_file,
+	.read_file   = filesystem_read_file,
+	.write_file  = filesystem_write_file,
+	.tell_file   = filesystem_tell_file,
+	.map_file    = filesystem_map_file,
+	.unmap_file  = filesystem_unmap_file,
+	.rename_file = filesystem_rename_file,
+	.remove_file = filesystem_remove_file,
+	.open_dir    = filesystem_open_dir,
+	.close_dir   = filesystem_close_dir,
+	.read_dir    = filesystem_read_dir,
+	.make_dir    = filesystem_make_dir,
 };
 
 static void* heap_allocate(System&, Ulen length, [[maybe_unused]] Bool zero) {
@@ -192,8 +255,13 @@ static void process_assert(System& sys, StringView msg, StringView file, Sint32
 	exit(3);
 }
 
+static Uint64 process_id(System&) {
+	return Uint64(getpid());
+}
+
 extern const Process STD_PROCESS = {
 	.assert = process_assert,
+	.id     = process_id,
 };
 
 static Linker::Library* linker_load(System&, StringView name) {
@@ -407,6 +475,11 @@ static void scheduler_yield(System&) {
 	sched_yield();
 }
 
+static Ulen scheduler_thread_count(System&) {
+	const auto count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? Ulen(count) : 1;
+}
+
 extern const Scheduler STD_SCHEDULER = {
 	.thread_start = scheduler_thread_start,
 	.thread_join = scheduler_thread_join,
@@ -423,6 +496,8 @@ extern const Scheduler STD_SCHEDULER = {
 	.cond_wait = scheduler_cond_wait,
 
 	.yield = scheduler_yield,
+
+	.thread_count = scheduler_thread_count,
 };
 
 static Float64 chrono_monotonic_now(System&) {
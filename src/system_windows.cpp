@@ -201,6 +201,54 @@ static Uint64 filesystem_tell_file(System&, Filesystem::File* file) {
 	return 0;
 }
 
+static Slice<const Uint8> filesystem_map_file(System& sys, Filesystem::File* file) {
+	const auto length = filesystem_tell_file(sys, file);
+	if (length == 0) {
+		return {};
+	}
+	auto mapping = CreateFileMappingW(reinterpret_cast<HANDLE>(file),
+	                                  nullptr,
+	                                  PAGE_READONLY,
+	                                  0,
+	                                  0,
+	                                  nullptr);
+	if (!mapping) {
+		return {};
+	}
+	auto addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	// The view keeps a reference to the mapping object so the handle can go.
+	CloseHandle(mapping);
+	if (!addr) {
+		return {};
+	}
+	return { static_cast<const Uint8*>(addr), Ulen(length) };
+}
+
+static void filesystem_unmap_file(System&, Slice<const Uint8> data) {
+	UnmapViewOfFile(data.data());
+}
+
+static Bool filesystem_rename_file(System& sys, StringView src, StringView dst) {
+	ScratchAllocator<2048> scratch{sys.allocator};
+	auto src_name = utf8_to_utf16(scratch, src.cast<const Uint8>());
+	auto dst_name = utf8_to_utf16(scratch, dst.cast<const Uint8>());
+	if (src_name.is_empty() || dst_name.is_empty()) {
+		return false;
+	}
+	return MoveFileExW(reinterpret_cast<LPCWSTR>(src_name.data()),
+	                   reinterpret_cast<LPCWSTR>(dst_name.data()),
+	                   MOVEFILE_REPLACE_EXISTING);
+}
+
+static Bool filesystem_remove_file(System& sys, StringView name) {
+	ScratchAllocator<1024> scratch{sys.allocator};
+	auto filename = utf8_to_utf16(scratch, name.cast<const Uint8>());
+	if (filename.is_empty()) {
+		return false;
+	}
+	return DeleteFileW(reinterpret_cast<LPCWSTR>(filename.data()));
+}
+
 struct FindData {
 	FindData(Allocator& allocator)
 		: allocator{allocator}
@@ -268,15 +316,30 @@ Bool filesystem_read_dir(System&, Filesystem::Directory* handle, Filesystem::Ite
 	return true;
 }
 
+static Bool filesystem_make_dir(System& sys, StringView name) {
+	ScratchAllocator<1024> scratch{sys.allocator};
+	auto filename = utf8_to_utf16(scratch, name.cast<const Uint8>());
+	if (filename.is_empty()) {
+		return false;
+	}
+	return CreateDirectoryW(reinterpret_cast<LPCWSTR>(filename.data()), nullptr)
+	    || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
 extern const Filesystem STD_FILESYSTEM = {
-	.open_file  = filesystem_open_file,
-	.close_file = filesystem_close_file,
-	.read_file  = filesystem_read_file,
-	.write_file = filesystem_write_file,
-	.tell_file  = filesystem_tell_file,
-	.open_dir   = filesystem_open_dir,
-	.close_dir  = filesystem_close_dir,
-	.read_dir   = filesystem_read_dir,
+	.open_file   = filesystem_open_file,
+	.close_file  = filesystem_close_file,
+	.read_file   = filesystem_read_file,
+	.write_file  = filesystem_write_file,
+	.tell_file   = filesystem_tell_file,
+	.map_file    = filesystem_map_file,
+	.unmap_file  = filesystem_unmap_file,
+	.rename_file = filesystem_rename_file,
+	.remove_file = filesystem_remove_file,
+	.open_dir    = filesystem_open_dir,
+	.close_dir   = filesystem_close_dir,
+	.read_dir    = filesystem_read_dir,
+	.make_dir    = filesystem_make_dir,
 };
 
 static void* heap_allocate(System&, Ulen length, [[maybe_unused]] Bool zero) {
@@ -329,8 +392,13 @@ static void process_assert(System& sys, StringView msg, StringView file, Sint32
 	ExitProcess(3);
 }
 
+static Uint64 process_id(System&) {
+	return Uint64(GetCurrentProcessId());
+}
+
 extern const Process STD_PROCESS = {
 	.assert = process_assert,
+	.id     = process_id,
 };
 
 static Linker::Library* linker_load(System&, StringView name) {
@@ -477,6 +545,12 @@ static void scheduler_yield(System&) {
 	SwitchToThread();
 }
 
+static Ulen scheduler_thread_count(System&) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? Ulen(info.dwNumberOfProcessors) : 1;
+}
+
 extern const Scheduler STD_SCHEDULER = {
 	.thread_start = scheduler_thread_start,
 	.thread_join = scheduler_thread_join,
@@ -492,7 +566,9 @@ extern const Scheduler STD_SCHEDULER = {
 	.cond_broadcast = scheduler_cond_broadcast,
 	.cond_wait = scheduler_cond_wait,
 
-	.yield = scheduler_yield
+	.yield = scheduler_yield,
+
+	.thread_count = scheduler_thread_count,
 };
 
 // Windows is rife with various timing-related discrepancies and historical bugs
@@ -29,6 +29,14 @@ struct Atomic {
 		return value_.exchange(desired, order);
 	}
 
+	THOR_FORCEINLINE T fetch_add(T value, MemoryOrder order = MemoryOrder::seq_cst) {
+		return value_.fetch_add(value, order);
+	}
+
+	THOR_FORCEINLINE T fetch_sub(T value, MemoryOrder order = MemoryOrder::seq_cst) {
+		return value_.fetch_sub(value, order);
+	}
+
 	THOR_FORCEINLINE Bool compare_exchange_weak(T expected, T desired, MemoryOrder order = MemoryOrder::seq_cst) {
 		T expected_or_actual = expected;
 		return value_.compare_exchange_weak(expected_or_actual, desired, order);
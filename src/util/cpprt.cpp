@@ -26,19 +26,34 @@ void operator delete(void*, unsigned long) noexcept {
 
 extern "C" {
 
+// Function-local statics can be first reached from more than one thread at once
+// so the guard has to be thread-safe. The thread which sets [pending] runs the
+// initializer while the others wait for [done]. The initializers are all tiny
+// so waiting is just spinning.
 int __cxa_guard_acquire(Guard* guard) {
-	if (guard->done) {
+	if (__atomic_load_n(&guard->done, __ATOMIC_ACQUIRE)) {
 		return 0;
 	}
-	if (guard->pending) {
-		*(volatile int *)0 = 0;
+	while (__atomic_exchange_n(&guard->pending, 1, __ATOMIC_ACQUIRE)) {
+		if (__atomic_load_n(&guard->done, __ATOMIC_ACQUIRE)) {
+			return 0;
+		}
+	}
+	if (__atomic_load_n(&guard->done, __ATOMIC_ACQUIRE)) {
+		// Another thread finished initializing between the two checks.
+		__atomic_store_n(&guard->pending, 0, __ATOMIC_RELEASE);
+		return 0;
 	}
-	guard->pending = 1;
 	return 1;
 }
 
 void __cxa_guard_release(Guard* guard) {
-	guard->done = 1;
+	__atomic_store_n(&guard->done, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&guard->pending, 0, __ATOMIC_RELEASE);
+}
+
+void __cxa_guard_abort(Guard* guard) {
+	__atomic_store_n(&guard->pending, 0, __ATOMIC_RELEASE);
 }
 
 void __cxa_pure_virtual() {
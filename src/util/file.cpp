@@ -62,4 +62,23 @@ Array<Uint8> File::map(Allocator& allocator) const {
 	return result;
 }
 
+Maybe<FileMap> FileMap::open(System& sys, StringView name) {
+	auto file = File::open(sys, name, File::Access::RD);
+	if (!file) {
+		return {};
+	}
+	auto data = sys.filesystem.map_file(sys, file->file_);
+	if (data.is_empty()) {
+		return {};
+	}
+	return FileMap{sys, data};
+}
+
+void FileMap::close() {
+	if (!data_.is_empty()) {
+		sys_.filesystem.unmap_file(sys_, data_);
+		data_ = {};
+	}
+}
+
 } // namespace Thor
\ No newline at end of file
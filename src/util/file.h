@@ -32,6 +32,7 @@ struct File {
 	Array<Uint8> map(Allocator& allocator) const;
 
 private:
+	friend struct FileMap;
 	File* drop() {
 		close();
 		return this;
@@ -45,6 +46,44 @@ private:
 	Filesystem::File* file_;
 };
 
+// Read-only view of the contents of a file mapped into memory with map_file. Has
+// no padding or terminator after the contents so it must never be read past the
+// end of data().
+struct FileMap {
+	static Maybe<FileMap> open(System& sys, StringView name);
+
+	constexpr FileMap(FileMap&& other)
+		: sys_{other.sys_}
+		, data_{exchange(other.data_, Slice<const Uint8>{})}
+	{
+	}
+
+	~FileMap() { close(); }
+
+	FileMap& operator=(FileMap&& other) {
+		return *new (drop(), Nat{}) FileMap{move(other)};
+	}
+
+	THOR_FORCEINLINE constexpr Slice<const Uint8> data() const {
+		return data_;
+	}
+
+	void close();
+
+private:
+	FileMap* drop() {
+		close();
+		return this;
+	}
+	constexpr FileMap(System& sys, Slice<const Uint8> data)
+		: sys_{sys}
+		, data_{data}
+	{
+	}
+	System&            sys_;
+	Slice<const Uint8> data_;
+};
+
 } // namespace Thor
 
 #endif // THOR_FILE_H
\ No newline at end of file
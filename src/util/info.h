@@ -51,5 +51,6 @@
 
 // These are debug build options
 // #define THOR_CFG_USE_MALLOC 1
+// #define THOR_CFG_NO_SIMD 1
 
 #endif // THOR_INFO_H
\ No newline at end of file
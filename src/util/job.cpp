@@ -0,0 +1,198 @@
+#include "util/job.h"
+#include "util/atomic.h"
+#include "util/thread.h"
+
+namespace Thor {
+
+// The jobs of worker [w] out of [n] workers are w, w + n, w + 2n, ... The ones
+// still to run are [head, tail) of that sequence. Both are packed into one word
+// so the owner taking from the front and a thief taking from the back agree on
+// who gets the last job with a single compare and exchange.
+struct JobWorker {
+	static constexpr Uint64 pack(Uint32 head, Uint32 tail) {
+		return Uint64(head) << 32 | tail;
+	}
+
+	// Take the next job from the front, only the owner does this.
+	Maybe<Ulen> pop() {
+		for (;;) {
+			const auto range = range_.load(MemoryOrder::acquire);
+			const auto head = Uint32(range >> 32);
+			const auto tail = Uint32(range);
+			if (head >= tail) {
+				return {};
+			}
+			if (range_.compare_exchange_weak(range, pack(head + 1, tail))) {
+				return index_ + head * count_;
+			}
+		}
+	}
+
+	// Take the last job from the back, the other workers do this.
+	Maybe<Ulen> steal() {
+		for (;;) {
+			const auto range = range_.load(MemoryOrder::acquire);
+			const auto head = Uint32(range >> 32);
+			const auto tail = Uint32(range);
+			if (head >= tail) {
+				return {};
+			}
+			if (range_.compare_exchange_weak(range, pack(head, tail - 1))) {
+				return index_ + (tail - 1) * count_;
+			}
+		}
+	}
+
+	static void run(System& sys, void* user) {
+		auto& self = *static_cast<JobWorker*>(user);
+		for (;;) {
+			auto job = self.pop();
+			if (!job) {
+				job = self.pool_->take();
+			}
+			for (Ulen i = 1; !job && i < self.count_; i++) {
+				job = self.workers_[(self.index_ + i) % self.count_].steal();
+			}
+			if (job) {
+				self.fn_(*self.pool_, sys, self.user_, *job);
+				self.pool_->done();
+			} else if (!self.pool_->wait()) {
+				return;
+			}
+		}
+	}
+
+	JobPool*       pool_    = nullptr;
+	JobPool::Fn*   fn_      = nullptr;
+	void*          user_    = nullptr;
+	JobWorker*     workers_ = nullptr;
+	Ulen           index_   = 0;
+	Ulen           count_   = 0;
+	Atomic<Uint64> range_{0};
+	// Padded so that the range of each worker is on a cache line of its own.
+	Uint8          padding_[8];
+};
+static_assert(sizeof(JobWorker) == 64);
+
+JobPool::JobPool(System& sys, Scheduler::Mutex* mutex, Scheduler::Cond* cond)
+	: sys_{sys}
+	, heap_{sys}
+	, mutex_{mutex}
+	, cond_{cond}
+	, queue_{heap_}
+{
+}
+
+JobPool::~JobPool() {
+	if (cond_) sys_.scheduler.cond_destroy(sys_, cond_);
+	if (mutex_) sys_.scheduler.mutex_destroy(sys_, mutex_);
+}
+
+Bool JobPool::push(Ulen index) {
+	// Counted before it's queued so the pool cannot be seen as done in between.
+	pending_.fetch_add(1);
+	sys_.scheduler.mutex_lock(sys_, mutex_);
+	const auto ok = queue_.push_back(index);
+	if (ok) {
+		sys_.scheduler.cond_signal(sys_, cond_);
+	}
+	sys_.scheduler.mutex_unlock(sys_, mutex_);
+	if (!ok) {
+		pending_.fetch_sub(1);
+	}
+	return ok;
+}
+
+Maybe<Ulen> JobPool::take() {
+	Maybe<Ulen> job;
+	sys_.scheduler.mutex_lock(sys_, mutex_);
+	if (head_ < queue_.length()) {
+		job = Ulen { queue_[head_++] };
+		if (head_ == queue_.length()) {
+			queue_.clear();
+			head_ = 0;
+		}
+	}
+	sys_.scheduler.mutex_unlock(sys_, mutex_);
+	return job;
+}
+
+Bool JobPool::wait() {
+	// The ranges of the workers only ever shrink so once there is nothing left to
+	// steal only a push can make more work.
+	sys_.scheduler.mutex_lock(sys_, mutex_);
+	while (head_ == queue_.length() && pending_.load() != 0) {
+		sys_.scheduler.cond_wait(sys_, cond_, mutex_);
+	}
+	const auto more = pending_.load() != 0;
+	sys_.scheduler.mutex_unlock(sys_, mutex_);
+	return more;
+}
+
+void JobPool::done() {
+	if (pending_.fetch_sub(1) == 1) {
+		// That was the last job, wake everyone so they can leave. Taking the mutex
+		// keeps this from landing between the check and the sleep in wait().
+		sys_.scheduler.mutex_lock(sys_, mutex_);
+		sys_.scheduler.cond_broadcast(sys_, cond_);
+		sys_.scheduler.mutex_unlock(sys_, mutex_);
+	}
+}
+
+Bool JobPool::run(System& sys, Ulen jobs, Ulen threads, Fn* fn, void* user) {
+	if (jobs == 0) {
+		return true;
+	}
+	if (jobs > 0xffff'ffff_ulen) {
+		return false;
+	}
+	if (threads == 0) {
+		threads = 1;
+	}
+
+	JobPool pool{sys, sys.scheduler.mutex_create(sys), sys.scheduler.cond_create(sys)};
+	if (!pool.mutex_ || !pool.cond_) {
+		return false;
+	}
+	pool.pending_.store(jobs);
+
+	// The threads all share the workers, they're allocated from the system
+	// allocator as it's the only allocator safe to use from multiple threads.
+	auto& heap = pool.heap_;
+	auto workers = heap.allocate<JobWorker>(threads, false);
+	if (!workers) {
+		return false;
+	}
+	for (Ulen i = 0; i < threads; i++) {
+		auto& worker = *new (workers + i, Nat{}) JobWorker{};
+		worker.pool_ = &pool;
+		worker.fn_ = fn;
+		worker.user_ = user;
+		worker.workers_ = workers;
+		worker.index_ = i;
+		worker.count_ = threads;
+		// There can be more threads than jobs up front as jobs can be pushed later.
+		const auto count = i < jobs ? (jobs - i + threads - 1) / threads : 0;
+		worker.range_.store(JobWorker::pack(0, Uint32(count)));
+	}
+
+	// The first worker runs on this thread.
+	Array<Thread> started{heap};
+	if (started.reserve(threads - 1)) {
+		for (Ulen i = 1; i < threads; i++) {
+			if (auto thread = Thread::start(sys, JobWorker::run, &workers[i])) {
+				// Cannot fail, the space was reserved.
+				(void)started.push_back(move(*thread));
+			}
+		}
+	}
+	JobWorker::run(sys, &workers[0]);
+	for (auto& thread : started) {
+		thread.join();
+	}
+
+	heap.deallocate(workers, threads);
+	return true;
+}
+
+} // namespace Thor
@@ -0,0 +1,62 @@
+#ifndef THOR_JOB_H
+#define THOR_JOB_H
+#include "util/array.h"
+#include "util/atomic.h"
+#include "util/system.h"
+
+namespace Thor {
+
+struct JobWorker;
+
+// Runs jobs on a pool of threads. The jobs given up front are dealt out to the
+// threads round-robin. Each thread runs its own jobs in order and when it runs
+// out it steals jobs from the back of the other threads.
+//
+// A running job can add more jobs with push(). Those go on a queue shared by
+// all of the threads which is taken from before stealing, so work found while
+// running is started as soon as any thread is free. A thread with nothing to
+// run sleeps until a job is pushed or every job is done.
+//
+// Jobs which come first are run first, so giving the largest jobs the smallest
+// indices keeps a few large jobs from being run last on their own.
+struct JobPool {
+	// Run job [index] of [user]. The [sys] is the one given to run() and is shared
+	// by all of the threads so its allocator must not be used by the job.
+	using Fn = void(JobPool& pool, System& sys, void* user, Ulen index);
+
+	// Run [fn] once for each of the jobs in [0, jobs) and each job pushed while
+	// running on up to [threads] threads, the calling thread is one of them.
+	// Returns once all of the jobs are done or false when the pool could not be
+	// made. A thread which cannot be started does not lose its jobs, the other
+	// threads steal all of them.
+	static Bool run(System& sys, Ulen jobs, Ulen threads, Fn* fn, void* user);
+
+	// Add job [index], only a running job may do this. Returns false when out of
+	// memory in which case the job is not run.
+	Bool push(Ulen index);
+
+private:
+	friend struct JobWorker;
+
+	JobPool(System& sys, Scheduler::Mutex* mutex, Scheduler::Cond* cond);
+	~JobPool();
+
+	// Take the oldest pushed job.
+	Maybe<Ulen> take();
+	// Wait for a job to be pushed. Returns false once every job is done.
+	Bool wait();
+	// Mark a job as done.
+	void done();
+
+	System&           sys_;
+	SystemAllocator   heap_;
+	Scheduler::Mutex* mutex_;
+	Scheduler::Cond*  cond_;
+	Array<Ulen>       queue_; // Pushed jobs, [head_, length) are still to run
+	Ulen              head_ = 0;
+	Atomic<Ulen>      pending_{0}; // Jobs not yet done, including running ones
+};
+
+} // namespace Thor
+
+#endif // THOR_JOB_H
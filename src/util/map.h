@@ -39,17 +39,19 @@ struct Map {
 		const K& k;
 		V&       v;
 	};
+	struct ConstTuple {
+		const K& k;
+		const V& v;
+	};
 	Maybe<Tuple> find(const K& k) {
-		if (length_ == 0) return {};
-		auto h = hash(k);
-		h |= h == 0;
-		auto q = capacity_ - 1;
-		auto m = h & q;
-		while (hs_[m] != 0) {
-			if (ks_[m] == k) {
-				return Tuple { ks_[m], vs_[m] };
-			}
-			m = (m + 1) & q;
+		if (auto m = slot(k)) {
+			return Tuple { ks_[*m], vs_[*m] };
+		}
+		return {};
+	}
+	Maybe<ConstTuple> find(const K& k) const {
+		if (auto m = slot(k)) {
+			return ConstTuple { ks_[*m], vs_[*m] };
 		}
 		return {};
 	}
@@ -95,6 +97,21 @@ struct Map {
 private:
 	friend struct Iterator;
 
+	Maybe<Ulen> slot(const K& k) const {
+		if (length_ == 0) return {};
+		auto h = hash(k);
+		h |= h == 0;
+		auto q = capacity_ - 1;
+		auto m = h & q;
+		while (hs_[m] != 0) {
+			if (ks_[m] == k) {
+				return Ulen(m);
+			}
+			m = (m + 1) & q;
+		}
+		return {};
+	}
+
 	static Uint64 assign(K* ks, V* vs, H* hs, K&& k, V&& v, H h, Ulen capacity) {
 		auto q = capacity - 1;
 		auto m = h & q;
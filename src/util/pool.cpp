@@ -96,6 +96,7 @@ Pool::Pool(Pool&& other)
 	, data_{exchange(other.data_, nullptr)}
 	, used_{exchange(other.used_, nullptr)}
 	, last_{exchange(other.last_, 0)}
+	, borrowed_{exchange(other.borrowed_, false)}
 {
 }
 
@@ -112,13 +113,61 @@ Pool::Pool(Pool&& other)
 		}
 		return 64;
 	}
+
+	// Count the number of leading zero bits in [value].
+	static inline Uint32 count_leading_zeros(Uint64 value) {
+		DWORD leading_one = 0;
+		if (_BitScanReverse64(&leading_one, value)) {
+			return 63 - leading_one;
+		}
+		return 64;
+	}
+
+	static inline Uint32 count_ones(Uint64 value) {
+		return Uint32(__popcnt64(value));
+	}
 #else
 	static inline Uint32 count_trailing_zeros(Uint64 value) {
 		return __builtin_ctzll(value);
 	}
+	static inline Uint32 count_leading_zeros(Uint64 value) {
+		return __builtin_clzll(value);
+	}
+	static inline Uint32 count_ones(Uint64 value) {
+		return __builtin_popcountll(value);
+	}
 #endif
 
+Pool Pool::view(Allocator& allocator, Ulen size, Ulen capacity, const Uint8* data, Slice<const Uint64> used) {
+	Ulen length = 0;
+	for (auto word : used) {
+		length += count_ones(word);
+	}
+	// Never written through, allocate() and deallocate() leave a borrowed pool be.
+	return Pool {
+		allocator,
+		size,
+		length,
+		capacity,
+		const_cast<Uint8*>(data),
+		const_cast<Word*>(used.data()),
+		true
+	};
+}
+
+Ulen Pool::extent() const {
+	for (Ulen w_index = capacity_ / BITS; w_index-- > 0; ) {
+		if (const auto word = used_[w_index]) {
+			return (w_index + 1) * BITS - count_leading_zeros(word);
+		}
+	}
+	return 0;
+}
+
 Maybe<PoolRef> Pool::allocate() {
+	if (borrowed_) {
+		return {};
+	}
 	const auto n_words = Uint32(capacity_ / BITS);
 	const auto w_index = last_;
 	if (auto scan = ~used_[w_index]) {
@@ -142,7 +191,9 @@ Maybe<PoolRef> Pool::allocate() {
 void Pool::deallocate(PoolRef ref) {
 	const auto w_index = ref.index / BITS;
 	const auto b_index = ref.index % BITS;
-	used_[w_index] &= ~(Word(1) << b_index);
+	if (!borrowed_) {
+		used_[w_index] &= ~(Word(1) << b_index);
+	}
 	length_--;
 }
 
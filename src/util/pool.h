@@ -2,6 +2,7 @@
 #define THOR_POOL_H
 // #include "util/types.h"
 #include "util/maybe.h"
+#include "util/slice.h"
 #include "util/allocator.h"
 
 namespace Thor {
@@ -25,11 +26,27 @@ struct Pool {
 	static Maybe<Pool> load(Allocator& allocator, Stream& stream);
 	Bool save(Stream& stream) const;
 
+	// A read-only pool over [data] and [used] which belong to someone else, e.g a
+	// mapped file. Nothing can be allocated from it and [data] only has to reach
+	// as far as extent() of the pool it was taken from.
+	static Pool view(Allocator& allocator, Ulen size, Ulen capacity, const Uint8* data, Slice<const Uint64> used);
+
 	Pool(Pool&& other);
 	~Pool() { drop(); }
 
 	[[nodiscard]] THOR_FORCEINLINE constexpr auto length() const { return length_; }
 	[[nodiscard]] THOR_FORCEINLINE constexpr auto is_empty() const { return length_ == 0; }
+	[[nodiscard]] THOR_FORCEINLINE constexpr auto capacity() const { return capacity_; }
+
+	// One past the last object in use.
+	[[nodiscard]] Ulen extent() const;
+
+	[[nodiscard]] THOR_FORCEINLINE constexpr Slice<const Uint64> used() const {
+		return { used_, capacity_ / BITS };
+	}
+	[[nodiscard]] THOR_FORCEINLINE constexpr Slice<const Uint8> data() const {
+		return { data_, size_ * capacity_ };
+	}
 
 	constexpr Pool(const Pool&) = delete;
 	constexpr Pool& operator=(const Pool&) = delete;
@@ -45,9 +62,10 @@ struct Pool {
 	THOR_FORCEINLINE constexpr auto operator[](PoolRef ref) const { return data_ + size_ * ref.index; }
 
 private:
+	friend struct Slab;
 	using Word = Uint64;
 	static constexpr const auto BITS = Uint32(sizeof(Word) * 8);
-	constexpr Pool(Allocator& allocator, Ulen size, Ulen length, Ulen capacity, Uint8* data, Word* used)
+	constexpr Pool(Allocator& allocator, Ulen size, Ulen length, Ulen capacity, Uint8* data, Word* used, Bool borrowed = false)
 		: allocator_{allocator}
 		, size_{size}
 		, length_{length}
@@ -55,12 +73,15 @@ private:
 		, data_{data}
 		, used_{used}
 		, last_{0}
+		, borrowed_{borrowed}
 	{
 	}
 
 	Pool* drop() {
-		allocator_.deallocate(data_, size_ * capacity_);
-		allocator_.deallocate(used_, capacity_ / BITS);
+		if (!borrowed_) {
+			allocator_.deallocate(data_, size_ * capacity_);
+			allocator_.deallocate(used_, capacity_ / BITS);
+		}
 		return this;
 	}
 
@@ -71,6 +92,7 @@ private:
 	Uint8*     data_;      // Object memory
 	Word*      used_;      // Bitset where bit N indicates object N is in-use or not.
 	Uint32     last_;      // Last w_index
+	Bool       borrowed_;  // See view()
 };
 
 }
@@ -0,0 +1,63 @@
+#ifndef THOR_RING_H
+#define THOR_RING_H
+#include "util/atomic.h"
+#include "util/slice.h"
+
+namespace Thor {
+
+// A queue of up to [E] items between one thread writing to it and one other
+// thread reading from it. Neither takes a lock, each only ever stores to its own
+// end and loads the other, and neither waits: a write into a full ring or a read
+// from an empty one just gives back zero items and it's up to the caller what
+// to do about it.
+template<typename T, Ulen E>
+struct Ring {
+	static_assert(E && (E & (E - 1)) == 0, "Size of Ring must be a power of two");
+
+	// Write as many of [items] as there is room for, returns how many that was.
+	// Only the writing thread may call this.
+	Ulen write(Slice<const T> items) {
+		const auto tail = tail_.load(MemoryOrder::relaxed);
+		const auto head = head_.load(MemoryOrder::acquire);
+		auto n = E - (tail - head);
+		if (n > items.length()) {
+			n = items.length();
+		}
+		for (Ulen i = 0; i < n; i++) {
+			items_[(tail + i) & (E - 1)] = items[i];
+		}
+		// The items are only seen by the reader once the tail is moved past them.
+		tail_.store(tail + n, MemoryOrder::release);
+		return n;
+	}
+
+	// Read as many items as there are into [items], up to the length of it, and
+	// returns how many that was. Only the reading thread may call this.
+	Ulen read(Slice<T> items) {
+		const auto head = head_.load(MemoryOrder::relaxed);
+		const auto tail = tail_.load(MemoryOrder::acquire);
+		auto n = tail - head;
+		if (n > items.length()) {
+			n = items.length();
+		}
+		for (Ulen i = 0; i < n; i++) {
+			items[i] = items_[(head + i) & (E - 1)];
+		}
+		// The writer only reuses the space once the head is moved past it.
+		head_.store(head + n, MemoryOrder::release);
+		return n;
+	}
+
+private:
+	// The two ends are kept on cache lines of their own so the threads do not
+	// fight over a line each time the other one moves its end.
+	Atomic<Ulen> head_{0}; // Index of the next item to read
+	Uint8        padding0_[64 - sizeof(Atomic<Ulen>)];
+	Atomic<Ulen> tail_{0}; // Index of the next item to write
+	Uint8        padding1_[64 - sizeof(Atomic<Ulen>)];
+	T            items_[E];
+};
+
+} // namespace Thor
+
+#endif // THOR_RING_H
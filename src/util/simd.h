@@ -0,0 +1,206 @@
+#ifndef THOR_SIMD_H
+#define THOR_SIMD_H
+#include "util/types.h"
+
+// Select the widest vector instruction set the compiler is targeting. Nothing
+// here does runtime dispatch, building with -mavx2 (or -march=native) is what
+// enables the AVX2 path, SSE2 is the baseline on x86_64 and NEON on AArch64.
+#if !defined(THOR_CFG_NO_SIMD)
+	#if defined(__AVX2__)
+		#include <immintrin.h>
+		#define THOR_SIMD_AVX2
+	#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#include <emmintrin.h>
+		#define THOR_SIMD_SSE2
+	#elif defined(__ARM_NEON) || defined(_M_ARM64)
+		#include <arm_neon.h>
+		#define THOR_SIMD_NEON
+	#endif
+#endif
+
+#if defined(THOR_SIMD_AVX2) || defined(THOR_SIMD_SSE2) || defined(THOR_SIMD_NEON)
+	#define THOR_SIMD
+#endif
+
+#if defined(THOR_COMPILER_MSVC)
+	#include <intrin.h>
+#endif
+
+namespace Thor {
+
+#if defined(THOR_SIMD)
+
+// Thin wrapper around a vector register of bytes. Comparisons produce a lane of
+// all ones (0xff) for true and all zeros for false. The mask() function packs
+// those lanes into an integer with SCALE bits per lane so that the index of the
+// first set lane is count_trailing_zeros(mask()) / SCALE.
+struct Bytes {
+#if defined(THOR_SIMD_AVX2)
+	static inline constexpr const Ulen WIDTH = 32;
+	static inline constexpr const Ulen SCALE = 1;
+	THOR_FORCEINLINE static Bytes load(const void* data) {
+		return { _mm256_loadu_si256(static_cast<const __m256i*>(data)) };
+	}
+	THOR_FORCEINLINE static Bytes splat(Uint8 value) {
+		return { _mm256_set1_epi8(static_cast<char>(value)) };
+	}
+	THOR_FORCEINLINE Bytes operator==(Bytes other) const { return { _mm256_cmpeq_epi8(v_, other.v_) }; }
+	THOR_FORCEINLINE Bytes operator|(Bytes other) const { return { _mm256_or_si256(v_, other.v_) }; }
+	THOR_FORCEINLINE Bytes operator&(Bytes other) const { return { _mm256_and_si256(v_, other.v_) }; }
+	THOR_FORCEINLINE Bytes operator-(Bytes other) const { return { _mm256_sub_epi8(v_, other.v_) }; }
+	THOR_FORCEINLINE Bytes operator~() const { return { _mm256_xor_si256(v_, _mm256_set1_epi8(-1)) }; }
+	// Unsigned lane-wise this <= other.
+	THOR_FORCEINLINE Bytes operator<=(Bytes other) const {
+		return { _mm256_cmpeq_epi8(_mm256_min_epu8(v_, other.v_), v_) };
+	}
+	THOR_FORCEINLINE Uint64 mask() const {
+		return static_cast<Uint32>(_mm256_movemask_epi8(v_));
+	}
+	__m256i v_;
+#elif defined(THOR_SIMD_SSE2)
+	static inline constexpr const Ulen WIDTH = 16;
+	static inline constexpr const Ulen SCALE = 1;
+	THOR_FORCEINLINE static Bytes load(const void* data) {
+		return { _mm_loadu_si128(static_cast<const __m128i*>(data)) };
+	}
+	THOR_FORCEINLINE static Bytes splat(Uint8 value) {
+		return { _mm_set1_epi8(static_cast<char>(value)) };
+	}
+	THOR_FORCEINLINE Bytes operator==(Bytes other) const { return { _mm_cmpeq_epi8(v_, other.v_) }; }
+	THOR_FORCEINLINE Bytes operator|(Bytes other) const { return { _mm_or_si128(v_, other.v_) }; }
+	THOR_FORCEINLINE Bytes operator&(Bytes other) const { return { _mm_and_si128(v_, other.v_) }; }
+	THOR_FORCEINLINE Bytes operator-(Bytes other) const { return { _mm_sub_epi8(v_, other.v_) }; }
+	THOR_FORCEINLINE Bytes operator~() const { return { _mm_xor_si128(v_, _mm_set1_epi8(-1)) }; }
+	// Unsigned lane-wise this <= other.
+	THOR_FORCEINLINE Bytes operator<=(Bytes other) const {
+		return { _mm_cmpeq_epi8(_mm_min_epu8(v_, other.v_), v_) };
+	}
+	THOR_FORCEINLINE Uint64 mask() const {
+		return static_cast<Uint32>(_mm_movemask_epi8(v_));
+	}
+	__m128i v_;
+#elif defined(THOR_SIMD_NEON)
+	static inline constexpr const Ulen WIDTH = 16;
+	static inline constexpr const Ulen SCALE = 4;
+	THOR_FORCEINLINE static Bytes load(const void* data) {
+		return { vld1q_u8(static_cast<const Uint8*>(data)) };
+	}
+	THOR_FORCEINLINE static Bytes splat(Uint8 value) {
+		return { vdupq_n_u8(value) };
+	}
+	THOR_FORCEINLINE Bytes operator==(Bytes other) const { return { vceqq_u8(v_, other.v_) }; }
+	THOR_FORCEINLINE Bytes operator|(Bytes other) const { return { vorrq_u8(v_, other.v_) }; }
+	THOR_FORCEINLINE Bytes operator&(Bytes other) const { return { vandq_u8(v_, other.v_) }; }
+	THOR_FORCEINLINE Bytes operator-(Bytes other) const { return { vsubq_u8(v_, other.v_) }; }
+	THOR_FORCEINLINE Bytes operator~() const { return { vmvnq_u8(v_) }; }
+	// Unsigned lane-wise this <= other.
+	THOR_FORCEINLINE Bytes operator<=(Bytes other) const { return { vcleq_u8(v_, other.v_) }; }
+	// There is no movemask on NEON. Narrowing each 16-bit pair by four bits gives
+	// a 64-bit value with a nibble per lane which is just as good for finding the
+	// first set lane.
+	THOR_FORCEINLINE Uint64 mask() const {
+		const auto narrow = vshrn_n_u16(vreinterpretq_u16_u8(v_), 4);
+		return vget_lane_u64(vreinterpret_u64_u8(narrow), 0);
+	}
+	uint8x16_t v_;
+#endif
+	// Lane-wise lo <= this <= hi
+	THOR_FORCEINLINE Bytes in(Uint8 lo, Uint8 hi) const {
+		return (*this - splat(lo)) <= splat(hi - lo);
+	}
+};
+
+#endif // THOR_SIMD
+
+#if defined(THOR_COMPILER_MSVC)
+	THOR_FORCEINLINE Uint32 simd_count_trailing_zeros(Uint64 value) {
+		unsigned long trailing_zero = 0;
+		if (_BitScanForward64(&trailing_zero, value)) {
+			return trailing_zero;
+		}
+		return 64;
+	}
+	THOR_FORCEINLINE Uint32 simd_count_ones(Uint64 value) {
+		return Uint32(__popcnt64(value));
+	}
+#else
+	THOR_FORCEINLINE Uint32 simd_count_trailing_zeros(Uint64 value) {
+		return __builtin_ctzll(value);
+	}
+	THOR_FORCEINLINE Uint32 simd_count_ones(Uint64 value) {
+		return __builtin_popcountll(value);
+	}
+#endif
+
+// Returns the offset of the first byte in [data] at or after [offset] for which
+// C::stop is true, or [length] when there is no such byte. The class [C] must
+// provide a scalar and vector form of the same predicate:
+//
+//	static Bool stop(Uint8 ch);
+//	static Bytes stop(Bytes v); // Only when THOR_SIMD is defined
+//
+// The vector loop only ever loads full vectors that lie entirely within the
+// [length] bytes of [data], the remainder is handled a byte at a time, so there
+// is no need for padding at the end of the input.
+template<typename C>
+THOR_FORCEINLINE Ulen simd_scan(const char* data, Ulen offset, Ulen length) {
+#if defined(THOR_SIMD)
+	while (offset + Bytes::WIDTH <= length) {
+		if (const auto mask = C::stop(Bytes::load(data + offset)).mask()) {
+			return offset + simd_count_trailing_zeros(mask) / Bytes::SCALE;
+		}
+		offset += Bytes::WIDTH;
+	}
+#endif
+	while (offset < length && !C::stop(static_cast<Uint8>(data[offset]))) {
+		offset++;
+	}
+	return offset;
+}
+
+// Returns the number of bytes in [data] for which C::stop is true.
+template<typename C>
+THOR_FORCEINLINE Ulen simd_count(const char* data, Ulen length) {
+	Ulen count = 0;
+	Ulen offset = 0;
+#if defined(THOR_SIMD)
+	for (; offset + Bytes::WIDTH <= length; offset += Bytes::WIDTH) {
+		count += simd_count_ones(C::stop(Bytes::load(data + offset)).mask()) / Bytes::SCALE;
+	}
+#endif
+	for (; offset < length; offset++) {
+		if (C::stop(static_cast<Uint8>(data[offset]))) {
+			count++;
+		}
+	}
+	return count;
+}
+
+// Calls [fn] with the offset of each byte in [data] for which C::stop is true,
+// in order. Stops early and returns false as soon as [fn] returns false.
+template<typename C, typename F>
+THOR_FORCEINLINE Bool simd_each(const char* data, Ulen length, F&& fn) {
+	Ulen offset = 0;
+#if defined(THOR_SIMD)
+	static constexpr const Uint64 LANE = (1_u64 << Bytes::SCALE) - 1;
+	for (; offset + Bytes::WIDTH <= length; offset += Bytes::WIDTH) {
+		for (auto mask = C::stop(Bytes::load(data + offset)).mask(); mask; /**/) {
+			const auto lane = simd_count_trailing_zeros(mask) / Bytes::SCALE;
+			if (!fn(offset + lane)) {
+				return false;
+			}
+			mask &= ~(LANE << (lane * Bytes::SCALE));
+		}
+	}
+#endif
+	for (; offset < length; offset++) {
+		if (C::stop(static_cast<Uint8>(data[offset])) && !fn(offset)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace Thor
+
+#endif // THOR_SIMD_H
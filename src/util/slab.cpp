@@ -3,6 +3,10 @@
 
 namespace Thor {
 
+static constexpr Bool is_pow2(Uint64 value) {
+	return value != 0 && (value & (value - 1)) == 0;
+}
+
 struct SlabHeader {
 	Uint8  magic[4]; // slab
 	Uint32 version;
@@ -24,7 +28,7 @@ Maybe<Slab> Slab::load(Allocator& allocator, Stream& stream) {
 	if (Slice<const Uint8>{header.magic} != Slice{"slab"}.cast<const Uint8>()) {
 		return {};
 	}
-	if (header.version != 1) {
+	if (header.version != 1 || !is_pow2(header.capacity)) {
 		return {};
 	}
 	ScratchAllocator<1024> scratch{allocator};
@@ -95,6 +99,104 @@ Bool Slab::save(Stream& stream) const {
 	return true;
 }
 
+// The capacity of each cache as Pool rounds it.
+static constexpr Ulen cache_capacity(Ulen capacity) {
+	return (capacity + 63) / 64 * 64;
+}
+
+Ulen Slab::used_words() const {
+	return caches_.length() * (cache_capacity(capacity_) / 64);
+}
+
+Ulen Slab::data_bytes() const {
+	const auto n_caches = caches_.length();
+	if (n_caches == 0) {
+		return 0;
+	}
+	const auto& last = caches_.last();
+	const auto extent = last ? last->extent() : 0;
+	return ((n_caches - 1) * cache_capacity(capacity_) + extent) * size_;
+}
+
+Bool Slab::save_used(Stream& stream) const {
+	const auto n_words = cache_capacity(capacity_) / 64;
+	for (const auto& cache : caches_) {
+		if (cache) {
+			if (!stream.write(cache->used().cast<const Uint8>())) {
+				return false;
+			}
+		} else if (!stream.zero(n_words * sizeof(Uint64))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Bool Slab::save_data(Stream& stream) const {
+	const auto n_bytes = cache_capacity(capacity_) * size_;
+	const auto n_caches = caches_.length();
+	for (Ulen i = 0; i < n_caches; i++) {
+		const auto& cache = caches_[i];
+		auto bytes = n_bytes;
+		if (i == n_caches - 1) {
+			bytes = cache ? cache->extent() * size_ : 0;
+		}
+		if (cache) {
+			if (!stream.write(cache->data().truncate(bytes))) {
+				return false;
+			}
+		} else if (!stream.zero(bytes)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Maybe<Slab> Slab::view(Allocator& allocator, Ulen size, Ulen capacity, Slice<const Uint64> used, Slice<const Uint8> data) {
+	const auto n_capacity = cache_capacity(capacity);
+	const auto n_words = n_capacity / 64;
+	if (size == 0 || !is_pow2(capacity) || used.length() % n_words != 0 || data.length() % size != 0) {
+		return {};
+	}
+	const auto n_caches = used.length() / n_words;
+	const auto n_nodes = data.length() / size;
+	if (n_nodes > n_caches * n_capacity) {
+		return {};
+	}
+	Array<Maybe<Pool>> caches{allocator};
+	if (!caches.resize(n_caches)) {
+		return {};
+	}
+	for (Ulen i = 0; i < n_caches; i++) {
+		const auto bits = used.slice(i * n_words).truncate(n_words);
+		const auto base = i * n_capacity;
+		auto pool = Pool::view(allocator, size, n_capacity, data.data() + base * size, bits);
+		if (pool.is_empty()) {
+			// Written as an empty cache since it did not exist.
+			continue;
+		}
+		if (base + pool.extent() > n_nodes) {
+			return {};
+		}
+		caches[i] = move(pool);
+	}
+	return Slab {
+		move(caches),
+		size,
+		capacity
+	};
+}
+
+Bool Slab::contains(SlabRef slab_ref) const {
+	const auto cache_idx = slab_ref.index >> shift_;
+	const auto cache_ref = slab_ref.index & (capacity_ - 1);
+	if (cache_idx >= caches_.length() || !caches_[cache_idx]) {
+		return false;
+	}
+	const auto used = caches_[cache_idx]->used();
+	return (used[cache_ref / 64] & (1_u64 << (cache_ref % 64))) != 0;
+}
+
 Maybe<SlabRef> Slab::allocate() {
 	const auto n_caches = caches_.length();
 	for (Ulen i = n_caches - 1; i < n_caches; i--) {
@@ -123,8 +225,8 @@ Maybe<SlabRef> Slab::allocate() {
 }
 
 void Slab::deallocate(SlabRef slab_ref) {
-	const auto cache_idx = Uint32(slab_ref.index / capacity_);
-	const auto cache_ref = Uint32(slab_ref.index % capacity_);
+	const auto cache_idx = Uint32(slab_ref.index >> shift_);
+	const auto cache_ref = Uint32(slab_ref.index & (capacity_ - 1));
 	auto* cache = &caches_[cache_idx];
 	(*cache)->deallocate(PoolRef { cache_ref });
 	while (!caches_.is_empty() && (*cache)->is_empty()) {
@@ -133,6 +235,9 @@ void Slab::deallocate(SlabRef slab_ref) {
 			break;
 		}
 		caches_.pop_back();
+		if (caches_.is_empty()) {
+			break;
+		}
 		cache = &caches_.last();
 		if (!cache->is_valid()) {
 			break;
@@ -19,36 +19,82 @@ struct SlabRef {
 // like a key.
 struct Stream;
 struct Slab {
+	// The [capacity] of each cache has to be a power of two.
 	constexpr Slab(Allocator& allocator, Ulen size, Ulen capacity)
 		: caches_{allocator}
 		, size_{size}
 		, capacity_{capacity}
+		, shift_{log2(capacity)}
 	{
 	}
 	static Maybe<Slab> load(Allocator& allocator, Stream& stream);
 	Bool save(Stream& stream) const;
+
+	// The flat form of a slab is the used bitset of every cache one after the
+	// other, used_words() of them, and separately the objects of every cache one
+	// after the other, data_bytes() of them. The last cache is only written as far
+	// as its extent and a cache which does not exist is written as an empty one.
+	[[nodiscard]] Ulen used_words() const;
+	[[nodiscard]] Ulen data_bytes() const;
+	Bool save_used(Stream& stream) const;
+	Bool save_data(Stream& stream) const;
+
+	// A read-only slab over the flat form in [used] and [data] which belong to
+	// someone else, e.g a mapped file. Returns nothing when they do not fit the
+	// geometry or an object in use is outside of [data].
+	static Maybe<Slab> view(Allocator& allocator, Ulen size, Ulen capacity, Slice<const Uint64> used, Slice<const Uint8> data);
+
+	[[nodiscard]] THOR_FORCEINLINE constexpr Ulen size() const { return size_; }
+	[[nodiscard]] THOR_FORCEINLINE constexpr Ulen capacity() const { return capacity_; }
+
+	// Check that [slab_ref] is an object in use.
+	[[nodiscard]] Bool contains(SlabRef slab_ref) const;
 	Maybe<SlabRef> allocate();
 	void deallocate(SlabRef slab_ref);
 	THOR_FORCEINLINE constexpr Uint8* operator[](SlabRef slab_ref) {
-		const auto cache_idx = Uint32(slab_ref.index / capacity_);
-		const auto cache_ref = Uint32(slab_ref.index % capacity_);
+		const auto cache_idx = Uint32(slab_ref.index >> shift_);
+		const auto cache_ref = Uint32(slab_ref.index & (capacity_ - 1));
 		return (*caches_[cache_idx])[PoolRef { cache_ref }];
 	}
 	THOR_FORCEINLINE constexpr const Uint8* operator[](SlabRef slab_ref) const {
-		const auto cache_idx = Uint32(slab_ref.index / capacity_);
-		const auto cache_ref = Uint32(slab_ref.index % capacity_);
+		const auto cache_idx = Uint32(slab_ref.index >> shift_);
+		const auto cache_ref = Uint32(slab_ref.index & (capacity_ - 1));
 		return (*caches_[cache_idx])[PoolRef { cache_ref }];
 	}
+
+	// The same as operator[] when the size of the objects and the capacity of the
+	// slab are known at compile-time, [SIZE] and [CAPACITY] have to be size() and
+	// capacity(). The address is then a shift, a mask and a multiply by a constant
+	// with nothing to load but the cache.
+	template<Ulen SIZE, Ulen CAPACITY>
+	THOR_FORCEINLINE constexpr Uint8* at(SlabRef slab_ref) {
+		static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Not a power of two");
+		return caches_[slab_ref.index / CAPACITY]->data_ + (slab_ref.index % CAPACITY) * SIZE;
+	}
+	template<Ulen SIZE, Ulen CAPACITY>
+	THOR_FORCEINLINE constexpr const Uint8* at(SlabRef slab_ref) const {
+		static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Not a power of two");
+		return caches_[slab_ref.index / CAPACITY]->data_ + (slab_ref.index % CAPACITY) * SIZE;
+	}
 private:
 	Slab(Array<Maybe<Pool>>&& caches, Ulen size, Ulen capacity)
 		: caches_{move(caches)}
 		, size_{size}
 		, capacity_{capacity}
+		, shift_{log2(capacity)}
 	{
 	}
+	static constexpr Uint32 log2(Ulen capacity) {
+		Uint32 shift = 0;
+		while ((1_ulen << shift) < capacity) {
+			shift++;
+		}
+		return shift;
+	}
 	Array<Maybe<Pool>> caches_;
 	Ulen               size_;
-	Ulen               capacity_;
+	Ulen               capacity_; // Always a power of two
+	Uint32             shift_;    // log2(capacity_)
 };
 
 } // namespace Thor
@@ -2,6 +2,18 @@
 
 namespace Thor {
 
+Bool Stream::zero(Uint64 length) {
+	static constexpr const Uint8 ZEROS[4096] = {};
+	while (length) {
+		const auto n = length < sizeof ZEROS ? length : sizeof ZEROS;
+		if (!write(Slice{ZEROS, Ulen(n)})) {
+			return false;
+		}
+		length -= n;
+	}
+	return true;
+}
+
 Maybe<FileStream> FileStream::open(System& sys, StringView name, File::Access access) {
 	auto file = File::open(sys, name, access);
 	if (!file) {
@@ -9,6 +9,8 @@ struct Stream {
 	virtual Bool write(Slice<const Uint8> data) = 0;
 	virtual Bool read(Slice<Uint8> data) = 0;
 	virtual Uint64 tell() const = 0;
+	// Write [length] zero bytes.
+	Bool zero(Uint64 length);
 };
 
 struct FileStream : Stream {
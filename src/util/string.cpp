@@ -146,12 +146,13 @@ Bool StringTable::grow(Ulen additional) {
 	if (!data) {
 		return false;
 	}
+	// Not every string is in the map when the table was loaded.
+	if (length_) {
+		memcpy(data, data_, length_);
+	}
 	for (const auto kv : map_) {
-		auto k = kv.k;
 		auto v = kv.v;
-		auto beg = data + v.offset;
-		memcpy(beg, k.data(), k.length());
-		map.insert(StringView { beg, v.length }, v);
+		map.insert(StringView { data + v.offset, v.length }, v);
 	}
 	drop();
 	map_ = move(map);
@@ -176,6 +177,13 @@ Maybe<StringTable> StringTable::load(Allocator& allocator, Stream& stream) {
 	return StringTable { allocator, data, length };
 }
 
+StringTable StringTable::view(Allocator& allocator, Slice<const char> data) {
+	StringTable table{allocator};
+	table.data_ = const_cast<char*>(data.data());
+	table.length_ = Uint32(data.length());
+	return table;
+}
+
 Bool StringTable::save(Stream& stream) const {
 	return stream.write(Slice<const Uint32>{&length_, 1}.cast<const Uint8>())
 	    && stream.write(Slice<const char>{data_, length_}.cast<const Uint8>());
@@ -8,6 +8,13 @@ namespace Thor {
 
 using StringView = Slice<const char>;
 
+inline Bool ends_with(StringView str, StringView suffix) {
+	if (str.length() < suffix.length()) {
+		return false;
+	}
+	return str.slice(str.length() - suffix.length()) == suffix;
+}
+
 // Utility for building a string incrementally.
 struct StringBuilder {
 	constexpr StringBuilder(Allocator& allocator)
@@ -72,6 +79,10 @@ struct StringTable {
 	static Maybe<StringTable> load(Allocator& allocator, Stream& stream);
 	Bool save(Stream& stream) const;
 
+	// A table over [data] which belongs to someone else, e.g a mapped file. It's
+	// copied the first time a string is inserted.
+	static StringTable view(Allocator& allocator, Slice<const char> data);
+
 	StringTable(StringTable&& other);
 
 	StringTable& operator=(StringTable&& other) {
@@ -105,7 +116,10 @@ private:
 	}
 
 	StringTable* drop() {
-		allocator().deallocate(data_, capacity_);
+		// A view has no capacity of its own.
+		if (capacity_) {
+			allocator().deallocate(data_, capacity_);
+		}
 		return this;
 	}
 
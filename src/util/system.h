@@ -27,9 +27,24 @@ struct Filesystem {
 	Uint64 (*write_file)(System& sys, File* file, Uint64 offset, Slice<const Uint8> data);
 	Uint64 (*tell_file)(System& sys, File* file);
 
+	// Map the whole of [file] read-only into memory. Returns an empty slice when
+	// the file cannot be mapped (e.g it's empty or not a regular file) in which
+	// case read_file must be used instead. The mapping remains valid after the
+	// file is closed and must be released with unmap_file.
+	Slice<const Uint8> (*map_file)(System& sys, File* file);
+	void (*unmap_file)(System& sys, Slice<const Uint8> data);
+
+	// Replace [dst] with [src] in one step, anyone opening [dst] gets either the
+	// old file or all of the new one.
+	Bool (*rename_file)(System& sys, StringView src, StringView dst);
+	Bool (*remove_file)(System& sys, StringView name);
+
 	Directory* (*open_dir)(System& sys, StringView name);
 	void (*close_dir)(System& sys, Directory*);
 	Bool (*read_dir)(System& sys, Directory*, Item& item);
+	// Make the directory [name]. Returns true when it exists after, including
+	// when it already did.
+	Bool (*make_dir)(System& sys, StringView name);
 };
 
 struct Heap {
@@ -44,6 +59,8 @@ struct Console {
 struct Process {
 	// NOTE: assert should not return
 	void (*assert)(System& sys, StringView msg, StringView file, Sint32 line);
+	// No two processes running at the same time have the same ID.
+	Uint64 (*id)(System& sys);
 };
 
 struct Linker {
@@ -73,6 +90,9 @@ struct Scheduler {
 	void (*cond_wait)(System& sys, Cond* cond, Mutex* mutex);
 
 	void (*yield)(System& sys);
+
+	// The number of hardware threads available to run threads on, at least one.
+	Ulen (*thread_count)(System& sys);
 };
 
 struct Chrono {
@@ -1,47 +1,314 @@
 #include "util/unicode.h"
+#include "util/simd.h"
 
 namespace Thor {
 
-Bool Rune::is_char() const {
+// Each range of code points is packed into 32-bits as the first code point in
+// the upper 21-bits and the length, less one, in the lower 11-bits. Ranges which
+// are longer than that are split. The tables are sorted so they can be searched
+// by the first code point.
+static constexpr Uint32 range(Uint32 lo, Uint32 hi) {
+	return lo << 11 | (hi - lo);
+}
+
+// The non-ASCII code points in the Unicode 14.0 general categories Lu, Ll, Lt,
+// Lm and Lo (letters) and Nd (decimal digits).
+static constexpr const Uint32 LETTERS[] = {
+	range(0x000aa, 0x000aa), range(0x000b5, 0x000b5), range(0x000ba, 0x000ba), range(0x000c0, 0x000d6),
+	range(0x000d8, 0x000f6), range(0x000f8, 0x002c1), range(0x002c6, 0x002d1), range(0x002e0, 0x002e4),
+	range(0x002ec, 0x002ec), range(0x002ee, 0x002ee), range(0x00370, 0x00374), range(0x00376, 0x00377),
+	range(0x0037a, 0x0037d), range(0x0037f, 0x0037f), range(0x00386, 0x00386), range(0x00388, 0x0038a),
+	range(0x0038c, 0x0038c), range(0x0038e, 0x003a1), range(0x003a3, 0x003f5), range(0x003f7, 0x00481),
+	range(0x0048a, 0x0052f), range(0x00531, 0x00556), range(0x00559, 0x00559), range(0x00560, 0x00588),
+	range(0x005d0, 0x005ea), range(0x005ef, 0x005f2), range(0x00620, 0x0064a), range(0x0066e, 0x0066f),
+	range(0x00671, 0x006d3), range(0x006d5, 0x006d5), range(0x006e5, 0x006e6), range(0x006ee, 0x006ef),
+	range(0x006fa, 0x006fc), range(0x006ff, 0x006ff), range(0x00710, 0x00710), range(0x00712, 0x0072f),
+	range(0x0074d, 0x007a5), range(0x007b1, 0x007b1), range(0x007ca, 0x007ea), range(0x007f4, 0x007f5),
+	range(0x007fa, 0x007fa), range(0x00800, 0x00815), range(0x0081a, 0x0081a), range(0x00824, 0x00824),
+	range(0x00828, 0x00828), range(0x00840, 0x00858), range(0x00860, 0x0086a), range(0x00870, 0x00887),
+	range(0x00889, 0x0088e), range(0x008a0, 0x008c9), range(0x00904, 0x00939), range(0x0093d, 0x0093d),
+	range(0x00950, 0x00950), range(0x00958, 0x00961), range(0x00971, 0x00980), range(0x00985, 0x0098c),
+	range(0x0098f, 0x00990), range(0x00993, 0x009a8), range(0x009aa, 0x009b0), range(0x009b2, 0x009b2),
+	range(0x009b6, 0x009b9), range(0x009bd, 0x009bd), range(0x009ce, 0x009ce), range(0x009dc, 0x009dd),
+	range(0x009df, 0x009e1), range(0x009f0, 0x009f1), range(0x009fc, 0x009fc), range(0x00a05, 0x00a0a),
+	range(0x00a0f, 0x00a10), range(0x00a13, 0x00a28), range(0x00a2a, 0x00a30), range(0x00a32, 0x00a33),
+	range(0x00a35, 0x00a36), range(0x00a38, 0x00a39), range(0x00a59, 0x00a5c), range(0x00a5e, 0x00a5e),
+	range(0x00a72, 0x00a74), range(0x00a85, 0x00a8d), range(0x00a8f, 0x00a91), range(0x00a93, 0x00aa8),
+	range(0x00aaa, 0x00ab0), range(0x00ab2, 0x00ab3), range(0x00ab5, 0x00ab9), range(0x00abd, 0x00abd),
+	range(0x00ad0, 0x00ad0), range(0x00ae0, 0x00ae1), range(0x00af9, 0x00af9), range(0x00b05, 0x00b0c),
+	range(0x00b0f, 0x00b10), range(0x00b13, 0x00b28), range(0x00b2a, 0x00b30), range(0x00b32, 0x00b33),
+	range(0x00b35, 0x00b39), range(0x00b3d, 0x00b3d), range(0x00b5c, 0x00b5d), range(0x00b5f, 0x00b61),
+	range(0x00b71, 0x00b71), range(0x00b83, 0x00b83), range(0x00b85, 0x00b8a), range(0x00b8e, 0x00b90),
+	range(0x00b92, 0x00b95), range(0x00b99, 0x00b9a), range(0x00b9c, 0x00b9c), range(0x00b9e, 0x00b9f),
+	range(0x00ba3, 0x00ba4), range(0x00ba8, 0x00baa), range(0x00bae, 0x00bb9), range(0x00bd0, 0x00bd0),
+	range(0x00c05, 0x00c0c), range(0x00c0e, 0x00c10), range(0x00c12, 0x00c28), range(0x00c2a, 0x00c39),
+	range(0x00c3d, 0x00c3d), range(0x00c58, 0x00c5a), range(0x00c5d, 0x00c5d), range(0x00c60, 0x00c61),
+	range(0x00c80, 0x00c80), range(0x00c85, 0x00c8c), range(0x00c8e, 0x00c90), range(0x00c92, 0x00ca8),
+	range(0x00caa, 0x00cb3), range(0x00cb5, 0x00cb9), range(0x00cbd, 0x00cbd), range(0x00cdd, 0x00cde),
+	range(0x00ce0, 0x00ce1), range(0x00cf1, 0x00cf2), range(0x00d04, 0x00d0c), range(0x00d0e, 0x00d10),
+	range(0x00d12, 0x00d3a), range(0x00d3d, 0x00d3d), range(0x00d4e, 0x00d4e), range(0x00d54, 0x00d56),
+	range(0x00d5f, 0x00d61), range(0x00d7a, 0x00d7f), range(0x00d85, 0x00d96), range(0x00d9a, 0x00db1),
+	range(0x00db3, 0x00dbb), range(0x00dbd, 0x00dbd), range(0x00dc0, 0x00dc6), range(0x00e01, 0x00e30),
+	range(0x00e32, 0x00e33), range(0x00e40, 0x00e46), range(0x00e81, 0x00e82), range(0x00e84, 0x00e84),
+	range(0x00e86, 0x00e8a), range(0x00e8c, 0x00ea3), range(0x00ea5, 0x00ea5), range(0x00ea7, 0x00eb0),
+	range(0x00eb2, 0x00eb3), range(0x00ebd, 0x00ebd), range(0x00ec0, 0x00ec4), range(0x00ec6, 0x00ec6),
+	range(0x00edc, 0x00edf), range(0x00f00, 0x00f00), range(0x00f40, 0x00f47), range(0x00f49, 0x00f6c),
+	range(0x00f88, 0x00f8c), range(0x01000, 0x0102a), range(0x0103f, 0x0103f), range(0x01050, 0x01055),
+	range(0x0105a, 0x0105d), range(0x01061, 0x01061), range(0x01065, 0x01066), range(0x0106e, 0x01070),
+	range(0x01075, 0x01081), range(0x0108e, 0x0108e), range(0x010a0, 0x010c5), range(0x010c7, 0x010c7),
+	range(0x010cd, 0x010cd), range(0x010d0, 0x010fa), range(0x010fc, 0x01248), range(0x0124a, 0x0124d),
+	range(0x01250, 0x01256), range(0x01258, 0x01258), range(0x0125a, 0x0125d), range(0x01260, 0x01288),
+	range(0x0128a, 0x0128d), range(0x01290, 0x012b0), range(0x012b2, 0x012b5), range(0x012b8, 0x012be),
+	range(0x012c0, 0x012c0), range(0x012c2, 0x012c5), range(0x012c8, 0x012d6), range(0x012d8, 0x01310),
+	range(0x01312, 0x01315), range(0x01318, 0x0135a), range(0x01380, 0x0138f), range(0x013a0, 0x013f5),
+	range(0x013f8, 0x013fd), range(0x01401, 0x0166c), range(0x0166f, 0x0167f), range(0x01681, 0x0169a),
+	range(0x016a0, 0x016ea), range(0x016f1, 0x016f8), range(0x01700, 0x01711), range(0x0171f, 0x01731),
+	range(0x01740, 0x01751), range(0x01760, 0x0176c), range(0x0176e, 0x01770), range(0x01780, 0x017b3),
+	range(0x017d7, 0x017d7), range(0x017dc, 0x017dc), range(0x01820, 0x01878), range(0x01880, 0x01884),
+	range(0x01887, 0x018a8), range(0x018aa, 0x018aa), range(0x018b0, 0x018f5), range(0x01900, 0x0191e),
+	range(0x01950, 0x0196d), range(0x01970, 0x01974), range(0x01980, 0x019ab), range(0x019b0, 0x019c9),
+	range(0x01a00, 0x01a16), range(0x01a20, 0x01a54), range(0x01aa7, 0x01aa7), range(0x01b05, 0x01b33),
+	range(0x01b45, 0x01b4c), range(0x01b83, 0x01ba0), range(0x01bae, 0x01baf), range(0x01bba, 0x01be5),
+	range(0x01c00, 0x01c23), range(0x01c4d, 0x01c4f), range(0x01c5a, 0x01c7d), range(0x01c80, 0x01c88),
+	range(0x01c90, 0x01cba), range(0x01cbd, 0x01cbf), range(0x01ce9, 0x01cec), range(0x01cee, 0x01cf3),
+	range(0x01cf5, 0x01cf6), range(0x01cfa, 0x01cfa), range(0x01d00, 0x01dbf), range(0x01e00, 0x01f15),
+	range(0x01f18, 0x01f1d), range(0x01f20, 0x01f45), range(0x01f48, 0x01f4d), range(0x01f50, 0x01f57),
+	range(0x01f59, 0x01f59), range(0x01f5b, 0x01f5b), range(0x01f5d, 0x01f5d), range(0x01f5f, 0x01f7d),
+	range(0x01f80, 0x01fb4), range(0x01fb6, 0x01fbc), range(0x01fbe, 0x01fbe), range(0x01fc2, 0x01fc4),
+	range(0x01fc6, 0x01fcc), range(0x01fd0, 0x01fd3), range(0x01fd6, 0x01fdb), range(0x01fe0, 0x01fec),
+	range(0x01ff2, 0x01ff4), range(0x01ff6, 0x01ffc), range(0x02071, 0x02071), range(0x0207f, 0x0207f),
+	range(0x02090, 0x0209c), range(0x02102, 0x02102), range(0x02107, 0x02107), range(0x0210a, 0x02113),
+	range(0x02115, 0x02115), range(0x02119, 0x0211d), range(0x02124, 0x02124), range(0x02126, 0x02126),
+	range(0x02128, 0x02128), range(0x0212a, 0x0212d), range(0x0212f, 0x02139), range(0x0213c, 0x0213f),
+	range(0x02145, 0x02149), range(0x0214e, 0x0214e), range(0x02183, 0x02184), range(0x02c00, 0x02ce4),
+	range(0x02ceb, 0x02cee), range(0x02cf2, 0x02cf3), range(0x02d00, 0x02d25), range(0x02d27, 0x02d27),
+	range(0x02d2d, 0x02d2d), range(0x02d30, 0x02d67), range(0x02d6f, 0x02d6f), range(0x02d80, 0x02d96),
+	range(0x02da0, 0x02da6), range(0x02da8, 0x02dae), range(0x02db0, 0x02db6), range(0x02db8, 0x02dbe),
+	range(0x02dc0, 0x02dc6), range(0x02dc8, 0x02dce), range(0x02dd0, 0x02dd6), range(0x02dd8, 0x02dde),
+	range(0x02e2f, 0x02e2f), range(0x03005, 0x03006), range(0x03031, 0x03035), range(0x0303b, 0x0303c),
+	range(0x03041, 0x03096), range(0x0309d, 0x0309f), range(0x030a1, 0x030fa), range(0x030fc, 0x030ff),
+	range(0x03105, 0x0312f), range(0x03131, 0x0318e), range(0x031a0, 0x031bf), range(0x031f0, 0x031ff),
+	range(0x03400, 0x03bff), range(0x03c00, 0x043ff), range(0x04400, 0x04bff), range(0x04c00, 0x04dbf),
+	range(0x04e00, 0x055ff), range(0x05600, 0x05dff), range(0x05e00, 0x065ff), range(0x06600, 0x06dff),
+	range(0x06e00, 0x075ff), range(0x07600, 0x07dff), range(0x07e00, 0x085ff), range(0x08600, 0x08dff),
+	range(0x08e00, 0x095ff), range(0x09600, 0x09dff), range(0x09e00, 0x0a48c), range(0x0a4d0, 0x0a4fd),
+	range(0x0a500, 0x0a60c), range(0x0a610, 0x0a61f), range(0x0a62a, 0x0a62b), range(0x0a640, 0x0a66e),
+	range(0x0a67f, 0x0a69d), range(0x0a6a0, 0x0a6e5), range(0x0a717, 0x0a71f), range(0x0a722, 0x0a788),
+	range(0x0a78b, 0x0a7ca), range(0x0a7d0, 0x0a7d1), range(0x0a7d3, 0x0a7d3), range(0x0a7d5, 0x0a7d9),
+	range(0x0a7f2, 0x0a801), range(0x0a803, 0x0a805), range(0x0a807, 0x0a80a), range(0x0a80c, 0x0a822),
+	range(0x0a840, 0x0a873), range(0x0a882, 0x0a8b3), range(0x0a8f2, 0x0a8f7), range(0x0a8fb, 0x0a8fb),
+	range(0x0a8fd, 0x0a8fe), range(0x0a90a, 0x0a925), range(0x0a930, 0x0a946), range(0x0a960, 0x0a97c),
+	range(0x0a984, 0x0a9b2), range(0x0a9cf, 0x0a9cf), range(0x0a9e0, 0x0a9e4), range(0x0a9e6, 0x0a9ef),
+	range(0x0a9fa, 0x0a9fe), range(0x0aa00, 0x0aa28), range(0x0aa40, 0x0aa42), range(0x0aa44, 0x0aa4b),
+	range(0x0aa60, 0x0aa76), range(0x0aa7a, 0x0aa7a), range(0x0aa7e, 0x0aaaf), range(0x0aab1, 0x0aab1),
+	range(0x0aab5, 0x0aab6), range(0x0aab9, 0x0aabd), range(0x0aac0, 0x0aac0), range(0x0aac2, 0x0aac2),
+	range(0x0aadb, 0x0aadd), range(0x0aae0, 0x0aaea), range(0x0aaf2, 0x0aaf4), range(0x0ab01, 0x0ab06),
+	range(0x0ab09, 0x0ab0e), range(0x0ab11, 0x0ab16), range(0x0ab20, 0x0ab26), range(0x0ab28, 0x0ab2e),
+	range(0x0ab30, 0x0ab5a), range(0x0ab5c, 0x0ab69), range(0x0ab70, 0x0abe2), range(0x0ac00, 0x0b3ff),
+	range(0x0b400, 0x0bbff), range(0x0bc00, 0x0c3ff), range(0x0c400, 0x0cbff), range(0x0cc00, 0x0d3ff),
+	range(0x0d400, 0x0d7a3), range(0x0d7b0, 0x0d7c6), range(0x0d7cb, 0x0d7fb), range(0x0f900, 0x0fa6d),
+	range(0x0fa70, 0x0fad9), range(0x0fb00, 0x0fb06), range(0x0fb13, 0x0fb17), range(0x0fb1d, 0x0fb1d),
+	range(0x0fb1f, 0x0fb28), range(0x0fb2a, 0x0fb36), range(0x0fb38, 0x0fb3c), range(0x0fb3e, 0x0fb3e),
+	range(0x0fb40, 0x0fb41), range(0x0fb43, 0x0fb44), range(0x0fb46, 0x0fbb1), range(0x0fbd3, 0x0fd3d),
+	range(0x0fd50, 0x0fd8f), range(0x0fd92, 0x0fdc7), range(0x0fdf0, 0x0fdfb), range(0x0fe70, 0x0fe74),
+	range(0x0fe76, 0x0fefc), range(0x0ff21, 0x0ff3a), range(0x0ff41, 0x0ff5a), range(0x0ff66, 0x0ffbe),
+	range(0x0ffc2, 0x0ffc7), range(0x0ffca, 0x0ffcf), range(0x0ffd2, 0x0ffd7), range(0x0ffda, 0x0ffdc),
+	range(0x10000, 0x1000b), range(0x1000d, 0x10026), range(0x10028, 0x1003a), range(0x1003c, 0x1003d),
+	range(0x1003f, 0x1004d), range(0x10050, 0x1005d), range(0x10080, 0x100fa), range(0x10280, 0x1029c),
+	range(0x102a0, 0x102d0), range(0x10300, 0x1031f), range(0x1032d, 0x10340), range(0x10342, 0x10349),
+	range(0x10350, 0x10375), range(0x10380, 0x1039d), range(0x103a0, 0x103c3), range(0x103c8, 0x103cf),
+	range(0x10400, 0x1049d), range(0x104b0, 0x104d3), range(0x104d8, 0x104fb), range(0x10500, 0x10527),
+	range(0x10530, 0x10563), range(0x10570, 0x1057a), range(0x1057c, 0x1058a), range(0x1058c, 0x10592),
+	range(0x10594, 0x10595), range(0x10597, 0x105a1), range(0x105a3, 0x105b1), range(0x105b3, 0x105b9),
+	range(0x105bb, 0x105bc), range(0x10600, 0x10736), range(0x10740, 0x10755), range(0x10760, 0x10767),
+	range(0x10780, 0x10785), range(0x10787, 0x107b0), range(0x107b2, 0x107ba), range(0x10800, 0x10805),
+	range(0x10808, 0x10808), range(0x1080a, 0x10835), range(0x10837, 0x10838), range(0x1083c, 0x1083c),
+	range(0x1083f, 0x10855), range(0x10860, 0x10876), range(0x10880, 0x1089e), range(0x108e0, 0x108f2),
+	range(0x108f4, 0x108f5), range(0x10900, 0x10915), range(0x10920, 0x10939), range(0x10980, 0x109b7),
+	range(0x109be, 0x109bf), range(0x10a00, 0x10a00), range(0x10a10, 0x10a13), range(0x10a15, 0x10a17),
+	range(0x10a19, 0x10a35), range(0x10a60, 0x10a7c), range(0x10a80, 0x10a9c), range(0x10ac0, 0x10ac7),
+	range(0x10ac9, 0x10ae4), range(0x10b00, 0x10b35), range(0x10b40, 0x10b55), range(0x10b60, 0x10b72),
+	range(0x10b80, 0x10b91), range(0x10c00, 0x10c48), range(0x10c80, 0x10cb2), range(0x10cc0, 0x10cf2),
+	range(0x10d00, 0x10d23), range(0x10e80, 0x10ea9), range(0x10eb0, 0x10eb1), range(0x10f00, 0x10f1c),
+	range(0x10f27, 0x10f27), range(0x10f30, 0x10f45), range(0x10f70, 0x10f81), range(0x10fb0, 0x10fc4),
+	range(0x10fe0, 0x10ff6), range(0x11003, 0x11037), range(0x11071, 0x11072), range(0x11075, 0x11075),
+	range(0x11083, 0x110af), range(0x110d0, 0x110e8), range(0x11103, 0x11126), range(0x11144, 0x11144),
+	range(0x11147, 0x11147), range(0x11150, 0x11172), range(0x11176, 0x11176), range(0x11183, 0x111b2),
+	range(0x111c1, 0x111c4), range(0x111da, 0x111da), range(0x111dc, 0x111dc), range(0x11200, 0x11211),
+	range(0x11213, 0x1122b), range(0x11280, 0x11286), range(0x11288, 0x11288), range(0x1128a, 0x1128d),
+	range(0x1128f, 0x1129d), range(0x1129f, 0x112a8), range(0x112b0, 0x112de), range(0x11305, 0x1130c),
+	range(0x1130f, 0x11310), range(0x11313, 0x11328), range(0x1132a, 0x11330), range(0x11332, 0x11333),
+	range(0x11335, 0x11339), range(0x1133d, 0x1133d), range(0x11350, 0x11350), range(0x1135d, 0x11361),
+	range(0x11400, 0x11434), range(0x11447, 0x1144a), range(0x1145f, 0x11461), range(0x11480, 0x114af),
+	range(0x114c4, 0x114c5), range(0x114c7, 0x114c7), range(0x11580, 0x115ae), range(0x115d8, 0x115db),
+	range(0x11600, 0x1162f), range(0x11644, 0x11644), range(0x11680, 0x116aa), range(0x116b8, 0x116b8),
+	range(0x11700, 0x1171a), range(0x11740, 0x11746), range(0x11800, 0x1182b), range(0x118a0, 0x118df),
+	range(0x118ff, 0x11906), range(0x11909, 0x11909), range(0x1190c, 0x11913), range(0x11915, 0x11916),
+	range(0x11918, 0x1192f), range(0x1193f, 0x1193f), range(0x11941, 0x11941), range(0x119a0, 0x119a7),
+	range(0x119aa, 0x119d0), range(0x119e1, 0x119e1), range(0x119e3, 0x119e3), range(0x11a00, 0x11a00),
+	range(0x11a0b, 0x11a32), range(0x11a3a, 0x11a3a), range(0x11a50, 0x11a50), range(0x11a5c, 0x11a89),
+	range(0x11a9d, 0x11a9d), range(0x11ab0, 0x11af8), range(0x11c00, 0x11c08), range(0x11c0a, 0x11c2e),
+	range(0x11c40, 0x11c40), range(0x11c72, 0x11c8f), range(0x11d00, 0x11d06), range(0x11d08, 0x11d09),
+	range(0x11d0b, 0x11d30), range(0x11d46, 0x11d46), range(0x11d60, 0x11d65), range(0x11d67, 0x11d68),
+	range(0x11d6a, 0x11d89), range(0x11d98, 0x11d98), range(0x11ee0, 0x11ef2), range(0x11fb0, 0x11fb0),
+	range(0x12000, 0x12399), range(0x12480, 0x12543), range(0x12f90, 0x12ff0), range(0x13000, 0x1342e),
+	range(0x14400, 0x14646), range(0x16800, 0x16a38), range(0x16a40, 0x16a5e), range(0x16a70, 0x16abe),
+	range(0x16ad0, 0x16aed), range(0x16b00, 0x16b2f), range(0x16b40, 0x16b43), range(0x16b63, 0x16b77),
+	range(0x16b7d, 0x16b8f), range(0x16e40, 0x16e7f), range(0x16f00, 0x16f4a), range(0x16f50, 0x16f50),
+	range(0x16f93, 0x16f9f), range(0x16fe0, 0x16fe1), range(0x16fe3, 0x16fe3), range(0x17000, 0x177ff),
+	range(0x17800, 0x17fff), range(0x18000, 0x187f7), range(0x18800, 0x18cd5), range(0x18d00, 0x18d08),
+	range(0x1aff0, 0x1aff3), range(0x1aff5, 0x1affb), range(0x1affd, 0x1affe), range(0x1b000, 0x1b122),
+	range(0x1b150, 0x1b152), range(0x1b164, 0x1b167), range(0x1b170, 0x1b2fb), range(0x1bc00, 0x1bc6a),
+	range(0x1bc70, 0x1bc7c), range(0x1bc80, 0x1bc88), range(0x1bc90, 0x1bc99), range(0x1d400, 0x1d454),
+	range(0x1d456, 0x1d49c), range(0x1d49e, 0x1d49f), range(0x1d4a2, 0x1d4a2), range(0x1d4a5, 0x1d4a6),
+	range(0x1d4a9, 0x1d4ac), range(0x1d4ae, 0x1d4b9), range(0x1d4bb, 0x1d4bb), range(0x1d4bd, 0x1d4c3),
+	range(0x1d4c5, 0x1d505), range(0x1d507, 0x1d50a), range(0x1d50d, 0x1d514), range(0x1d516, 0x1d51c),
+	range(0x1d51e, 0x1d539), range(0x1d53b, 0x1d53e), range(0x1d540, 0x1d544), range(0x1d546, 0x1d546),
+	range(0x1d54a, 0x1d550), range(0x1d552, 0x1d6a5), range(0x1d6a8, 0x1d6c0), range(0x1d6c2, 0x1d6da),
+	range(0x1d6dc, 0x1d6fa), range(0x1d6fc, 0x1d714), range(0x1d716, 0x1d734), range(0x1d736, 0x1d74e),
+	range(0x1d750, 0x1d76e), range(0x1d770, 0x1d788), range(0x1d78a, 0x1d7a8), range(0x1d7aa, 0x1d7c2),
+	range(0x1d7c4, 0x1d7cb), range(0x1df00, 0x1df1e), range(0x1e100, 0x1e12c), range(0x1e137, 0x1e13d),
+	range(0x1e14e, 0x1e14e), range(0x1e290, 0x1e2ad), range(0x1e2c0, 0x1e2eb), range(0x1e7e0, 0x1e7e6),
+	range(0x1e7e8, 0x1e7eb), range(0x1e7ed, 0x1e7ee), range(0x1e7f0, 0x1e7fe), range(0x1e800, 0x1e8c4),
+	range(0x1e900, 0x1e943), range(0x1e94b, 0x1e94b), range(0x1ee00, 0x1ee03), range(0x1ee05, 0x1ee1f),
+	range(0x1ee21, 0x1ee22), range(0x1ee24, 0x1ee24), range(0x1ee27, 0x1ee27), range(0x1ee29, 0x1ee32),
+	range(0x1ee34, 0x1ee37), range(0x1ee39, 0x1ee39), range(0x1ee3b, 0x1ee3b), range(0x1ee42, 0x1ee42),
+	range(0x1ee47, 0x1ee47), range(0x1ee49, 0x1ee49), range(0x1ee4b, 0x1ee4b), range(0x1ee4d, 0x1ee4f),
+	range(0x1ee51, 0x1ee52), range(0x1ee54, 0x1ee54), range(0x1ee57, 0x1ee57), range(0x1ee59, 0x1ee59),
+	range(0x1ee5b, 0x1ee5b), range(0x1ee5d, 0x1ee5d), range(0x1ee5f, 0x1ee5f), range(0x1ee61, 0x1ee62),
+	range(0x1ee64, 0x1ee64), range(0x1ee67, 0x1ee6a), range(0x1ee6c, 0x1ee72), range(0x1ee74, 0x1ee77),
+	range(0x1ee79, 0x1ee7c), range(0x1ee7e, 0x1ee7e), range(0x1ee80, 0x1ee89), range(0x1ee8b, 0x1ee9b),
+	range(0x1eea1, 0x1eea3), range(0x1eea5, 0x1eea9), range(0x1eeab, 0x1eebb), range(0x20000, 0x207ff),
+	range(0x20800, 0x20fff), range(0x21000, 0x217ff), range(0x21800, 0x21fff), range(0x22000, 0x227ff),
+	range(0x22800, 0x22fff), range(0x23000, 0x237ff), range(0x23800, 0x23fff), range(0x24000, 0x247ff),
+	range(0x24800, 0x24fff), range(0x25000, 0x257ff), range(0x25800, 0x25fff), range(0x26000, 0x267ff),
+	range(0x26800, 0x26fff), range(0x27000, 0x277ff), range(0x27800, 0x27fff), range(0x28000, 0x287ff),
+	range(0x28800, 0x28fff), range(0x29000, 0x297ff), range(0x29800, 0x29fff), range(0x2a000, 0x2a6df),
+	range(0x2a700, 0x2aeff), range(0x2af00, 0x2b6ff), range(0x2b700, 0x2b738), range(0x2b740, 0x2b81d),
+	range(0x2b820, 0x2c01f), range(0x2c020, 0x2c81f), range(0x2c820, 0x2cea1), range(0x2ceb0, 0x2d6af),
+	range(0x2d6b0, 0x2deaf), range(0x2deb0, 0x2e6af), range(0x2e6b0, 0x2ebe0), range(0x2f800, 0x2fa1d),
+	range(0x30000, 0x307ff), range(0x30800, 0x30fff), range(0x31000, 0x3134a),
+};
+
+static constexpr const Uint32 DIGITS[] = {
+	range(0x00660, 0x00669), range(0x006f0, 0x006f9), range(0x007c0, 0x007c9), range(0x00966, 0x0096f),
+	range(0x009e6, 0x009ef), range(0x00a66, 0x00a6f), range(0x00ae6, 0x00aef), range(0x00b66, 0x00b6f),
+	range(0x00be6, 0x00bef), range(0x00c66, 0x00c6f), range(0x00ce6, 0x00cef), range(0x00d66, 0x00d6f),
+	range(0x00de6, 0x00def), range(0x00e50, 0x00e59), range(0x00ed0, 0x00ed9), range(0x00f20, 0x00f29),
+	range(0x01040, 0x01049), range(0x01090, 0x01099), range(0x017e0, 0x017e9), range(0x01810, 0x01819),
+	range(0x01946, 0x0194f), range(0x019d0, 0x019d9), range(0x01a80, 0x01a89), range(0x01a90, 0x01a99),
+	range(0x01b50, 0x01b59), range(0x01bb0, 0x01bb9), range(0x01c40, 0x01c49), range(0x01c50, 0x01c59),
+	range(0x0a620, 0x0a629), range(0x0a8d0, 0x0a8d9), range(0x0a900, 0x0a909), range(0x0a9d0, 0x0a9d9),
+	range(0x0a9f0, 0x0a9f9), range(0x0aa50, 0x0aa59), range(0x0abf0, 0x0abf9), range(0x0ff10, 0x0ff19),
+	range(0x104a0, 0x104a9), range(0x10d30, 0x10d39), range(0x11066, 0x1106f), range(0x110f0, 0x110f9),
+	range(0x11136, 0x1113f), range(0x111d0, 0x111d9), range(0x112f0, 0x112f9), range(0x11450, 0x11459),
+	range(0x114d0, 0x114d9), range(0x11650, 0x11659), range(0x116c0, 0x116c9), range(0x11730, 0x11739),
+	range(0x118e0, 0x118e9), range(0x11950, 0x11959), range(0x11c50, 0x11c59), range(0x11d50, 0x11d59),
+	range(0x11da0, 0x11da9), range(0x16a60, 0x16a69), range(0x16ac0, 0x16ac9), range(0x16b50, 0x16b59),
+	range(0x1d7ce, 0x1d7ff), range(0x1e140, 0x1e149), range(0x1e2f0, 0x1e2f9), range(0x1e950, 0x1e959),
+	range(0x1fbf0, 0x1fbf9),
+};
+
+template<Ulen E>
+static Bool in_table(const Uint32 (&table)[E], Uint32 cp) {
+	// Find the last range which starts at or before [cp].
+	Ulen lo = 0;
+	Ulen hi = E;
+	while (lo < hi) {
+		const auto mid = lo + (hi - lo) / 2;
+		if ((table[mid] >> 11) <= cp) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo == 0) {
+		return false;
+	}
+	const auto entry = table[lo - 1];
+	return cp - (entry >> 11) <= (entry & 0x7ff);
+}
+
+Bool Rune::is_unicode_char() const {
 	if (v_ < 0x80) {
 		if (v_ == '_') {
 			return true;
 		}
 		return ((v_ | 0x20) - 0x61) < 26;
 	}
-	// TODO(dweiler): LU, LL, LT, LM, LO => true
-	return false;
+	return in_table(LETTERS, v_);
 }
 
-Bool Rune::is_digit() const {
+Bool Rune::is_unicode_digit() const {
 	if (v_ < 0x80) {
 		return (v_ - '0') < 10;
 	}
-	// TODO(dweiler): ND => true
-	return false;
+	return in_table(DIGITS, v_);
 }
 
-Bool Rune::is_digit(Uint32 base) const {
-	if (v_ < 0x80) {
-		switch (v_) {
-		case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
-			return v_ - '0' < base;
-		case 'a': case 'b': case 'c': case 'd': case 'e': case 'f':
-			return v_ - 'a' + 10 < base;
-		case 'A': case 'B': case 'C': case 'D': case 'E': case 'F':
-			return v_ - 'A' + 10 < base;
-		}
+struct ScanNonASCII {
+	static THOR_FORCEINLINE Bool stop(Uint8 ch) {
+		return ch >= 0x80;
 	}
-	// TODO(dweiler): ND => true
-	return false;
-}
+#if defined(THOR_SIMD)
+	static THOR_FORCEINLINE Bytes stop(Bytes v) {
+		return Bytes::splat(0x80) <= v;
+	}
+#endif
+};
 
-Bool Rune::is_alpha() const {
-	return is_char() || is_digit();
+// Returns the length of the valid UTF-8 sequence beginning with the non-ASCII
+// byte at [data], or zero when it's not valid. Overlong encodings, surrogates
+// and code points past U+10FFFF are not valid.
+static Ulen utf8_sequence(const Uint8* data, Ulen length) {
+	const auto cont = [&](Ulen i, Uint8 lo = 0x80, Uint8 hi = 0xbf) {
+		return i < length && data[i] >= lo && data[i] <= hi;
+	};
+	const auto lead = data[0];
+	if (lead >= 0xc2 && lead <= 0xdf) {
+		return cont(1) ? 2 : 0;
+	} else if (lead >= 0xe0 && lead <= 0xef) {
+		const Uint8 lo = lead == 0xe0 ? 0xa0 : 0x80;
+		const Uint8 hi = lead == 0xed ? 0x9f : 0xbf;
+		return cont(1, lo, hi) && cont(2) ? 3 : 0;
+	} else if (lead >= 0xf0 && lead <= 0xf4) {
+		const Uint8 lo = lead == 0xf0 ? 0x90 : 0x80;
+		const Uint8 hi = lead == 0xf4 ? 0x8f : 0xbf;
+		return cont(1, lo, hi) && cont(2) && cont(3) ? 4 : 0;
+	}
+	return 0;
 }
 
-Bool Rune::is_white() const {
-	return v_ == ' ' || v_ == '\t' || v_ == '\n' || v_ == '\r';
+Ulen utf8_validate(const Uint8* data, Ulen length) {
+	Ulen offset = 0;
+	for (;;) {
+#if defined(THOR_SIMD)
+		// Skip blocks of four vectors at a time while they're all ASCII. A byte in
+		// the combined vector has the high bit set when any of the four does.
+		static constexpr const Ulen W = Bytes::WIDTH;
+		while (offset + W * 4 <= length) {
+			const auto p = data + offset;
+			const auto v = Bytes::load(p) | Bytes::load(p + W) | Bytes::load(p + W * 2) | Bytes::load(p + W * 3);
+			if ((Bytes::splat(0x80) <= v).mask()) {
+				break;
+			}
+			offset += W * 4;
+		}
+#endif
+		offset = simd_scan<ScanNonASCII>(reinterpret_cast<const char*>(data), offset, length);
+		if (offset == length) {
+			return length;
+		}
+		// Check the run of non-ASCII a sequence at a time since text which is not
+		// ASCII tends to have few ASCII bytes in between.
+		do {
+			const auto n = utf8_sequence(data + offset, length - offset);
+			if (n == 0) {
+				return offset;
+			}
+			offset += n;
+		} while (offset < length && data[offset] >= 0x80);
+	}
 }
 
 } // namespace Thor
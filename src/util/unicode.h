@@ -4,18 +4,81 @@
 
 namespace Thor {
 
+// The classes of the runes below U+0100 (ASCII and Latin-1) packed into a byte
+// each so that classifying them is a single load. The low five bits are the value
+// of the rune as a digit of a number literal, or DIGIT_VALUE when it's not one.
+struct RuneTable {
+	static inline constexpr const Uint8 DIGIT_VALUE = 0x1f;
+	static inline constexpr const Uint8 CHAR        = 1 << 5; // Letter or '_'
+	static inline constexpr const Uint8 DIGIT       = 1 << 6; // Decimal digit
+	static inline constexpr const Uint8 WHITE       = 1 << 7;
+	static constexpr RuneTable build() {
+		RuneTable result;
+		for (Uint32 i = 0; i < 256; i++) {
+			Uint8 entry = DIGIT_VALUE;
+			if (i >= '0' && i <= '9') {
+				entry = Uint8(i - '0') | DIGIT;
+			} else if (i >= 'a' && i <= 'z') {
+				entry = (i <= 'f' ? Uint8(i - 'a' + 10) : DIGIT_VALUE) | CHAR;
+			} else if (i >= 'A' && i <= 'Z') {
+				entry = (i <= 'F' ? Uint8(i - 'A' + 10) : DIGIT_VALUE) | CHAR;
+			} else if (i == '_') {
+				entry |= CHAR;
+			} else if (i == ' ' || i == '\t' || i == '\n' || i == '\r') {
+				entry |= WHITE;
+			} else if (i == 0xaa || i == 0xb5 || i == 0xba || (i >= 0xc0 && i != 0xd7 && i != 0xf7)) {
+				// The Latin-1 letters, none of the Latin-1 digits are decimal.
+				entry |= CHAR;
+			}
+			result.entries[i] = entry;
+		}
+		return result;
+	}
+	Uint8 entries[256] = {};
+};
+
+inline constexpr const RuneTable RUNE_TABLE = RuneTable::build();
+
 struct Rune {
 	constexpr Rune(Uint32 v) : v_{v} {}
-	[[nodiscard]] Bool is_char() const;
-	[[nodiscard]] Bool is_digit() const;
-	[[nodiscard]] Bool is_digit(Uint32 base) const;
-	[[nodiscard]] Bool is_alpha() const;
-	[[nodiscard]] Bool is_white() const;
+	[[nodiscard]] THOR_FORCEINLINE Bool is_char() const {
+		if (v_ < 0x100) {
+			return RUNE_TABLE.entries[v_] & RuneTable::CHAR;
+		}
+		return is_unicode_char();
+	}
+	[[nodiscard]] THOR_FORCEINLINE Bool is_digit() const {
+		if (v_ < 0x100) {
+			return RUNE_TABLE.entries[v_] & RuneTable::DIGIT;
+		}
+		return is_unicode_digit();
+	}
+	// Number literals are only ever ASCII.
+	[[nodiscard]] THOR_FORCEINLINE Bool is_digit(Uint32 base) const {
+		return v_ < 0x100 && Uint32(RUNE_TABLE.entries[v_] & RuneTable::DIGIT_VALUE) < base;
+	}
+	[[nodiscard]] THOR_FORCEINLINE Bool is_alpha() const {
+		if (v_ < 0x100) {
+			return RUNE_TABLE.entries[v_] & (RuneTable::CHAR | RuneTable::DIGIT);
+		}
+		return is_unicode_char() || is_unicode_digit();
+	}
+	[[nodiscard]] THOR_FORCEINLINE Bool is_white() const {
+		return v_ < 0x100 && (RUNE_TABLE.entries[v_] & RuneTable::WHITE);
+	}
 	operator Uint32() const { return v_; }
 private:
+	// The slow paths for the runes above U+00FF.
+	[[nodiscard]] Bool is_unicode_char() const;
+	[[nodiscard]] Bool is_unicode_digit() const;
 	Uint32 v_;
 };
 
+// Returns the offset of the first byte of [data] which does not begin a valid
+// UTF-8 sequence, or [length] when all of [data] is valid. Runs of ASCII are
+// checked a vector at a time so input that is all ASCII takes a single pass.
+Ulen utf8_validate(const Uint8* data, Ulen length);
+
 } // namespace Thor
 
 #endif // THOR_UNICODE
@@ -7,10 +7,14 @@
 // 	cc -xc++ -Isrc -std=c++20 -fno-rtti -fno-exceptions unity.cpp -o thor
 //
 // Thor will not link without the use of -fno-rtii and -fno-exceptions.
+//
+// Define THOR_BENCH to build the benchmarks (thor-bench) instead of the compiler.
+// Define THOR_GEN to build the corpus generator (thor-gen) instead.
 #include "src/util/allocator.cpp"
 #include "src/util/assert.cpp"
 #include "src/util/cpprt.cpp"
 #include "src/util/file.cpp"
+#include "src/util/job.cpp"
 #include "src/util/lock.cpp"
 #include "src/util/pool.cpp"
 #include "src/util/slab.cpp"
@@ -20,8 +24,22 @@
 #include "src/util/time.cpp"
 #include "src/util/unicode.cpp"
 #include "src/ast.cpp"
+#include "src/cache.cpp"
+#include "src/diagnostic.cpp"
+#include "src/driver.cpp"
 #include "src/lexer.cpp"
+#if defined(THOR_BENCH)
+#include "bench/main.cpp"
+#include "bench/lexer.cpp"
+#include "bench/identifier.cpp"
+#include "bench/parser.cpp"
+#include "bench/ast.cpp"
+#include "bench/driver.cpp"
+#elif defined(THOR_GEN)
+#include "gen/main.cpp"
+#else
 #include "src/main.cpp"
+#endif
 #include "src/parser.cpp"
 #include "src/cg_llvm.cpp"
 #include "src/system_posix.cpp"